@@ -8,10 +8,25 @@ JSP_SRC := $(JSP_BLOCK_PATH)/src
 LOCAL_C_INCLUDES += $(JSP_SRC)
 
 LOCAL_SRC_FILES += $(JSP_SRC)/jsp/Context.cpp
+LOCAL_SRC_FILES += $(JSP_SRC)/jsp/Encoding.cpp
 LOCAL_SRC_FILES += $(JSP_SRC)/jsp/WrappedObject.cpp
 LOCAL_SRC_FILES += $(JSP_SRC)/jsp/WrappedValue.cpp
 LOCAL_SRC_FILES += $(JSP_SRC)/jsp/Barker.cpp
+LOCAL_SRC_FILES += $(JSP_SRC)/jsp/Bytecode.cpp
 LOCAL_SRC_FILES += $(JSP_SRC)/jsp/CloneBuffer.cpp
+LOCAL_SRC_FILES += $(JSP_SRC)/jsp/CompileTask.cpp
+LOCAL_SRC_FILES += $(JSP_SRC)/jsp/GCController.cpp
+LOCAL_SRC_FILES += $(JSP_SRC)/jsp/GCScheduler.cpp
+LOCAL_SRC_FILES += $(JSP_SRC)/jsp/GCTelemetry.cpp
 LOCAL_SRC_FILES += $(JSP_SRC)/jsp/Manager.cpp
+LOCAL_SRC_FILES += $(JSP_SRC)/jsp/MappedFile.cpp
+LOCAL_SRC_FILES += $(JSP_SRC)/jsp/MemoryReport.cpp
+LOCAL_SRC_FILES += $(JSP_SRC)/jsp/PeerClass.cpp
+LOCAL_SRC_FILES += $(JSP_SRC)/jsp/PropertyKey.cpp
 LOCAL_SRC_FILES += $(JSP_SRC)/jsp/Proto.cpp
 LOCAL_SRC_FILES += $(JSP_SRC)/jsp/Proxy.cpp
+LOCAL_SRC_FILES += $(JSP_SRC)/jsp/ScriptCache.cpp
+LOCAL_SRC_FILES += $(JSP_SRC)/jsp/ScriptLoader.cpp
+LOCAL_SRC_FILES += $(JSP_SRC)/jsp/Struct.cpp
+LOCAL_SRC_FILES += $(JSP_SRC)/jsp/StructReader.cpp
+LOCAL_SRC_FILES += $(JSP_SRC)/jsp/Worker.cpp
@@ -7,6 +7,7 @@
  */
 
 #include "jsp/Barker.h"
+#include "jsp/MemoryReport.h"
 #include "jsp/Proto.h"
 
 #if defined(JSP_USE_PRIVATE_APIS)
@@ -20,8 +21,8 @@ using namespace chr;
 
 namespace jsp
 {
-    Barker::Statics *Barker::statics = nullptr;
-    int32_t Barker::lastInstanceId = -1;
+    thread_local Barker::Statics *Barker::statics = nullptr;
+    thread_local int32_t Barker::lastInstanceId = -1;
 
     bool Barker::init()
     {
@@ -68,6 +69,30 @@ namespace jsp
         }
     }
     
+    size_t Barker::getInstanceCount()
+    {
+        return statics ? statics->instances.size() : 0;
+    }
+    
+    size_t Barker::getStaticsByteSize()
+    {
+        size_t size = 0;
+        
+        if (statics)
+        {
+            size += sizeof(Statics);
+            size += MemoryReport::mapByteSize(statics->instances);
+            size += MemoryReport::mapByteSize(statics->names);
+            
+            for (auto &element : statics->names)
+            {
+                size += element.second.capacity();
+            }
+        }
+        
+        return size;
+    }
+    
     int32_t Barker::addInstance(JSObject *instance, const string &name)
     {
         for (auto &element : statics->instances)
@@ -192,12 +217,15 @@ namespace jsp
      *
      * ASSIGNING A FINALIZER WOULD FORCE BARKERS TO ALWAYS BE TENURED:
      * https://github.com/mozilla/gecko-dev/blob/esr31/js/public/RootingAPI.h#L318-319
+     *
+     * JSCLASS_IMPLEMENTS_BARRIERS: THE TRACE-HOOK IS NOT MARKING ANY GC-THING (THE RESERVED SLOT IS BARRIERED BY SPIDERMONKEY),
+     * OTHERWISE THE FIRST BARKER WOULD DISABLE INCREMENTAL GC FOR THE WHOLE RUNTIME (AND ASSERT IN DEBUG BUILDS)
      */
     
     const JSClass Barker::clazz =
     {
         "Barker",
-        JSCLASS_HAS_RESERVED_SLOTS(1),
+        JSCLASS_HAS_RESERVED_SLOTS(1) | JSCLASS_IMPLEMENTS_BARRIERS,
         JS_PropertyStub,
         JS_DeletePropertyStub,
         JS_PropertyStub,
@@ -78,6 +78,12 @@ namespace jsp
         static bool init();
         static void uninit();
         
+        /*
+         * FOR MEMORY-REPORTING (SEE MemoryReport)
+         */
+        static size_t getInstanceCount(); // INCLUDING THE FINALIZED BARKERS
+        static size_t getStaticsByteSize(); // APPROXIMATED
+        
         /*
          * C++ FACTORY
          */
@@ -100,8 +106,8 @@ namespace jsp
             std::map<int32_t, JSObject*> instances;
         };
         
-        static Statics *statics;
-        static int32_t lastInstanceId;
+        static thread_local Statics *statics;
+        static thread_local int32_t lastInstanceId;
         
         static int32_t addInstance(JSObject *instance, const std::string &name = "");
         static std::string getName(int32_t instanceId);
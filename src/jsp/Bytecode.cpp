@@ -0,0 +1,105 @@
+/*
+ * JSP: https://github.com/arielm/jsp
+ * COPYRIGHT (C) 2014-2015, ARIEL MALKA ALL RIGHTS RESERVED.
+ *
+ * THE FOLLOWING SOURCE-CODE IS DISTRIBUTED UNDER THE SIMPLIFIED BSD LICENSE:
+ * https://github.com/arielm/jsp/blob/master/LICENSE
+ */
+
+#include "jsp/Bytecode.h"
+#include "jsp/MappedFile.h"
+#include "jsp/ScriptCache.h"
+
+using namespace std;
+using namespace ci;
+using namespace chr;
+
+namespace jsp
+{
+    /*
+     * REPRODUCIBLE: DERIVED FROM THE SPIDERMONKEY VERSION AND FROM THE BUILD FLAGS AFFECTING THE XDR FORMAT
+     *
+     * REBUILDING JSP (OR THE APP) AGAINST THE SAME ENGINE KEEPS THE EXISTING BYTECODE FILES VALID
+     * IN ANY CASE, JS_DecodeScript REJECTS DATA PRODUCED WITH A DIFFERENT XDR_BYTECODE_VERSION
+     */
+    uint64_t Bytecode::getBuildId()
+    {
+        uint16_t endianness = 1;
+
+        stringstream buildInfo;
+        buildInfo << JS_GetImplementationVersion() << '|' << sizeof(void*) << '|' << (*reinterpret_cast<uint8_t*>(&endianness) ? "LE" : "BE");
+
+#if defined(MOZJS_MAJOR_VERSION) && defined(MOZJS_MINOR_VERSION)
+        buildInfo << '|' << MOZJS_MAJOR_VERSION << '.' << MOZJS_MINOR_VERSION;
+#endif
+
+#if defined(JS_DEBUG) || defined(DEBUG)
+        buildInfo << "|DEBUG";
+#endif
+
+#if defined(JS_PUNBOX64)
+        buildInfo << "|PUNBOX64";
+#elif defined(JS_NUNBOX32)
+        buildInfo << "|NUNBOX32";
+#endif
+
+        return ScriptCache::hashSource(buildInfo.str());
+    }
+
+    size_t Bytecode::write(const string &source, const string &file, DataTargetRef target)
+    {
+        CompileOptions options(cx);
+        options.setNoScriptRval(true);
+        options.setVersion(JSVersion::JSVERSION_LATEST);
+        options.setUTF8(true);
+        options.setFileAndLine(file.data(), 1);
+        options.setCompileAndGo(false);
+
+        RootedScript script(cx, Compile(cx, globalHandle(), options, source.data(), source.size()));
+
+        if (script)
+        {
+            uint32_t dataSize;
+            void *data = JS_EncodeScript(cx, script, &dataSize);
+
+            if (data)
+            {
+                Header header {{'J', 'S', 'P', 'B'}, VERSION, getBuildId(), ScriptCache::hashSource(source), source.size(), dataSize, 0};
+
+                auto stream = target->getStream();
+                stream->writeData(&header, sizeof(header));
+                stream->writeData(data, dataSize);
+
+                js_free(data);
+                return sizeof(header) + dataSize;
+            }
+        }
+
+        throw EXCEPTION(Bytecode, "ENCODING FAILED");
+    }
+
+    JSScript* Bytecode::read(const fs::path &bytecodePath, const string &source)
+    {
+        MappedFile mapped(bytecodePath);
+
+        if (mapped.isValid() && (mapped.getDataSize() >= sizeof(Header)))
+        {
+            auto header = reinterpret_cast<const Header*>(mapped.getData());
+
+            if ((memcmp(header->magic, "JSPB", 4) == 0) &&
+                (header->version == VERSION) &&
+                (header->buildId == getBuildId()) &&
+                (header->sourceSize == source.size()) &&
+                (header->dataSize == mapped.getDataSize() - sizeof(Header)) &&
+                (header->sourceHash == ScriptCache::hashSource(source)))
+            {
+                /*
+                 * THE XDR DATA IS COPIED BY SPIDERMONKEY DURING DECODING: THE FILE CAN BE UNMAPPED AFTERWARDS
+                 */
+                return JS_DecodeScript(cx, header + 1, header->dataSize, nullptr);
+            }
+        }
+
+        return nullptr;
+    }
+}
@@ -0,0 +1,62 @@
+/*
+ * JSP: https://github.com/arielm/jsp
+ * COPYRIGHT (C) 2014-2015, ARIEL MALKA ALL RIGHTS RESERVED.
+ *
+ * THE FOLLOWING SOURCE-CODE IS DISTRIBUTED UNDER THE SIMPLIFIED BSD LICENSE:
+ * https://github.com/arielm/jsp/blob/master/LICENSE
+ */
+
+/*
+ * PRECOMPILED SCRIPTS, BASED ON SPIDERMONKEY'S XDR (JS_EncodeScript / JS_DecodeScript)
+ *
+ * FILE FORMAT: A HEADER (MAGIC, VERSION, BUILD-ID, SOURCE-HASH, SOURCE-SIZE, DATA-SIZE), FOLLOWED BY THE XDR DATA
+ *
+ * A BYTECODE FILE IS ONLY VALID FOR:
+ * - THE EXACT SAME SOURCE (SEE ScriptCache::hashSource)
+ * - THE SAME SPIDERMONKEY VERSION, ARCHITECTURE AND BUILD FLAGS (XDR IS NOT PORTABLE ACROSS THEM, SEE getBuildId)
+ *
+ * THE SCRIPTS ARE NOT COMPILED IN "COMPILE-AND-GO" MODE (A REQUIREMENT FOR XDR)
+ */
+
+#pragma once
+
+#include "jsp/Context.h"
+
+#include "chronotext/Exception.h"
+
+#include "cinder/DataTarget.h"
+
+namespace jsp
+{
+    class Bytecode
+    {
+    public:
+        static uint64_t getBuildId();
+
+        /*
+         * COMPILES AND ENCODES THE SOURCE
+         * RETURNS THE NUMBER OF BYTES WRITTEN, THROWS UPON FAILURE
+         */
+        static size_t write(const std::string &source, const std::string &file, ci::DataTargetRef target);
+
+        /*
+         * MEMORY-MAPS AND DECODES THE BYTECODE FILE
+         * RETURNS NULL IF THE FILE IS MISSING, CORRUPTED, OR NOT MATCHING THE SOURCE OR THE BUILD
+         */
+        static JSScript* read(const ci::fs::path &bytecodePath, const std::string &source);
+
+    protected:
+        static constexpr uint32_t VERSION = 1;
+
+        struct Header
+        {
+            char magic[4];
+            uint32_t version;
+            uint64_t buildId;
+            uint64_t sourceHash;
+            uint64_t sourceSize;
+            uint32_t dataSize;
+            uint32_t reserved;
+        };
+    };
+}
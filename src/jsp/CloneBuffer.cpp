@@ -12,6 +12,9 @@
 
 #include "chronotext/Log.h"
 
+#include <zlib.h>
+#include <cstring>
+
 using namespace std;
 using namespace ci;
 using namespace chr;
@@ -20,6 +23,24 @@ namespace jsp
 {
     bool CloneBuffer::DUMP_UNSUPPORTED_OBJECTS = false;
     bool CloneBuffer::DUMP_UNSUPPORTED_FUNCTIONS = false;
+    
+    int CloneBuffer::ZLIB_LEVEL = Z_DEFAULT_COMPRESSION;
+    
+    atomic<size_t> CloneBuffer::liveCount(0);
+    atomic<size_t> CloneBuffer::liveBytes(0);
+    
+    /*
+     * NO CUSTOM TRANSFERABLES: ONLY ARRAY-BUFFERS, WHICH ARE NATIVELY SUPPORTED
+     */
+    const JSStructuredCloneCallbacks CloneBuffer::messageCallbacks =
+    {
+        CloneBuffer::readOp,
+        CloneBuffer::writeOp,
+        CloneBuffer::reportOp,
+        nullptr,
+        nullptr,
+        nullptr
+    };
 
     JSObject* CloneBuffer::read(DataSourceRef source)
     {
@@ -27,10 +48,10 @@ namespace jsp
         return tmp.read();
     }
     
-    size_t CloneBuffer::write(JSObject *object, DataTargetRef target)
+    size_t CloneBuffer::write(JSObject *object, DataTargetRef target, Compression compression, uint32_t blockSize)
     {
         CloneBuffer tmp(object);
-        return tmp.write(target);
+        return tmp.write(target, compression, blockSize);
     }
     
     CloneBuffer::CloneBuffer(JSObject *object)
@@ -38,29 +59,174 @@ namespace jsp
         serialize(object);
     }
     
+    /*
+     * SIZES WHICH ARE NOT A MULTIPLE OF 8 ARE LEFT EMPTY, I.E. deserialize() WILL THROW
+     *
+     * COMPRESSED SNAPSHOTS ARE DECOMPRESSED FROM THE MAPPED FILE (OR FROM THE BUFFER OF THE DATA-SOURCE), WHICH IS RELEASED RIGHT AFTER
+     */
     CloneBuffer::CloneBuffer(DataSourceRef source)
+    {
+        if (source->isFilePath())
+        {
+            mappedFile.reset(new MappedFile(source->getFilePath()));
+            
+            if (mappedFile->isValid() && isArchive(mappedFile->getData(), mappedFile->getDataSize()))
+            {
+                auto file = move(mappedFile);
+                readArchive(reinterpret_cast<const uint8_t*>(file->getData()), file->getDataSize());
+                
+                return;
+            }
+            
+            if (mappedFile->isValid() && (mappedFile->getDataSize() % sizeof(uint64_t) == 0))
+            {
+                data = reinterpret_cast<const uint64_t*>(mappedFile->getData()); // PAGE-ALIGNED
+                dataSize = mappedFile->getDataSize();
+                
+                return;
+            }
+            
+            mappedFile.reset();
+        }
+        
+        buffer = source->getBuffer();
+        
+        if (isArchive(buffer.getData(), buffer.getDataSize()))
+        {
+            auto archive = buffer;
+            buffer = Buffer();
+            
+            readArchive(reinterpret_cast<const uint8_t*>(archive.getData()), archive.getDataSize());
+            return;
+        }
+        
+        if (buffer.getDataSize() % sizeof(uint64_t) == 0)
+        {
+            data = reinterpret_cast<const uint64_t*>(buffer.getData()); // MALLOC-ALIGNED
+            dataSize = buffer.getDataSize();
+            
+            account(dataSize);
+        }
+    }
+    
+    CloneBuffer::CloneBuffer(HandleValue value, HandleValue transferables)
+    {
+        uint64_t *datap;
+        size_t nbytes;
+        
+        if (!JS_WriteStructuredClone(cx, value, &datap, &nbytes, &messageCallbacks, this, transferables))
+        {
+            throw EXCEPTION(CloneBuffer, "SERIALIZATION FAILED");
+        }
+        
+        adopt(datap, nbytes);
+    }
+    
+    CloneBuffer::CloneBuffer(CloneBuffer &&other)
     :
-    buffer(source)
-    {}
+    unsupportedIndex(other.unsupportedIndex),
+    data(other.data),
+    dataSize(other.dataSize),
+    ownedData(other.ownedData),
+    ownedSize(other.ownedSize),
+    mappedFile(move(other.mappedFile)),
+    buffer(other.buffer),
+    accountedBytes(other.accountedBytes)
+    {
+        other.data = nullptr;
+        other.dataSize = 0;
+        other.ownedData = nullptr;
+        other.ownedSize = 0;
+        other.buffer = Buffer();
+        other.accountedBytes = 0;
+    }
+    
+    /*
+     * TRANSFERRED CONTENTS WHICH WERE NOT READ ARE RELEASED AS WELL
+     */
+    CloneBuffer::~CloneBuffer()
+    {
+        if (ownedData)
+        {
+            JS_ClearStructuredClone(ownedData, ownedSize, nullptr, nullptr);
+        }
+        
+        account(0);
+    }
+    
+    size_t CloneBuffer::getLiveCount()
+    {
+        return liveCount.load(memory_order_relaxed);
+    }
+    
+    size_t CloneBuffer::getLiveBytes()
+    {
+        return liveBytes.load(memory_order_relaxed);
+    }
+    
+    void CloneBuffer::account(size_t bytes)
+    {
+        if (bytes != accountedBytes)
+        {
+            if (!accountedBytes)
+            {
+                liveCount++;
+            }
+            else if (!bytes)
+            {
+                liveCount--;
+            }
+            
+            liveBytes += bytes;
+            liveBytes -= accountedBytes;
+            
+            accountedBytes = bytes;
+        }
+    }
     
     JSObject* CloneBuffer::read()
     {
         return deserialize();
     }
     
-    size_t CloneBuffer::write(DataTargetRef target)
+    bool CloneBuffer::read(MutableHandleValue result)
     {
-        if (buffer.getDataSize() > 0)
+        if (data && (ownedData || !hasTransferables()))
         {
-            buffer.write(target);
+            return JS_ReadStructuredClone(cx, const_cast<uint64_t*>(data), dataSize, JS_STRUCTURED_CLONE_VERSION, result, &messageCallbacks, this);
         }
         
-        return buffer.getDataSize();
+        return false;
+    }
+    
+    /*
+     * STREAMED DIRECTLY FROM THE SERIALIZED DATA (OR FROM THE MAPPED FILE, ETC.)
+     */
+    size_t CloneBuffer::write(DataTargetRef target, Compression compression, uint32_t blockSize)
+    {
+        if (dataSize > 0)
+        {
+            if (hasTransferables())
+            {
+                throw EXCEPTION(CloneBuffer, "TRANSFERABLES CAN'T BE WRITTEN");
+            }
+            
+            auto stream = target->getStream();
+            
+            if (compression == COMPRESSION_ZLIB)
+            {
+                return writeArchive(stream, blockSize);
+            }
+            
+            stream->writeData(data, dataSize);
+        }
+        
+        return dataSize;
     }
     
     JSObject* CloneBuffer::deserialize()
     {
-        if (buffer.getDataSize() > 0)
+        if (data && (ownedData || !hasTransferables()))
         {
             JSStructuredCloneCallbacks callbacks;
             callbacks.read = CloneBuffer::readOp;
@@ -68,7 +234,7 @@ namespace jsp
             
             RootedValue out(cx);
             
-            if (JS_ReadStructuredClone(cx, (uint64_t*)buffer.getData(), buffer.getDataSize(), JS_STRUCTURED_CLONE_VERSION, &out, &callbacks, this))
+            if (JS_ReadStructuredClone(cx, const_cast<uint64_t*>(data), dataSize, JS_STRUCTURED_CLONE_VERSION, &out, &callbacks, this))
             {
                 if (!out.isNullOrUndefined())
                 {
@@ -101,10 +267,7 @@ namespace jsp
                 
                 if (JS_WriteStructuredClone(cx, in, &datap, &nbytes, &callbacks, this, UndefinedHandleValue))
                 {
-                    buffer = Buffer(nbytes);
-                    buffer.copyFrom(datap, nbytes); // TODO: COPY ONLY WHEN NECESSARY
-                    
-                    JS_ClearStructuredClone(datap, nbytes, nullptr, nullptr);
+                    adopt(datap, nbytes);
                     return;
                 }
             }
@@ -113,6 +276,180 @@ namespace jsp
         throw EXCEPTION(CloneBuffer, "SERIALIZATION FAILED");
     }
     
+    /*
+     * NO COPY: THE DATA WILL BE RELEASED VIA JS_ClearStructuredClone UPON DESTRUCTION
+     */
+    void CloneBuffer::adopt(uint64_t *datap, size_t nbytes)
+    {
+        ownedData = datap;
+        ownedSize = nbytes;
+        
+        data = ownedData;
+        dataSize = ownedSize;
+        
+        account(ownedSize);
+    }
+    
+    bool CloneBuffer::hasTransferables() const
+    {
+        bool result = false;
+        
+        if (data && !JS_StructuredCloneHasTransferables(data, dataSize, &result))
+        {
+            return true; // I.E. NOT TRUSTED
+        }
+        
+        return result;
+    }
+    
+    // ---
+    
+    bool CloneBuffer::isArchive(const void *source, size_t size)
+    {
+        return source && (size >= sizeof(ArchiveHeader)) && (memcmp(source, "JSPC", 4) == 0);
+    }
+    
+    /*
+     * THE WHOLE HEADER IS KNOWN BEFOREHAND, I.E. THE DATA-TARGET DOES NOT NEED TO BE SEEKABLE
+     *
+     * A SINGLE SCRATCH-BUFFER (OF compressBound(blockSize) BYTES) IS USED FOR ALL THE BLOCKS
+     */
+    size_t CloneBuffer::writeArchive(OStreamRef stream, uint32_t blockSize)
+    {
+        static_assert(sizeof(ArchiveHeader) == 32, "UNEXPECTED ArchiveHeader LAYOUT");
+        
+        if ((blockSize == 0) || (dataSize > MAX_ARCHIVE_SIZE))
+        {
+            throw EXCEPTION(CloneBuffer, "INVALID BLOCK-SIZE OR DATA-SIZE");
+        }
+        
+        auto bytes = reinterpret_cast<const Bytef*>(data);
+        uLong checksum = adler32(0, Z_NULL, 0);
+        
+        for (size_t offset = 0; offset < dataSize; offset += blockSize)
+        {
+            checksum = adler32(checksum, bytes + offset, min<size_t>(blockSize, dataSize - offset));
+        }
+        
+        ArchiveHeader header;
+        memcpy(header.magic, "JSPC", 4);
+        header.version = ARCHIVE_VERSION;
+        header.codec = COMPRESSION_ZLIB;
+        header.blockSize = blockSize;
+        header.rawSize = dataSize;
+        header.blockCount = (dataSize + blockSize - 1) / blockSize;
+        header.checksum = checksum;
+        
+        stream->writeData(&header, sizeof(header));
+        size_t written = sizeof(header);
+        
+        vector<Bytef> compressed(compressBound(blockSize));
+        
+        for (size_t offset = 0; offset < dataSize; offset += blockSize)
+        {
+            uLongf compressedSize = compressed.size();
+            
+            if (compress2(compressed.data(), &compressedSize, bytes + offset, min<size_t>(blockSize, dataSize - offset), ZLIB_LEVEL) != Z_OK)
+            {
+                throw EXCEPTION(CloneBuffer, "COMPRESSION FAILED");
+            }
+            
+            uint32_t compressedBlockSize = compressedSize;
+            stream->writeData(&compressedBlockSize, sizeof(compressedBlockSize));
+            stream->writeData(compressed.data(), compressedSize);
+            
+            written += sizeof(compressedBlockSize) + compressedSize;
+        }
+        
+        return written;
+    }
+    
+    /*
+     * THE DESTINATION IS ALLOCATED VIA js_malloc, SO THAT IT CAN BE ADOPTED (AND EVENTUALLY RELEASED VIA JS_ClearStructuredClone)
+     *
+     * SINCE JS_ClearStructuredClone WOULD RELEASE THE TRANSFERABLES: DECOMPRESSED DATA HOLDING TRANSFERABLES IS REJECTED
+     *
+     * THE HEADER IS NOT TRUSTED: THE RAW-SIZE IS BOUNDED BEFORE ANY ALLOCATION, BY MAX_ARCHIVE_SIZE,
+     * BY THE BLOCKS DECLARED, AND BY THE MAXIMUM RATIO OF DEFLATE (1032:1) APPLIED TO THE INPUT SIZE
+     */
+    void CloneBuffer::readArchive(const uint8_t *source, size_t size)
+    {
+        constexpr uint64_t MAX_DEFLATE_RATIO = 1032;
+        
+        ArchiveHeader header;
+        memcpy(&header, source, sizeof(header));
+        
+        if ((header.version == ARCHIVE_VERSION) &&
+            (header.codec == COMPRESSION_ZLIB) &&
+            (header.blockSize > 0) &&
+            (header.rawSize > 0) &&
+            (header.rawSize <= MAX_ARCHIVE_SIZE) &&
+            (header.rawSize <= SIZE_MAX) &&
+            (header.rawSize <= uint64_t(size - sizeof(header)) * MAX_DEFLATE_RATIO) &&
+            (header.rawSize <= uint64_t(header.blockCount) * header.blockSize) &&
+            (header.rawSize % sizeof(uint64_t) == 0) &&
+            (header.blockCount == (header.rawSize + header.blockSize - 1) / header.blockSize))
+        {
+            auto output = static_cast<uint64_t*>(js_malloc(size_t(header.rawSize)));
+            
+            if (output)
+            {
+                auto bytes = reinterpret_cast<Bytef*>(output);
+                auto input = source + sizeof(header);
+                auto end = source + size;
+                
+                uint64_t offset = 0;
+                uLong checksum = adler32(0, Z_NULL, 0);
+                
+                for (uint32_t block = 0; block < header.blockCount; block++)
+                {
+                    uint32_t compressedSize;
+                    
+                    if (size_t(end - input) < sizeof(compressedSize))
+                    {
+                        break;
+                    }
+                    
+                    memcpy(&compressedSize, input, sizeof(compressedSize)); // NOT NECESSARILY ALIGNED
+                    input += sizeof(compressedSize);
+                    
+                    uLongf expectedSize = min<uint64_t>(header.blockSize, header.rawSize - offset);
+                    uLongf blockSize = expectedSize;
+                    
+                    if ((size_t(end - input) < compressedSize) ||
+                        (uncompress(bytes + offset, &blockSize, input, compressedSize) != Z_OK) ||
+                        (blockSize != expectedSize))
+                    {
+                        break;
+                    }
+                    
+                    checksum = adler32(checksum, bytes + offset, blockSize);
+                    
+                    input += compressedSize;
+                    offset += blockSize;
+                }
+                
+                bool transferables = true;
+                
+                if ((offset == header.rawSize) &&
+                    (input == end) && // I.E. NO TRAILING BYTES
+                    (checksum == header.checksum) &&
+                    JS_StructuredCloneHasTransferables(output, size_t(header.rawSize), &transferables) &&
+                    !transferables)
+                {
+                    adopt(output, size_t(header.rawSize));
+                    return;
+                }
+                
+                js_free(output);
+            }
+        }
+        
+        throw EXCEPTION(CloneBuffer, "CORRUPTED SNAPSHOT");
+    }
+    
+    // ---
+    
     JSObject* CloneBuffer::readOp(JSContext *cx, JSStructuredCloneReader *r, uint32_t tag, uint32_t data, void *closure)
     {
         auto unsupportedIndex = data;
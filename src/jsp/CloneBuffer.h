@@ -6,15 +6,41 @@
  * https://github.com/arielm/jsp/blob/master/LICENSE
  */
 
+/*
+ * STRUCTURED-CLONE BUFFERS, WITHOUT INTERMEDIATE COPIES:
+ *
+ * - SERIALIZING: THE DATA PRODUCED BY JS_WriteStructuredClone IS ADOPTED AS-IS
+ * - READING FROM A FILE: THE FILE IS MEMORY-MAPPED AND DESERIALIZED IN-PLACE (SEE MappedFile)
+ * - READING FROM OTHER DATA-SOURCES (E.G. ANDROID ASSETS): THE BUFFER OF THE DATA-SOURCE IS SHARED
+ * - WRITING: THE DATA IS STREAMED AS-IS TO THE DATA-TARGET
+ *
+ * LIMITATIONS:
+ * - BUFFERS HOLDING TRANSFERABLES CAN'T BE WRITTEN (THEIR DATA IS MADE OF POINTERS)
+ * - FOR THE SAME REASON: BUFFERS READ FROM A DATA-SOURCE ARE REJECTED IF THEY HOLD TRANSFERABLES
+ *
+ * COMPRESSED SNAPSHOTS (SEE write WITH COMPRESSION_ZLIB):
+ * - A 32-BYTES HEADER (MAGIC "JSPC", VERSION, CODEC, BLOCK-SIZE, RAW-SIZE, BLOCK-COUNT AND ADLER-32 OF THE RAW DATA)
+ * - FOLLOWED BY THE BLOCKS: EACH ONE PREFIXED BY ITS COMPRESSED SIZE (UINT32) AND COMPRESSED INDEPENDENTLY
+ * - READING: DETECTED AUTOMATICALLY, THEN DECOMPRESSED BLOCK-BY-BLOCK DIRECTLY INTO THE (OWNED) DESTINATION BUFFER
+ * - THE REPEATED KEYS AND STRINGS OF THE CLONE-STREAM ARE DEDUPLICATED BY ZLIB'S WINDOW, AS LONG AS THEY ARE LESS THAN 32KB APART
+ * - ALL THE FIELDS ARE IN NATIVE BYTE-ORDER (LIKE THE CLONE-STREAM ITSELF)
+ * - THE BLOCK-SIZE IS CHOSEN PER WRITE (DEFAULT_BLOCK_SIZE BY DEFAULT)
+ * - A CORRUPTED SNAPSHOT (E.G. CHECKSUM MISMATCH, TRAILING BYTES) OR A SNAPSHOT LARGER THAN MAX_ARCHIVE_SIZE THROWS UPON CONSTRUCTION
+ */
+
 #pragma once
 
 #include "jsp/Context.h"
+#include "jsp/MappedFile.h"
 
 #include "chronotext/Exception.h"
 
 #include "cinder/DataSource.h"
 #include "cinder/DataTarget.h"
 
+#include <atomic>
+#include <memory>
+
 namespace jsp
 {
     class CloneBuffer
@@ -23,22 +49,115 @@ namespace jsp
         static bool DUMP_UNSUPPORTED_OBJECTS;
         static bool DUMP_UNSUPPORTED_FUNCTIONS;
         
+        enum Compression
+        {
+            COMPRESSION_NONE, // I.E. THE RAW CLONE-STREAM
+            COMPRESSION_ZLIB
+        };
+        
+        static int ZLIB_LEVEL;
+        
+        static constexpr uint32_t DEFAULT_BLOCK_SIZE = 256 * 1024;
+        static constexpr uint64_t MAX_ARCHIVE_SIZE = 1ULL << 30; // DECOMPRESSED, I.E. 1 GB
+        
         static JSObject* read(ci::DataSourceRef source);
-        static size_t write(JSObject *object, ci::DataTargetRef target);
+        static size_t write(JSObject *object, ci::DataTargetRef target, Compression compression = COMPRESSION_NONE, uint32_t blockSize = DEFAULT_BLOCK_SIZE);
         
         CloneBuffer(JSObject *object);
         CloneBuffer(ci::DataSourceRef source);
         
+        /*
+         * FOR MESSAGES BETWEEN ENGINES (SEE Worker):
+         *
+         * - ANY VALUE (I.E. NOT ONLY OBJECTS)
+         * - THE CONTENTS OF THE ARRAY-BUFFERS LISTED IN transferables (AN ARRAY, OR UNDEFINED) ARE TRANSFERRED INSTEAD OF COPIED
+         *   (THE ORIGINAL ARRAY-BUFFERS ARE NEUTERED)
+         * - THE SERIALIZED DATA IS OWNED, I.E. NOT COPIED
+         * - THE ENGINE READING THE MESSAGE CAN BE DIFFERENT FROM THE ONE WHICH WROTE IT
+         */
+        CloneBuffer(HandleValue value, HandleValue transferables);
+        
+        CloneBuffer(CloneBuffer &&other);
+        ~CloneBuffer();
+        
         JSObject* read();
-        size_t write(ci::DataTargetRef target);
+        
+        /*
+         * RETURNS THE NUMBER OF BYTES WRITTEN
+         *
+         * blockSize: THE SIZE OF THE (UNCOMPRESSED) BLOCKS, ONLY RELEVANT FOR COMPRESSION_ZLIB
+         */
+        size_t write(ci::DataTargetRef target, Compression compression = COMPRESSION_NONE, uint32_t blockSize = DEFAULT_BLOCK_SIZE);
+        
+        /*
+         * RETURNS FALSE UPON FAILURE
+         *
+         * WHEN TRANSFERABLES ARE INVOLVED: CAN BE INVOKED ONLY ONCE
+         */
+        bool read(MutableHandleValue result);
+        
+        size_t getDataSize() const
+        {
+            return dataSize;
+        }
+        
+        /*
+         * THE SERIALIZED DATA HELD BY THE LIVING BUFFERS, ACROSS ALL THE ENGINES (SEE MemoryReport)
+         *
+         * MEMORY-MAPPED FILES ARE NOT ACCOUNTED
+         */
+        static size_t getLiveCount();
+        static size_t getLiveBytes();
         
     protected:
+        static constexpr uint32_t ARCHIVE_VERSION = 1;
+        
+        struct ArchiveHeader
+        {
+            char magic[4];
+            uint32_t version;
+            uint32_t codec;
+            uint32_t blockSize;
+            uint64_t rawSize;
+            uint32_t blockCount;
+            uint32_t checksum;
+        };
+        
+        uint32_t unsupportedIndex = 0;
+        
+        /*
+         * POINTING TO ONE OF THE 3 KINDS OF STORAGE
+         */
+        const uint64_t *data = nullptr;
+        size_t dataSize = 0;
+        
+        uint64_t *ownedData = nullptr; // PRODUCED BY JS_WriteStructuredClone
+        size_t ownedSize = 0;
+        
+        std::unique_ptr<MappedFile> mappedFile;
         ci::Buffer buffer;
-        uint32_t unsupportedIndex;
+        
+        size_t accountedBytes = 0;
+        void account(size_t bytes);
+        
+        static std::atomic<size_t> liveCount;
+        static std::atomic<size_t> liveBytes;
         
         JSObject* deserialize();
         void serialize(JSObject *object);
         
+        void adopt(uint64_t *datap, size_t nbytes);
+        bool hasTransferables() const;
+        
+        static bool isArchive(const void *source, size_t size);
+        void readArchive(const uint8_t *source, size_t size);
+        size_t writeArchive(ci::OStreamRef stream, uint32_t blockSize);
+        
+        CloneBuffer(const CloneBuffer &other) = delete;
+        void operator=(const CloneBuffer &other) = delete;
+        
+        static const JSStructuredCloneCallbacks messageCallbacks;
+        
         static JSObject* readOp(JSContext *cx, JSStructuredCloneReader *r, uint32_t tag, uint32_t data, void *closure);
         static bool writeOp(JSContext *cx, JSStructuredCloneWriter *w, HandleObject obj, void *closure);
         static void reportOp(JSContext *cx, uint32_t errorid);
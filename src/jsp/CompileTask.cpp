@@ -0,0 +1,313 @@
+/*
+ * JSP: https://github.com/arielm/jsp
+ * COPYRIGHT (C) 2014-2015, ARIEL MALKA ALL RIGHTS RESERVED.
+ *
+ * THE FOLLOWING SOURCE-CODE IS DISTRIBUTED UNDER THE SIMPLIFIED BSD LICENSE:
+ * https://github.com/arielm/jsp/blob/master/LICENSE
+ */
+
+#include "jsp/CompileTask.h"
+
+#include "js/CharacterEncoding.h"
+
+#include "chronotext/utils/Utils.h"
+
+#include <algorithm>
+
+using namespace std;
+using namespace chr;
+
+namespace jsp
+{
+    thread_local CompileTask::Statics *CompileTask::statics = nullptr;
+
+    bool CompileTask::init()
+    {
+        if (!statics)
+        {
+            statics = new Statics;
+            JSP::addTracerCallback(statics, BIND_STATIC1(CompileTask::trace));
+        }
+
+        return bool(statics);
+    }
+
+    /*
+     * PENDING COMPILATIONS MUST BE OVER BEFORE THE RUNTIME IS DESTROYED
+     *
+     * TASKS WHICH ARE STILL REFERENCED ARE "EMPTIED" (I.E. finish() WILL RETURN NULL)
+     */
+    void CompileTask::uninit()
+    {
+        if (statics)
+        {
+            for (auto &task : statics->pending)
+            {
+                task->discard();
+            }
+
+            for (auto task : statics->tasks)
+            {
+                task->script = nullptr;
+                task->finished = true;
+            }
+
+            JSP::removeTracerCallback(statics);
+
+            /*
+             * THE DESTRUCTION OF THE PENDING TASKS MUST NOT AFFECT THE STATICS BEING DELETED
+             */
+            auto doomed = statics;
+            statics = nullptr;
+
+            delete doomed;
+        }
+    }
+
+    CompileTask::Ref CompileTask::start(const string &source, const string &file, int line, const Callback &callback)
+    {
+        Ref task(new CompileTask(file, callback));
+
+        /*
+         * JS::CompileOffThread() IS ONLY ACCEPTING UTF-16, WHICH MUST REMAIN ALIVE UNTIL THE COMPILATION IS OVER
+         */
+        task->chars = UTF8CharsToNewTwoByteCharsZ(cx, UTF8Chars(source.data(), source.size()), &task->length).get();
+
+        if (!task->chars)
+        {
+            if (JS_IsExceptionPending(cx))
+            {
+                JS_ReportPendingException(cx);
+                JS_ClearPendingException(cx);
+            }
+
+            return nullptr;
+        }
+
+        OwningCompileOptions options(cx);
+        options.setNoScriptRval(true);
+        options.setVersion(JSVersion::JSVERSION_LATEST);
+        options.setCompileAndGo(true);
+        options.setFileAndLine(cx, task->file.data(), line);
+
+        if (CanCompileOffThread(cx, options, task->length) && CompileOffThread(cx, options, task->chars, task->length, compileCallback, task.get()))
+        {
+            task->offThread = true;
+        }
+        else
+        {
+            task->script = Compile(cx, globalHandle(), options, task->chars, task->length);
+
+            if (JS_IsExceptionPending(cx))
+            {
+                JS_ReportPendingException(cx);
+                JS_ClearPendingException(cx);
+            }
+
+            task->compileSeconds = chrono::duration<double>(chrono::steady_clock::now() - task->startTime).count();
+            task->compiled = true;
+        }
+
+        if (statics)
+        {
+            statics->pending.push_back(task);
+        }
+
+        return task;
+    }
+
+    /*
+     * THE CALLBACKS CAN START NEW TASKS, OR FINISH OTHER PENDING ONES
+     */
+    int CompileTask::dispatch()
+    {
+        int count = 0;
+
+        if (statics)
+        {
+            vector<Ref> ready;
+
+            for (auto &task : statics->pending)
+            {
+                if (task->compiled)
+                {
+                    ready.push_back(task);
+                }
+            }
+
+            for (auto &task : ready)
+            {
+                if (!task->finished)
+                {
+                    task->finish();
+
+                    if (task->callback)
+                    {
+                        task->callback(*task);
+                    }
+                    else
+                    {
+                        try
+                        {
+                            task->execute();
+                        }
+                        catch (exception &e)
+                        {} // ERRORS ARE ALREADY REPORTED (SEE Manager::reportError)
+                    }
+
+                    count++;
+                }
+            }
+        }
+
+        return count;
+    }
+
+    size_t CompileTask::getPendingCount()
+    {
+        return statics ? statics->pending.size() : 0;
+    }
+
+    // ---
+
+    CompileTask::CompileTask(const string &file, const Callback &callback)
+    :
+    file(file),
+    callback(callback),
+    compiled(false),
+    startTime(chrono::steady_clock::now())
+    {
+        if (statics)
+        {
+            statics->tasks.push_back(this);
+        }
+    }
+
+    CompileTask::~CompileTask()
+    {
+        if (statics)
+        {
+            auto found = find(statics->tasks.begin(), statics->tasks.end(), this);
+
+            if (found != statics->tasks.end())
+            {
+                statics->tasks.erase(found);
+            }
+        }
+
+        js_free(chars);
+    }
+
+    JSScript* CompileTask::finish()
+    {
+        if (!finished)
+        {
+            if (offThread)
+            {
+                {
+                    unique_lock<mutex> lock(compileMutex);
+                    compileCondition.wait(lock, [this] { return compiled.load(); });
+                }
+
+                script = FinishOffThreadScript(cx, rt, token);
+
+                if (JS_IsExceptionPending(cx))
+                {
+                    JS_ReportPendingException(cx);
+                    JS_ClearPendingException(cx);
+                }
+            }
+
+            finished = true;
+
+            js_free(chars);
+            chars = nullptr;
+
+            if (statics)
+            {
+                auto found = find_if(statics->pending.begin(), statics->pending.end(), [this](const Ref &task) { return task.get() == this; });
+
+                if (found != statics->pending.end())
+                {
+                    statics->pending.erase(found);
+                }
+            }
+        }
+
+        return script;
+    }
+
+    void CompileTask::execute()
+    {
+        RootedScript compiledScript(cx, finish());
+
+        if (!compiledScript)
+        {
+            throw EXCEPTION(CompileTask, "COMPILATION FAILED");
+        }
+
+        RootedValue result(cx);
+        bool success = JS_ExecuteScript(cx, globalHandle(), compiledScript, &result);
+
+        if (JS_IsExceptionPending(cx))
+        {
+            JS_ReportPendingException(cx);
+            JS_ClearPendingException(cx);
+        }
+
+        if (!success)
+        {
+            throw EXCEPTION(CompileTask, "EXECUTION FAILED");
+        }
+    }
+
+    /*
+     * WAITING FOR THE HELPER THREAD, AND THEN THROWING THE SCRIPT AWAY (NO ERROR-REPORTING)
+     */
+    void CompileTask::discard()
+    {
+        if (!finished && offThread)
+        {
+            {
+                unique_lock<mutex> lock(compileMutex);
+                compileCondition.wait(lock, [this] { return compiled.load(); });
+            }
+
+            FinishOffThreadScript(nullptr, rt, token);
+        }
+
+        finished = true;
+        script = nullptr;
+    }
+
+    // ---
+
+    void CompileTask::trace(JSTracer *trc)
+    {
+        for (auto task : statics->tasks)
+        {
+            if (task->script)
+            {
+                JS_CallScriptTracer(trc, &task->script, "CompileTask");
+            }
+        }
+    }
+
+    /*
+     * INVOKED ON THE HELPER THREAD
+     */
+    void CompileTask::compileCallback(void *token, void *data)
+    {
+        auto task = static_cast<CompileTask*>(data);
+
+        {
+            lock_guard<mutex> lock(task->compileMutex);
+
+            task->token = token;
+            task->compileSeconds = chrono::duration<double>(chrono::steady_clock::now() - task->startTime).count();
+            task->compiled = true;
+        }
+
+        task->compileCondition.notify_all();
+    }
+}
@@ -0,0 +1,139 @@
+/*
+ * JSP: https://github.com/arielm/jsp
+ * COPYRIGHT (C) 2014-2015, ARIEL MALKA ALL RIGHTS RESERVED.
+ *
+ * THE FOLLOWING SOURCE-CODE IS DISTRIBUTED UNDER THE SIMPLIFIED BSD LICENSE:
+ * https://github.com/arielm/jsp/blob/master/LICENSE
+ */
+
+/*
+ * SCRIPTS COMPILED ON A HELPER THREAD OF SPIDERMONKEY (VIA JS::CompileOffThread), AND EXECUTED ON THE MAIN THREAD
+ *
+ * - REQUIRES Manager::USE_HELPER_THREADS
+ * - FALLS BACK TO MAIN-THREAD COMPILATION WHEN SPIDERMONKEY DECLINES (E.G. SCRIPTS SMALLER THAN 1000 CHARACTERS)
+ * - COMPLETION IS DELIVERED ON THE MAIN THREAD, UPON CompileTask::dispatch() (E.G. ONCE PER FRAME):
+ *   - TO THE CALLBACK, IF ANY
+ *   - OTHERWISE: THE SCRIPT IS EXECUTED
+ * - THE COMPILED SCRIPTS ARE TRACED VIA JSP::addTracerCallback(), AS LONG AS THEIR CompileTask IS ALIVE
+ *
+ * USAGE:
+ *
+ * auto task = Proto::compileScriptAsync(hugeSource, "huge.js");
+ *
+ * CompileTask::dispatch(); // LATER ON...
+ */
+
+#pragma once
+
+#include "jsp/Context.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
+namespace jsp
+{
+    class CompileTask
+    {
+    public:
+        typedef std::shared_ptr<CompileTask> Ref;
+        typedef std::function<void(CompileTask&)> Callback;
+
+        static bool init();
+        static void uninit();
+
+        /*
+         * RETURNS NULL IF THE SOURCE COULD NOT BE DECODED
+         */
+        static Ref start(const std::string &source, const std::string &file = "", int line = 1, const Callback &callback = nullptr);
+
+        /*
+         * MAIN THREAD: FINISHES THE COMPILATIONS COMPLETED IN THE MEANTIME, AND DELIVERS THEM
+         *
+         * RETURNS THE NUMBER OF DELIVERED TASKS
+         */
+        static int dispatch();
+
+        static size_t getPendingCount();
+
+        // ---
+
+        ~CompileTask();
+
+        /*
+         * NON-BLOCKING: TRUE WHEN THE HELPER THREAD IS DONE
+         */
+        bool isCompiled() const
+        {
+            return compiled;
+        }
+
+        bool isOffThread() const
+        {
+            return offThread;
+        }
+
+        const std::string& getFile() const
+        {
+            return file;
+        }
+
+        /*
+         * TIME SPENT BETWEEN start() AND THE END OF THE COMPILATION
+         */
+        double getCompileSeconds() const
+        {
+            return compileSeconds;
+        }
+
+        /*
+         * BLOCKS UNTIL THE COMPILATION IS OVER
+         *
+         * RETURNS NULL UPON COMPILATION-ERROR (REPORTED VIA Manager::reportError)
+         */
+        JSScript* finish();
+
+        /*
+         * BLOCKS UNTIL THE COMPILATION IS OVER
+         *
+         * THROWS UPON COMPILATION OR EXECUTION-ERROR
+         */
+        void execute();
+
+    protected:
+        struct Statics
+        {
+            std::vector<Ref> pending;
+            std::vector<CompileTask*> tasks;
+        };
+
+        static thread_local Statics *statics;
+
+        std::string file;
+        Callback callback;
+
+        jschar *chars = nullptr;
+        size_t length = 0;
+
+        bool offThread = false;
+        bool finished = false;
+        JSScript *script = nullptr;
+
+        void *token = nullptr;
+        std::atomic<bool> compiled;
+        double compileSeconds = 0;
+
+        std::mutex compileMutex;
+        std::condition_variable compileCondition;
+        std::chrono::steady_clock::time_point startTime;
+
+        CompileTask(const std::string &file, const Callback &callback);
+
+        void discard();
+
+        static void trace(JSTracer *trc);
+        static void compileCallback(void *token, void *data);
+    };
+}
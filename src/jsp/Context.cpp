@@ -7,12 +7,18 @@
  */
 
 #include "jsp/Context.h"
+#include "jsp/Encoding.h"
+#include "jsp/GCTelemetry.h"
+#include "jsp/MemoryReport.h"
+#include "jsp/PropertyKey.h"
 #include "jsp/WrappedObject.h"
 #include "jsp/WrappedValue.h"
 
 #include "chronotext/Log.h"
 #include "chronotext/incubator/utils/FileCapture.h"
 
+#include <atomic>
+
 using namespace std;
 using namespace chr;
 
@@ -20,21 +26,32 @@ using namespace chr;
 
 namespace jsp
 {
-    JSRuntime *rt = nullptr;
-    JSContext *cx = nullptr;
-    Heap<JSObject*> global;
+    thread_local JSRuntime *rt = nullptr;
+    thread_local JSContext *cx = nullptr;
+    thread_local Heap<JSObject*> global;
 }
 
 #pragma mark ---------------------------------------- JSP NAMESPACE ----------------------------------------
 
 using namespace jsp;
 
-bool JSP::initialized = false;
+thread_local bool JSP::initialized = false;
+thread_local uint32_t JSP::generation = 0;
+
+thread_local map<void*, JSP::TracerCallbackFnType> JSP::tracerCallbacks;
+thread_local TracerRegistry<WrappedValue> JSP::tracedValues;
+thread_local TracerRegistry<WrappedObject> JSP::tracedObjects;
+thread_local TracerRegistry<PropertyKey> JSP::tracedKeys;
+thread_local map<void*, JSP::GCCallbackFnType> JSP::gcCallbacks;
 
-map<void*, JSP::TracerCallbackFnType> JSP::tracerCallbacks;
-map<void*, JSP::GCCallbackFnType> JSP::gcCallbacks;
+thread_local JSP::CachedString JSP::stringCache[STRING_CACHE_SIZE];
 
-char JSP::traceBuffer[TRACE_BUFFER_SIZE];
+thread_local char JSP::traceBuffer[TRACE_BUFFER_SIZE];
+
+/*
+ * SHARED BY ALL THE ENGINES: A GENERATION IS NEVER "VALID" ON TWO THREADS
+ */
+static atomic<uint32_t> lastGeneration(0);
 
 // ---
 
@@ -48,6 +65,7 @@ bool JSP::init()
         // ---
         
         initialized = true;
+        generation = ++lastGeneration;
     }
     
     return initialized;
@@ -59,6 +77,12 @@ void JSP::uninit()
     {
         JS_RemoveExtraGCRootsTracer(rt, tracerCallback, nullptr);
         tracerCallbacks.clear();
+        tracedValues.clear();
+        tracedObjects.clear();
+        clearStringCache();
+        
+        tracedKeys.forEach([](PropertyKey *key) { key->id = JSID_VOID; }); // I.E. TO BE RESOLVED AGAIN BY THE NEXT RUNTIME
+        tracedKeys.clear();
         
         JS_SetGCCallback(rt, nullptr, nullptr);
         gcCallbacks.clear();
@@ -66,9 +90,15 @@ void JSP::uninit()
         // ---
         
         initialized = false;
+        generation = ++lastGeneration;
     }
 }
 
+uint32_t JSP::getGeneration()
+{
+    return generation;
+}
+
 #pragma mark ---------------------------------------- CENTRALIZED EXTRA-ROOT-TRACING ----------------------------------------
 
 void JSP::addTracerCallback(void *instance, const TracerCallbackFnType &fn)
@@ -83,8 +113,70 @@ void JSP::removeTracerCallback(void *instance)
     tracerCallbacks.erase(instance);
 }
 
+void JSP::addTracedValue(WrappedValue *wrapped)
+{
+    JS_ASSERT(initialized);
+    tracedValues.add(wrapped);
+}
+
+void JSP::removeTracedValue(WrappedValue *wrapped)
+{
+    JS_ASSERT(initialized);
+    tracedValues.remove(wrapped);
+}
+
+void JSP::addTracedObject(WrappedObject *wrapped)
+{
+    JS_ASSERT(initialized);
+    tracedObjects.add(wrapped);
+}
+
+void JSP::removeTracedObject(WrappedObject *wrapped)
+{
+    JS_ASSERT(initialized);
+    tracedObjects.remove(wrapped);
+}
+
+size_t JSP::getTracedCount()
+{
+    return tracedValues.size() + tracedObjects.size();
+}
+
+size_t JSP::getTracerByteSize()
+{
+    return tracedValues.getByteSize()
+    + tracedObjects.getByteSize()
+    + tracedKeys.getByteSize()
+    + MemoryReport::mapByteSize(tracerCallbacks)
+    + MemoryReport::mapByteSize(gcCallbacks);
+}
+
+void JSP::addTracedKey(PropertyKey *key)
+{
+    JS_ASSERT(initialized);
+    tracedKeys.add(key);
+}
+
+void JSP::removeTracedKey(PropertyKey *key)
+{
+    JS_ASSERT(initialized);
+    tracedKeys.remove(key);
+}
+
 void JSP::tracerCallback(JSTracer *trc, void *data)
 {
+    tracedValues.forEach([=](WrappedValue *wrapped) { wrapped->trace(trc); });
+    tracedObjects.forEach([=](WrappedObject *wrapped) { wrapped->trace(trc); });
+    tracedKeys.forEach([=](PropertyKey *key) { key->trace(trc); });
+    
+    for (auto &entry : stringCache)
+    {
+        if (entry.str)
+        {
+            JS_CallStringTracer(trc, &entry.str, "JSP::stringCache");
+        }
+    }
+    
     for (auto &element : tracerCallbacks)
     {
         element.second(trc);
@@ -116,14 +208,12 @@ void JSP::gcCallback(JSRuntime *rt, JSGCStatus status, void *data)
 #pragma mark ---------------------------------------- STRING HELPERS ----------------------------------------
 
 /*
- * SUB-OPTIMAL: THE DATA PRODUCED BY TwoByteCharsToNewUTF8CharsZ() IS CURRENTLY COPIED INTO std::string
- *
- * TODO: A BETTER ALTERNATIVE WOULD BE TO DECODE "IN PLACE" (NOT ALLOWED BY THE CURRENT CharacterEncoding API)
+ * UTF-8 ENCODING TAKES PLACE "IN PLACE", WITHOUT INTERMEDIATE BUFFERS (SEE Encoding.h)
  */
 
 void JSP::assignString(string &target, const jschar *chars, size_t len)
 {
-    target.assign(TwoByteCharsToNewUTF8CharsZ(cx, TwoByteChars(chars, len)).c_str());
+    Encoding::assignUTF8(target, chars, len);
 }
 
 void JSP::assignString(string &target, JSString *str)
@@ -134,7 +224,7 @@ void JSP::assignString(string &target, JSString *str)
         
         if (linear)
         {
-            target.assign(TwoByteCharsToNewUTF8CharsZ(cx, TwoByteChars(linear->chars(), linear->length())).c_str());
+            Encoding::assignUTF8(target, linear->chars(), linear->length());
             return;
         }
     }
@@ -146,7 +236,8 @@ void JSP::assignString(string &target, JSString *str)
 
 string& JSP::appendString(string &target, const jschar *chars, size_t len)
 {
-    return target.append(TwoByteCharsToNewUTF8CharsZ(cx, TwoByteChars(chars, len)).c_str());
+    Encoding::appendUTF8(target, chars, len);
+    return target;
 }
 
 string& JSP::appendString(string &target, JSString *str)
@@ -157,7 +248,7 @@ string& JSP::appendString(string &target, JSString *str)
         
         if (linear)
         {
-            return target.append(TwoByteCharsToNewUTF8CharsZ(cx, TwoByteChars(linear->chars(), linear->length())).c_str());
+            Encoding::appendUTF8(target, linear->chars(), linear->length());
         }
     }
     
@@ -172,7 +263,7 @@ string JSP::toString(const jschar *chars, size_t len)
     
     if (chars && len)
     {
-        result = TwoByteCharsToNewUTF8CharsZ(cx, TwoByteChars(chars, len)).c_str();
+        Encoding::assignUTF8(result, chars, len);
     }
     
     return result; // RVO-COMPLIANT
@@ -188,7 +279,7 @@ string JSP::toString(JSString *str)
         
         if (linear)
         {
-            result = TwoByteCharsToNewUTF8CharsZ(cx, TwoByteChars(linear->chars(), linear->length())).c_str();
+            Encoding::assignUTF8(result, linear->chars(), linear->length());
         }
     }
     
@@ -204,25 +295,133 @@ JSFlatString* JSP::toJSString(const char *c)
 {
     if (c)
     {
-        size_t len;
-        jschar *chars = LossyUTF8CharsToNewTwoByteCharsZ(cx, UTF8Chars(c, strlen(c)), &len).get();
-        
-        if (chars)
+        return toJSString(c, strlen(c));
+    }
+    
+    return cx->emptyString(); // ATOMS ARE "FLAT"
+}
+
+JSFlatString* JSP::toJSString(const char *c, size_t len)
+{
+    if (c && len)
+    {
+        if (Encoding::isASCII(c, len))
         {
-            JSFlatString *result = js_NewString<js::CanGC>(cx, chars, len); // USED BY JS_NewUCString() BEHIND THE SCENES
+            if (len <= STRING_CACHE_MAX_LENGTH)
+            {
+                return toCachedJSString(c, len);
+            }
+            
+            /*
+             * WIDENING TAKES PLACE DIRECTLY INTO THE CHARS OF THE NEW STRING
+             * (USED BY JS_NewStringCopyN() BEHIND THE SCENES)
+             */
+            JSFlatString *result = js::NewStringCopyN<js::CanGC>(cx, c, len);
             
             if (result)
             {
-                return result; // (TRANSFERRED) MEMORY IS NOW UNDER THE RULES OF GC...
+                return result;
             }
+        }
+        else
+        {
+            size_t utf16Length;
+            jschar *chars = LossyUTF8CharsToNewTwoByteCharsZ(cx, UTF8Chars(c, len), &utf16Length).get();
             
-            js_free(chars); // OTHERWISE: WE'RE IN CHARGE
+            if (chars)
+            {
+                JSFlatString *result = js_NewString<js::CanGC>(cx, chars, utf16Length); // USED BY JS_NewUCString() BEHIND THE SCENES
+                
+                if (result)
+                {
+                    return result; // (TRANSFERRED) MEMORY IS NOW UNDER THE RULES OF GC...
+                }
+                
+                js_free(chars); // OTHERWISE: WE'RE IN CHARGE
+            }
         }
     }
     
     return cx->emptyString(); // ATOMS ARE "FLAT"
 }
 
+JSFlatString* JSP::toCachedJSString(const char *c, size_t len)
+{
+    uint32_t hash = 2166136261u; // FNV-1A
+    
+    for (size_t i = 0; i < len; i++)
+    {
+        hash = (hash ^ uint8_t(c[i])) * 16777619u;
+    }
+    
+    auto &entry = stringCache[hash & (STRING_CACHE_SIZE - 1)];
+    
+    if (entry.str && (entry.hash == hash) && (entry.length == len) && (memcmp(entry.chars, c, len) == 0))
+    {
+        return &entry.str->asFlat();
+    }
+    
+    /*
+     * SHORT STRINGS ARE "INLINE": NO EXTRA HEAP-ALLOCATION FOR THE CHARS
+     *
+     * THE ENTRY IS ONLY OVERWRITTEN AFTERWARDS: CREATING THE STRING CAN TRIGGER GC
+     */
+    JSFlatString *result = js::NewStringCopyN<js::CanGC>(cx, c, len);
+    
+    if (result)
+    {
+        entry.str = result;
+        entry.hash = hash;
+        entry.length = uint32_t(len);
+        memcpy(entry.chars, c, len);
+        
+        return result;
+    }
+    
+    return cx->emptyString();
+}
+
+void JSP::clearStringCache()
+{
+    for (auto &entry : stringCache)
+    {
+        entry.str = nullptr;
+    }
+}
+
+// ---
+
+JSAtom* JSP::toAtom(const char *c)
+{
+    return c ? toAtom(c, strlen(c)) : nullptr;
+}
+
+JSAtom* JSP::toAtom(const char *c, size_t len, bool pinned)
+{
+    if (c)
+    {
+        auto behavior = pinned ? js::InternAtom : js::DoNotInternAtom;
+        
+        if (Encoding::isASCII(c, len))
+        {
+            return js::Atomize(cx, c, len, behavior); // USED BY JS_InternStringN() BEHIND THE SCENES
+        }
+        
+        size_t utf16Length;
+        jschar *chars = LossyUTF8CharsToNewTwoByteCharsZ(cx, UTF8Chars(c, len), &utf16Length).get();
+        
+        if (chars)
+        {
+            JSAtom *result = js::AtomizeChars(cx, chars, utf16Length, behavior);
+            
+            js_free(chars); // ATOMIZATION IS ALWAYS PERFORMED BY COPY
+            return result;
+        }
+    }
+    
+    return nullptr;
+}
+
 bool JSP::stringEquals(JSString *str1, const char *c2)
 {
     if (str1 && c2)
@@ -668,8 +867,15 @@ void JSP::forceGC()
 {
     LOGD << "JSP::forceGC() | BEGIN" << endl; // LOG: VERBOSE
     
+    /*
+     * THE MODE IS RESTORED, E.G. FOR NOT INTERFERING WITH GCScheduler
+     */
+    uint32_t mode = JS_GetGCParameter(rt, JSGC_MODE);
+    GCTelemetry::ReasonScope reason("API");
+    
     JS_SetGCParameter(rt, JSGC_MODE, JSGC_MODE_GLOBAL);
     JS_GC(rt);
+    JS_SetGCParameter(rt, JSGC_MODE, mode);
     
     LOGD << "JSP::forceGC() | END" << endl; // LOG: VERBOSE
 }
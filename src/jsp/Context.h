@@ -9,6 +9,7 @@
 #pragma once
 
 #include "jsp/Types.h"
+#include "jsp/TracerRegistry.h"
 
 #include "jsapi.h"
 #include "jsfriendapi.h"
@@ -42,12 +43,19 @@ namespace jsp
 
     class WrappedObject;
     class WrappedValue;
+    class PropertyKey;
 
     // ---
     
-    extern JSRuntime *rt;
-    extern JSContext *cx;
-    extern Heap<JSObject*> global;
+    /*
+     * ONE ENGINE PER THREAD (SEE Manager):
+     *
+     * THE FOLLOWING, AS WELL AS THE REGISTRIES OF JSP AND THE STATICS OF Barker, Proxy, ScriptCache, CompileTask AND GCTelemetry, ARE THREAD-LOCAL
+     */
+    
+    extern thread_local JSRuntime *rt;
+    extern thread_local JSContext *cx;
+    extern thread_local Heap<JSObject*> global;
     
     inline JS::HandleObject globalHandle()
     {
@@ -89,11 +97,40 @@ public:
     static bool init();
     static void uninit();
     
+    /*
+     * CHANGED UPON EACH init() AND uninit(), UNIQUE ACROSS THE ENGINES OF THE PROCESS
+     *
+     * ALLOWS OBJECTS OUTLIVING JSP (E.G. STATICS) TO FIND-OUT IF THE GC-THINGS THEY ARE HOLDING
+     * (AND THEIR TRACER-CALLBACK REGISTRATION) BELONG TO THE CURRENT RUNTIME
+     */
+    static uint32_t getGeneration();
+    
     // ---
     
     static void addTracerCallback(void *instance, const TracerCallbackFnType &fn);
     static void removeTracerCallback(void *instance);
     
+    /*
+     * USED BY THE POST-BARRIERS OF Heap<WrappedValue> AND Heap<WrappedObject>
+     * SEE TracerRegistry.h
+     */
+    static void addTracedValue(jsp::WrappedValue *wrapped);
+    static void removeTracedValue(jsp::WrappedValue *wrapped);
+    static void addTracedObject(jsp::WrappedObject *wrapped);
+    static void removeTracedObject(jsp::WrappedObject *wrapped);
+    static size_t getTracedCount();
+    
+    /*
+     * HEAP-MEMORY RESERVED BY THE TRACED VALUES, OBJECTS AND KEYS, AND BY THE CALLBACK REGISTRIES (APPROXIMATED)
+     */
+    static size_t getTracerByteSize();
+    
+    /*
+     * USED BY PropertyKey, ONCE RESOLVED
+     */
+    static void addTracedKey(jsp::PropertyKey *key);
+    static void removeTracedKey(jsp::PropertyKey *key);
+    
     static void addGCCallback(void *instance, const GCCallbackFnType &fn);
     static void removeGCCallback(void *instance);
     
@@ -111,9 +148,23 @@ public:
     static std::string toString(JSString *str);
     static std::string toString(JS::HandleValue value);
 
+    /*
+     * PURE-ASCII INPUT IS "WIDENED" DIRECTLY INTO GC-OWNED CHARS
+     * SHORT PURE-ASCII INPUT IS SERVED FROM A SMALL-STRING CACHE (KEYED BY CONTENT)
+     */
     static JSFlatString* toJSString(const char *c);
+    static JSFlatString* toJSString(const char *c, size_t len);
     static JSFlatString* toJSString(const std::string &s);
 
+    /*
+     * PINNED ATOMS: FOR PROPERTY-NAMES USED OVER AND OVER (E.G. VIA AtomToId)
+     * NON-PINNED ATOMS MUST BE TRACED (SEE PropertyKey)
+     * RETURNS NULL UPON FAILURE
+     */
+    static JSAtom* toAtom(const char *c);
+    static JSAtom* toAtom(const char *c, size_t len, bool pinned = true);
+    static JSAtom* toAtom(const std::string &s);
+
     static bool stringEquals(JSString *str1, const char *c2);
     static bool stringEquals(JSString *str1, const std::string &s2);
 
@@ -483,18 +534,47 @@ private:
         static bool callback(const jschar *buf, uint32_t len, void *data);
     };
 
-    static bool initialized;
+    static thread_local bool initialized;
+    static thread_local uint32_t generation;
 
-    static std::map<void*, TracerCallbackFnType> tracerCallbacks;
-    static std::map<void*, GCCallbackFnType> gcCallbacks;
+    static thread_local std::map<void*, TracerCallbackFnType> tracerCallbacks;
+    static thread_local jsp::TracerRegistry<jsp::WrappedValue> tracedValues;
+    static thread_local jsp::TracerRegistry<jsp::WrappedObject> tracedObjects;
+    static thread_local jsp::TracerRegistry<jsp::PropertyKey> tracedKeys;
+    static thread_local std::map<void*, GCCallbackFnType> gcCallbacks;
 
     static void tracerCallback(JSTracer *trc, void *data);
     static void gcCallback(JSRuntime *rt, JSGCStatus status, void *data);
     
     // ---
     
+    /*
+     * SMALL-STRING CACHE, USED BY toJSString() FOR SHORT PURE-ASCII INPUT
+     *
+     * - DIRECT-MAPPED, KEYED BY CONTENT: A COLLISION SIMPLY REPLACES THE PREVIOUS ENTRY
+     * - THE CACHED STRINGS ARE TRACED AS EXTRA-ROOTS
+     * - NO POST-BARRIER REQUIRED: STRINGS ARE NEVER ALLOCATED IN THE NURSERY
+     */
+    static constexpr size_t STRING_CACHE_SIZE = 256; // MUST BE A POWER OF 2
+    static constexpr size_t STRING_CACHE_MAX_LENGTH = 24;
+    
+    struct CachedString
+    {
+        JSString *str;
+        uint32_t hash;
+        uint32_t length;
+        char chars[STRING_CACHE_MAX_LENGTH];
+    };
+    
+    static thread_local CachedString stringCache[STRING_CACHE_SIZE];
+    
+    static JSFlatString* toCachedJSString(const char *c, size_t len);
+    static void clearStringCache();
+    
+    // ---
+    
     static constexpr size_t TRACE_BUFFER_SIZE = 256;
-    static char traceBuffer[TRACE_BUFFER_SIZE];
+    static thread_local char traceBuffer[TRACE_BUFFER_SIZE];
 };
 
 // ---
@@ -516,7 +596,12 @@ inline std::string JSP::toString(JS::HandleValue value)
 
 inline JSFlatString* JSP::toJSString(const std::string &s)
 {
-    return toJSString(s.data());
+    return toJSString(s.data(), s.size());
+}
+
+inline JSAtom* JSP::toAtom(const std::string &s)
+{
+    return toAtom(s.data(), s.size());
 }
 
 inline bool JSP::stringEquals(JSString *str1, const std::string &s2)
@@ -0,0 +1,268 @@
+/*
+ * JSP: https://github.com/arielm/jsp
+ * COPYRIGHT (C) 2014-2015, ARIEL MALKA ALL RIGHTS RESERVED.
+ *
+ * THE FOLLOWING SOURCE-CODE IS DISTRIBUTED UNDER THE SIMPLIFIED BSD LICENSE:
+ * https://github.com/arielm/jsp/blob/master/LICENSE
+ */
+
+#include "jsp/Encoding.h"
+
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define JSP_SIMD_SSE2
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define JSP_SIMD_NEON
+#endif
+
+using namespace std;
+
+namespace jsp
+{
+    namespace
+    {
+        inline bool isHighSurrogate(uint32_t c)
+        {
+            return (c >= 0xD800) && (c <= 0xDBFF);
+        }
+
+        inline bool isLowSurrogate(uint32_t c)
+        {
+            return (c >= 0xDC00) && (c <= 0xDFFF);
+        }
+
+#if defined(JSP_SIMD_SSE2)
+
+        constexpr size_t BLOCK_SIZE = 8;
+
+        inline bool isASCIIBlock(const jschar *chars)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(chars));
+            return _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, _mm_set1_epi16(int16_t(0xFF80))), _mm_setzero_si128())) == 0xFFFF;
+        }
+
+        inline void narrowASCIIBlock(const jschar *chars, char *destination)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(chars));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(destination), _mm_packus_epi16(v, v));
+        }
+
+        inline bool isASCIIBytes16(const char *c)
+        {
+            return _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(c))) == 0;
+        }
+
+#elif defined(JSP_SIMD_NEON)
+
+        constexpr size_t BLOCK_SIZE = 8;
+
+        inline bool isASCIIBlock(const jschar *chars)
+        {
+            uint16x8_t v = vld1q_u16(reinterpret_cast<const uint16_t*>(chars));
+            return vget_lane_u64(vreinterpret_u64_u8(vqmovn_u16(vshrq_n_u16(v, 7))), 0) == 0;
+        }
+
+        inline void narrowASCIIBlock(const jschar *chars, char *destination)
+        {
+            uint16x8_t v = vld1q_u16(reinterpret_cast<const uint16_t*>(chars));
+            vst1_u8(reinterpret_cast<uint8_t*>(destination), vmovn_u16(v));
+        }
+
+        inline bool isASCIIBytes16(const char *c)
+        {
+            uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(c));
+            uint8x8_t folded = vorr_u8(vget_low_u8(v), vget_high_u8(v));
+            return (vget_lane_u64(vreinterpret_u64_u8(folded), 0) & 0x8080808080808080ULL) == 0;
+        }
+
+#else
+
+        constexpr size_t BLOCK_SIZE = 4;
+
+        inline bool isASCIIBlock(const jschar *chars)
+        {
+            return ((chars[0] | chars[1] | chars[2] | chars[3]) & 0xFF80) == 0;
+        }
+
+        inline void narrowASCIIBlock(const jschar *chars, char *destination)
+        {
+            destination[0] = char(chars[0]);
+            destination[1] = char(chars[1]);
+            destination[2] = char(chars[2]);
+            destination[3] = char(chars[3]);
+        }
+
+        inline bool isASCIIBytes16(const char *c)
+        {
+            uint64_t words[2];
+            memcpy(words, c, 16);
+
+            return ((words[0] | words[1]) & 0x8080808080808080ULL) == 0;
+        }
+
+#endif
+    }
+
+    bool Encoding::isASCII(const char *c, size_t len)
+    {
+        size_t i = 0;
+
+        for (; len - i >= 16; i += 16)
+        {
+            if (!isASCIIBytes16(c + i))
+            {
+                return false;
+            }
+        }
+
+        for (; i < len; i++)
+        {
+            if (uint8_t(c[i]) & 0x80)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // ---
+
+    size_t Encoding::getUTF8Length(const jschar *chars, size_t len)
+    {
+        size_t utf8Length = 0;
+        size_t i = 0;
+
+        while (i < len)
+        {
+            size_t end = len;
+
+            if (len - i >= BLOCK_SIZE)
+            {
+                if (isASCIIBlock(chars + i))
+                {
+                    utf8Length += BLOCK_SIZE;
+                    i += BLOCK_SIZE;
+                    continue;
+                }
+
+                end = i + BLOCK_SIZE; // NOT WORTH RE-CHECKING FOR ASCII BEFORE THE END OF THE BLOCK
+            }
+
+            while (i < end)
+            {
+                uint32_t c = chars[i++];
+
+                if (c < 0x80)
+                {
+                    utf8Length += 1;
+                }
+                else if (c < 0x800)
+                {
+                    utf8Length += 2;
+                }
+                else if (isHighSurrogate(c) && (i < len) && isLowSurrogate(chars[i]))
+                {
+                    utf8Length += 4;
+                    i++;
+                }
+                else
+                {
+                    utf8Length += 3; // INCLUDING INVALID SURROGATES, ENCODED AS U+FFFD
+                }
+            }
+        }
+
+        return utf8Length;
+    }
+
+    size_t Encoding::encodeUTF8(const jschar *chars, size_t len, char *destination)
+    {
+        auto out = reinterpret_cast<uint8_t*>(destination);
+        size_t i = 0;
+
+        while (i < len)
+        {
+            size_t end = len;
+
+            if (len - i >= BLOCK_SIZE)
+            {
+                if (isASCIIBlock(chars + i))
+                {
+                    narrowASCIIBlock(chars + i, reinterpret_cast<char*>(out));
+                    out += BLOCK_SIZE;
+                    i += BLOCK_SIZE;
+                    continue;
+                }
+
+                end = i + BLOCK_SIZE;
+            }
+
+            while (i < end)
+            {
+                uint32_t c = chars[i++];
+
+                if (c < 0x80)
+                {
+                    *out++ = uint8_t(c);
+                }
+                else if (c < 0x800)
+                {
+                    *out++ = uint8_t(0xC0 | (c >> 6));
+                    *out++ = uint8_t(0x80 | (c & 0x3F));
+                }
+                else
+                {
+                    if (isHighSurrogate(c) || isLowSurrogate(c))
+                    {
+                        if (isHighSurrogate(c) && (i < len) && isLowSurrogate(chars[i]))
+                        {
+                            c = 0x10000 + ((c - 0xD800) << 10) + (chars[i++] - 0xDC00);
+
+                            *out++ = uint8_t(0xF0 | (c >> 18));
+                            *out++ = uint8_t(0x80 | ((c >> 12) & 0x3F));
+                            *out++ = uint8_t(0x80 | ((c >> 6) & 0x3F));
+                            *out++ = uint8_t(0x80 | (c & 0x3F));
+
+                            continue;
+                        }
+
+                        c = 0xFFFD;
+                    }
+
+                    *out++ = uint8_t(0xE0 | (c >> 12));
+                    *out++ = uint8_t(0x80 | ((c >> 6) & 0x3F));
+                    *out++ = uint8_t(0x80 | (c & 0x3F));
+                }
+            }
+        }
+
+        return out - reinterpret_cast<uint8_t*>(destination);
+    }
+
+    // ---
+
+    void Encoding::assignUTF8(string &target, const jschar *chars, size_t len)
+    {
+        target.resize(getUTF8Length(chars, len));
+
+        if (!target.empty())
+        {
+            encodeUTF8(chars, len, &target[0]);
+        }
+    }
+
+    void Encoding::appendUTF8(string &target, const jschar *chars, size_t len)
+    {
+        auto offset = target.size();
+        target.resize(offset + getUTF8Length(chars, len));
+
+        if (target.size() > offset)
+        {
+            encodeUTF8(chars, len, &target[offset]);
+        }
+    }
+}
@@ -0,0 +1,48 @@
+/*
+ * JSP: https://github.com/arielm/jsp
+ * COPYRIGHT (C) 2014-2015, ARIEL MALKA ALL RIGHTS RESERVED.
+ *
+ * THE FOLLOWING SOURCE-CODE IS DISTRIBUTED UNDER THE SIMPLIFIED BSD LICENSE:
+ * https://github.com/arielm/jsp/blob/master/LICENSE
+ */
+
+/*
+ * UTF-16 TO UTF-8 TRANSCODING, WITHOUT INTERMEDIATE BUFFERS
+ *
+ * ALSO: FAST ASCII DETECTION, USED FOR "WIDENING" C++ STRINGS DIRECTLY INTO JS STRINGS (SEE JSP::toJSString)
+ *
+ * THE CharacterEncoding API OF SPIDERMONKEY 31 CAN ONLY PRODUCE NEWLY-ALLOCATED UTF-8 BUFFERS:
+ * - THE UTF-8 LENGTH IS COMPUTED FIRST, SO THAT THE TARGET CAN BE RESIZED ONCE
+ * - THE CHARACTERS ARE THEN ENCODED "IN PLACE"
+ * - RUNS OF ASCII CHARACTERS ARE PROCESSED 8 AT A TIME (SSE2 OR NEON, WHEN AVAILABLE)
+ *
+ * SAME POLICY AS SPIDERMONKEY REGARDING INVALID SURROGATES: THEY ARE ENCODED AS U+FFFD
+ */
+
+#pragma once
+
+#include "js/TypeDecls.h"
+
+#include <string>
+
+namespace jsp
+{
+    class Encoding
+    {
+    public:
+        static bool isASCII(const char *c, size_t len);
+
+        // ---
+
+        static size_t getUTF8Length(const jschar *chars, size_t len);
+
+        /*
+         * THE DESTINATION MUST HAVE ROOM FOR getUTF8Length(chars, len) BYTES (NO NULL-TERMINATOR IS WRITTEN)
+         * RETURNS THE NUMBER OF BYTES WRITTEN
+         */
+        static size_t encodeUTF8(const jschar *chars, size_t len, char *destination);
+
+        static void assignUTF8(std::string &target, const jschar *chars, size_t len);
+        static void appendUTF8(std::string &target, const jschar *chars, size_t len);
+    };
+}
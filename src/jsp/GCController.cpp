@@ -0,0 +1,453 @@
+/*
+ * JSP: https://github.com/arielm/jsp
+ * COPYRIGHT (C) 2014-2015, ARIEL MALKA ALL RIGHTS RESERVED.
+ *
+ * THE FOLLOWING SOURCE-CODE IS DISTRIBUTED UNDER THE SIMPLIFIED BSD LICENSE:
+ * https://github.com/arielm/jsp/blob/master/LICENSE
+ */
+
+/*
+ * REFERENCE FOR THE GC PARAMETERS (UNITS, DEFAULTS):
+ * https://github.com/mozilla/gecko-dev/blob/esr31/js/src/jsgc.cpp
+ */
+
+#include "jsp/GCController.h"
+#include "jsp/GCTelemetry.h"
+#include "jsp/Proto.h"
+
+#include "chronotext/Log.h"
+#include "chronotext/utils/Utils.h"
+
+using namespace std;
+using namespace chr;
+
+namespace jsp
+{
+    bool GCController::LOG_ADJUSTMENTS = true;
+    size_t GCController::HISTORY_SIZE = 64;
+
+    static constexpr uint64_t MB = 1024 * 1024;
+
+    /*
+     * JSGC_MAX_BYTES IS A 32-BIT PARAMETER
+     */
+    static constexpr uint32_t MAX_MEMORY_MB = uint32_t(UINT32_MAX / MB);
+
+    static uint32_t toBytes(uint64_t megabytes)
+    {
+        return uint32_t(min<uint64_t>(megabytes * MB, UINT32_MAX));
+    }
+
+    static string formatMB(double bytes)
+    {
+        stringstream s;
+        s.precision(1);
+        s << fixed << bytes / MB << " MB";
+
+        return s.str();
+    }
+
+    GCController::GCController(GCScheduler &scheduler)
+    :
+    scheduler(scheduler)
+    {
+        addPreset(Preset());
+    }
+
+    void GCController::setEnabled(bool enabled)
+    {
+        if (rt && (enabled != this->enabled))
+        {
+            this->enabled = enabled;
+
+            if (enabled)
+            {
+                startTime = chrono::steady_clock::now();
+
+                collected = false;
+                collectionCount = 0;
+                allocationRate = 0;
+                collectionInterval = 0;
+
+                auto pauseRing = GCTelemetry::getPauseRing();
+                pauseIndex = pauseRing ? pauseRing->getPushCount() : 0;
+
+                JSP::addGCCallback(this, BIND_INSTANCE2(&GCController::gcCallback, this));
+                applyPreset();
+            }
+            else
+            {
+                /*
+                 * THE PARAMETERS ARE LEFT AS THEY ARE
+                 */
+                JSP::removeGCCallback(this);
+            }
+        }
+    }
+
+    bool GCController::loadPresets(InputSource::Ref inputSource)
+    {
+        return loadPresets(utils::readText<string>(inputSource));
+    }
+
+    bool GCController::loadPresets(const string &json)
+    {
+        RootedObject config(cx, JSP::parse(json));
+
+        if (config)
+        {
+            RootedObject gc(cx, Proto::get<OBJECT>(config, "gc"));
+
+            if (gc)
+            {
+                RootedObject array(cx, Proto::get<OBJECT>(gc, "presets"));
+
+                if (array && JS_IsArrayObject(cx, array))
+                {
+                    auto count = Proto::getElementCount(array);
+
+                    for (int i = 0; i < count; i++)
+                    {
+                        RootedValue element(cx);
+
+                        if (Proto::getElement(array, i, &element) && element.isObject())
+                        {
+                            RootedObject object(cx, &element.toObject());
+                            Preset defaults;
+
+                            Preset loaded;
+                            loaded.name = Proto::get<STRING>(object, "name", defaults.name.data());
+
+                            loaded.targetPause = Proto::get<FLOAT64>(object, "targetPause", defaults.targetPause);
+                            loaded.memoryCeiling = Proto::get<UINT32>(object, "memoryCeiling", defaults.memoryCeiling);
+                            loaded.memoryFloor = Proto::get<UINT32>(object, "memoryFloor", defaults.memoryFloor);
+
+                            loaded.minSliceBudget = Proto::get<FLOAT64>(object, "minSliceBudget", defaults.minSliceBudget);
+                            loaded.maxSliceBudget = Proto::get<FLOAT64>(object, "maxSliceBudget", defaults.maxSliceBudget);
+
+                            loaded.minHeapGrowth = Proto::get<UINT32>(object, "minHeapGrowth", defaults.minHeapGrowth);
+                            loaded.maxHeapGrowth = Proto::get<UINT32>(object, "maxHeapGrowth", defaults.maxHeapGrowth);
+                            loaded.lowFrequencyHeapGrowth = Proto::get<UINT32>(object, "lowFrequencyHeapGrowth", defaults.lowFrequencyHeapGrowth);
+
+                            loaded.highFrequencyTimeLimit = Proto::get<UINT32>(object, "highFrequencyTimeLimit", defaults.highFrequencyTimeLimit);
+                            loaded.highFrequencyLowLimit = Proto::get<UINT32>(object, "highFrequencyLowLimit", defaults.highFrequencyLowLimit);
+                            loaded.highFrequencyHighLimit = Proto::get<UINT32>(object, "highFrequencyHighLimit", defaults.highFrequencyHighLimit);
+
+                            loaded.dynamicHeapGrowth = Proto::get<BOOLEAN>(object, "dynamicHeapGrowth", defaults.dynamicHeapGrowth);
+                            loaded.dynamicMarkSlice = Proto::get<BOOLEAN>(object, "dynamicMarkSlice", defaults.dynamicMarkSlice);
+
+                            addPreset(loaded);
+                        }
+                    }
+
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    /*
+     * INCONSISTENT BOUNDS ARE FIXED, E.G. SPIDERMONKEY IS EXPECTING HEAP-GROWTHS ABOVE 100%
+     * AND THE MEMORY BOUNDS MUST FIT IN JSGC_MAX_BYTES
+     */
+    void GCController::addPreset(const Preset &preset)
+    {
+        Preset fixed = preset;
+
+        fixed.memoryFloor = min(MAX_MEMORY_MB, max<uint32_t>(1, fixed.memoryFloor));
+        fixed.memoryCeiling = min(MAX_MEMORY_MB, max(fixed.memoryFloor, fixed.memoryCeiling));
+
+        fixed.minSliceBudget = max(GCScheduler::MIN_SLICE_MILLIS, fixed.minSliceBudget);
+        fixed.maxSliceBudget = max(fixed.minSliceBudget, fixed.maxSliceBudget);
+
+        fixed.minHeapGrowth = max<uint32_t>(101, fixed.minHeapGrowth);
+        fixed.maxHeapGrowth = max(fixed.minHeapGrowth, fixed.maxHeapGrowth);
+        fixed.lowFrequencyHeapGrowth = max<uint32_t>(101, fixed.lowFrequencyHeapGrowth);
+
+        fixed.highFrequencyHighLimit = max(fixed.highFrequencyLowLimit + 1, fixed.highFrequencyHighLimit);
+
+        presets[fixed.name] = fixed;
+    }
+
+    bool GCController::usePreset(const string &name)
+    {
+        auto found = presets.find(name);
+
+        if (found != presets.end())
+        {
+            preset = found->second;
+
+            if (enabled)
+            {
+                applyPreset();
+            }
+
+            return true;
+        }
+
+        return false;
+    }
+
+    vector<string> GCController::getPresetNames() const
+    {
+        vector<string> names;
+
+        for (auto &element : presets)
+        {
+            names.push_back(element.first);
+        }
+
+        return names;
+    }
+
+    bool GCController::update()
+    {
+        if (rt && enabled && (collectionCount > 0))
+        {
+            auto previousCount = adjustmentCount;
+
+            evaluate();
+            collectionCount = 0;
+
+            return adjustmentCount != previousCount;
+        }
+
+        return false;
+    }
+
+    // ---
+
+    /*
+     * THE STATIC PARAMETERS ARE SET AS-IS, AND THE ADAPTIVE ONES ARE BROUGHT WITHIN THE BOUNDS OF THE PRESET
+     */
+    void GCController::applyPreset()
+    {
+        string reason = "PRESET " + preset.name;
+
+        adjust(JSGC_HIGH_FREQUENCY_TIME_LIMIT, "JSGC_HIGH_FREQUENCY_TIME_LIMIT", preset.highFrequencyTimeLimit, reason);
+
+        /*
+         * THE LOW-LIMIT MUST REMAIN BELOW THE HIGH-LIMIT AT ANY TIME
+         */
+        if (preset.highFrequencyLowLimit >= JS_GetGCParameter(rt, JSGC_HIGH_FREQUENCY_HIGH_LIMIT))
+        {
+            adjust(JSGC_HIGH_FREQUENCY_HIGH_LIMIT, "JSGC_HIGH_FREQUENCY_HIGH_LIMIT", preset.highFrequencyHighLimit, reason);
+            adjust(JSGC_HIGH_FREQUENCY_LOW_LIMIT, "JSGC_HIGH_FREQUENCY_LOW_LIMIT", preset.highFrequencyLowLimit, reason);
+        }
+        else
+        {
+            adjust(JSGC_HIGH_FREQUENCY_LOW_LIMIT, "JSGC_HIGH_FREQUENCY_LOW_LIMIT", preset.highFrequencyLowLimit, reason);
+            adjust(JSGC_HIGH_FREQUENCY_HIGH_LIMIT, "JSGC_HIGH_FREQUENCY_HIGH_LIMIT", preset.highFrequencyHighLimit, reason);
+        }
+
+        adjust(JSGC_HIGH_FREQUENCY_HEAP_GROWTH_MIN, "JSGC_HIGH_FREQUENCY_HEAP_GROWTH_MIN", preset.minHeapGrowth, reason);
+        adjust(JSGC_LOW_FREQUENCY_HEAP_GROWTH, "JSGC_LOW_FREQUENCY_HEAP_GROWTH", preset.lowFrequencyHeapGrowth, reason);
+
+        uint32_t growth = JS_GetGCParameter(rt, JSGC_HIGH_FREQUENCY_HEAP_GROWTH_MAX);
+        adjust(JSGC_HIGH_FREQUENCY_HEAP_GROWTH_MAX, "JSGC_HIGH_FREQUENCY_HEAP_GROWTH_MAX", min(max(growth, preset.minHeapGrowth), preset.maxHeapGrowth), reason);
+
+        uint32_t maxBytes = JS_GetGCParameter(rt, JSGC_MAX_BYTES);
+        adjust(JSGC_MAX_BYTES, "JSGC_MAX_BYTES", min(max(maxBytes, toBytes(preset.memoryFloor)), toBytes(preset.memoryCeiling)), reason);
+
+        double maxBudget = min(preset.maxSliceBudget, preset.targetPause);
+        adjustBudget(min(max(scheduler.getBudget(), preset.minSliceBudget), maxBudget), reason);
+
+        adjust(JSGC_DYNAMIC_HEAP_GROWTH, "JSGC_DYNAMIC_HEAP_GROWTH", preset.dynamicHeapGrowth && (JS_GetGCParameter(rt, JSGC_MAX_BYTES) < toBytes(preset.memoryCeiling)), reason);
+        adjust(JSGC_DYNAMIC_MARK_SLICE, "JSGC_DYNAMIC_MARK_SLICE", preset.dynamicMarkSlice && (2 * scheduler.getBudget() <= preset.targetPause), reason);
+    }
+
+    void GCController::evaluate()
+    {
+        double peakPause = getPeakPause();
+        bool overTarget = peakPause > preset.targetPause * 1.25;
+        bool underTarget = (peakPause > 0) && (peakPause < preset.targetPause * 0.5);
+        bool highFrequency = (collectionInterval > 0) && (collectionInterval < preset.highFrequencyTimeLimit);
+
+        stringstream pauseReason;
+        pauseReason << "PAUSE " << peakPause << " MS " << (overTarget ? ">" : "<") << " TARGET " << preset.targetPause << " MS";
+
+        // ---
+
+        double budget = scheduler.getBudget();
+        double maxBudget = min(preset.maxSliceBudget, preset.targetPause);
+
+        if (overTarget && (budget > preset.minSliceBudget))
+        {
+            adjustBudget(max(preset.minSliceBudget, budget * 0.75), pauseReason.str());
+        }
+        else if (underTarget && (budget < maxBudget))
+        {
+            adjustBudget(min(maxBudget, budget * 1.25), pauseReason.str());
+        }
+
+        // ---
+
+        uint32_t growth = JS_GetGCParameter(rt, JSGC_HIGH_FREQUENCY_HEAP_GROWTH_MAX);
+
+        if (overTarget && (growth > preset.minHeapGrowth))
+        {
+            adjust(JSGC_HIGH_FREQUENCY_HEAP_GROWTH_MAX, "JSGC_HIGH_FREQUENCY_HEAP_GROWTH_MAX", max(preset.minHeapGrowth, uint32_t(growth * 0.85)), pauseReason.str());
+        }
+        else if (highFrequency && !overTarget && (growth < preset.maxHeapGrowth))
+        {
+            stringstream reason;
+            reason << "COLLECTING EVERY " << int(collectionInterval) << " MS | ALLOCATING " << formatMB(allocationRate) << "/S";
+
+            adjust(JSGC_HIGH_FREQUENCY_HEAP_GROWTH_MAX, "JSGC_HIGH_FREQUENCY_HEAP_GROWTH_MAX", min(preset.maxHeapGrowth, uint32_t(growth * 1.2)), reason.str());
+        }
+
+        // ---
+
+        uint64_t maxBytes = JS_GetGCParameter(rt, JSGC_MAX_BYTES); // I.E. NO OVERFLOW WHEN GROWING
+        uint64_t ceilingBytes = toBytes(preset.memoryCeiling);
+        uint64_t floorBytes = toBytes(preset.memoryFloor);
+
+        if ((bytesAfterCollection > maxBytes * 0.75) && (maxBytes < ceilingBytes))
+        {
+            auto target = min(ceilingBytes, ((maxBytes + maxBytes / 2) / MB + 1) * MB);
+            adjust(JSGC_MAX_BYTES, "JSGC_MAX_BYTES", uint32_t(target), "LIVE HEAP " + formatMB(bytesAfterCollection) + " > 75%");
+        }
+        else if ((bytesAfterCollection < maxBytes * 0.25) && (maxBytes > floorBytes))
+        {
+            auto target = max(floorBytes, ((maxBytes - maxBytes / 4) / MB) * MB);
+            adjust(JSGC_MAX_BYTES, "JSGC_MAX_BYTES", uint32_t(target), "LIVE HEAP " + formatMB(bytesAfterCollection) + " < 25%");
+        }
+
+        // ---
+
+        if (preset.dynamicHeapGrowth)
+        {
+            bool atCeiling = JS_GetGCParameter(rt, JSGC_MAX_BYTES) >= ceilingBytes;
+            adjust(JSGC_DYNAMIC_HEAP_GROWTH, "JSGC_DYNAMIC_HEAP_GROWTH", !atCeiling, atCeiling ? "MEMORY CEILING REACHED" : "BELOW MEMORY CEILING");
+        }
+
+        if (preset.dynamicMarkSlice)
+        {
+            bool fits = 2 * scheduler.getBudget() <= preset.targetPause;
+            adjust(JSGC_DYNAMIC_MARK_SLICE, "JSGC_DYNAMIC_MARK_SLICE", fits, fits ? "DOUBLED SLICE WITHIN TARGET" : "DOUBLED SLICE EXCEEDING TARGET");
+        }
+    }
+
+    /*
+     * THE LONGEST PAUSE SINCE THE PREVIOUS INVOCATION, OR ZERO
+     */
+    double GCController::getPeakPause()
+    {
+        auto pauseRing = GCTelemetry::getPauseRing();
+
+        if (pauseRing)
+        {
+            auto pushCount = pauseRing->getPushCount();
+            auto fresh = (pushCount >= pauseIndex) ? (pushCount - pauseIndex) : pushCount; // IN CASE GCTelemetry WAS RESET
+            pauseIndex = pushCount;
+
+            auto pauses = pauseRing->snapshot();
+            fresh = min<uint64_t>(fresh, pauses.size());
+
+            if (fresh > 0)
+            {
+                return *max_element(pauses.end() - fresh, pauses.end());
+            }
+        }
+
+        return 0;
+    }
+
+    /*
+     * ONLY THE CHANGES ACTUALLY APPLIED BY SPIDERMONKEY ARE RECORDED
+     */
+    bool GCController::adjust(JSGCParamKey key, const char *parameter, uint32_t value, const string &reason)
+    {
+        uint32_t previous = JS_GetGCParameter(rt, key);
+
+        if (value != previous)
+        {
+            JS_SetGCParameter(rt, key, value);
+            uint32_t applied = JS_GetGCParameter(rt, key);
+
+            if (applied != previous)
+            {
+                record(parameter, previous, applied, reason);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /*
+     * WHEN THE SCHEDULER IS DISABLED: THE BUDGET IS KEPT WITHIN BOUNDS, BUT JSGC_SLICE_TIME_BUDGET IS NOT AFFECTED (I.E. NOTHING TO RECORD)
+     */
+    bool GCController::adjustBudget(double millis, const string &reason)
+    {
+        uint32_t previous = JS_GetGCParameter(rt, JSGC_SLICE_TIME_BUDGET);
+        scheduler.setBudget(millis);
+        uint32_t applied = JS_GetGCParameter(rt, JSGC_SLICE_TIME_BUDGET);
+
+        if (scheduler.isEnabled() && (applied != previous))
+        {
+            record("JSGC_SLICE_TIME_BUDGET", previous, applied, reason);
+            return true;
+        }
+
+        return false;
+    }
+
+    void GCController::record(const char *parameter, uint32_t from, uint32_t to, const string &reason)
+    {
+        Adjustment adjustment;
+        adjustment.timestamp = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+        adjustment.parameter = parameter;
+        adjustment.from = from;
+        adjustment.to = to;
+        adjustment.reason = reason;
+
+        adjustments.push_back(adjustment);
+        adjustmentCount++;
+
+        while (adjustments.size() > HISTORY_SIZE)
+        {
+            adjustments.pop_front();
+        }
+
+        if (LOG_ADJUSTMENTS)
+        {
+            LOGI << "GCController: " << parameter << ": " << from << " -> " << to << " | " << reason << endl;
+        }
+    }
+
+    // ---
+
+    void GCController::gcCallback(JSRuntime *rt, JSGCStatus status)
+    {
+        auto now = chrono::steady_clock::now();
+
+        if (status == JSGC_BEGIN)
+        {
+            if (collected)
+            {
+                uint32_t bytes = JS_GetGCParameter(rt, JSGC_BYTES);
+                double seconds = chrono::duration<double>(now - lastCollectionEnd).count();
+
+                if (seconds > 0)
+                {
+                    allocationRate = (bytes > bytesAfterCollection) ? (bytes - bytesAfterCollection) / seconds : 0;
+                }
+
+                collectionInterval = chrono::duration<double, milli>(now - lastCollectionStart).count();
+            }
+
+            lastCollectionStart = now;
+        }
+        else if (status == JSGC_END)
+        {
+            bytesAfterCollection = JS_GetGCParameter(rt, JSGC_BYTES);
+            lastCollectionEnd = now;
+
+            collected = true;
+            collectionCount++;
+        }
+    }
+}
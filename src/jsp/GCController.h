@@ -0,0 +1,189 @@
+/*
+ * JSP: https://github.com/arielm/jsp
+ * COPYRIGHT (C) 2014-2015, ARIEL MALKA ALL RIGHTS RESERVED.
+ *
+ * THE FOLLOWING SOURCE-CODE IS DISTRIBUTED UNDER THE SIMPLIFIED BSD LICENSE:
+ * https://github.com/arielm/jsp/blob/master/LICENSE
+ */
+
+/*
+ * ADAPTIVE TUNING OF THE GC PARAMETERS (ONE GCController PER Manager, SEE Manager::getGCController)
+ *
+ * OBSERVATIONS, VIA JSP::addGCCallback AND GCTelemetry:
+ * - PAUSES (I.E. SLICES) SINCE THE LAST EVALUATION
+ * - LIVE HEAP (JSGC_BYTES AFTER THE LAST COLLECTION)
+ * - ALLOCATION RATE AND INTERVAL BETWEEN COLLECTIONS
+ *
+ * ADJUSTMENTS, WITHIN THE BOUNDS OF THE CURRENT PRESET, AIMING FOR targetPause AND memoryCeiling:
+ * - JSGC_SLICE_TIME_BUDGET (VIA GCScheduler::setBudget): SHRINKS WHEN THE PAUSES EXCEED THE TARGET, GROWS WHEN THEY ARE WELL BELOW
+ * - JSGC_HIGH_FREQUENCY_HEAP_GROWTH_MAX: SHRINKS WHEN THE PAUSES EXCEED THE TARGET, GROWS WHEN COLLECTING AT HIGH-FREQUENCY
+ * - JSGC_MAX_BYTES: GROWS (UP TO memoryCeiling) WHEN THE LIVE HEAP IS APPROACHING IT, SHRINKS WHEN THE LIVE HEAP IS FAR BELOW
+ * - JSGC_DYNAMIC_HEAP_GROWTH: DISABLED ONCE JSGC_MAX_BYTES HAS REACHED memoryCeiling
+ * - JSGC_DYNAMIC_MARK_SLICE: ENABLED ONLY WHEN A DOUBLED SLICE IS STILL WITHIN targetPause
+ * - THE HIGH-FREQUENCY THRESHOLDS AND JSGC_LOW_FREQUENCY_HEAP_GROWTH ARE SET AS-IS FROM THE PRESET
+ *
+ * EACH ADJUSTMENT IS LOGGED (SEE LOG_ADJUSTMENTS) AND KEPT IN HISTORY (SEE getAdjustments)
+ *
+ * THE EVALUATION TAKES PLACE IN update(), I.E. NEVER DURING A COLLECTION
+ *
+ * PRESETS (SIZES IN MB, TIMES IN MS, GROWTHS IN PERCENT, I.E. LIKE THE CORRESPONDING GC PARAMETERS) CAN BE LOADED
+ * FROM THE "gc.presets" ARRAY OF A JSON CONFIG, E.G.
+ *
+ * {
+ *   "gc": {
+ *     "presets": [{"name": "low-latency", "targetPause": 2, "memoryCeiling": 96, ...}]
+ *   }
+ * }
+ *
+ * USAGE:
+ *
+ * manager.getGCController().loadPresets(InputSource::getAsset("config.json"));
+ * manager.getGCController().usePreset("low-latency");
+ * manager.getGCController().setEnabled(true);
+ *
+ * manager.getGCController().update(); // ONCE PER FRAME, E.G. RIGHT AFTER GCScheduler::update()
+ */
+
+#pragma once
+
+#include "jsp/GCScheduler.h"
+
+#include "chronotext/InputSource.h"
+
+#include <map>
+
+namespace jsp
+{
+    class GCController
+    {
+    public:
+        static bool LOG_ADJUSTMENTS;
+        static size_t HISTORY_SIZE;
+
+        struct Preset
+        {
+            std::string name = "default";
+
+            double targetPause = 4;
+            uint32_t memoryCeiling = 64;
+            uint32_t memoryFloor = 8;
+
+            double minSliceBudget = 1;
+            double maxSliceBudget = 10;
+
+            uint32_t minHeapGrowth = 150;
+            uint32_t maxHeapGrowth = 300;
+            uint32_t lowFrequencyHeapGrowth = 150;
+
+            uint32_t highFrequencyTimeLimit = 1000;
+            uint32_t highFrequencyLowLimit = 10;
+            uint32_t highFrequencyHighLimit = 50;
+
+            bool dynamicHeapGrowth = true;
+            bool dynamicMarkSlice = true;
+        };
+
+        struct Adjustment
+        {
+            double timestamp; // SECONDS, SINCE THE CONTROLLER WAS ENABLED
+            const char *parameter;
+            uint32_t from;
+            uint32_t to;
+            std::string reason;
+        };
+
+        GCController(GCScheduler &scheduler);
+
+        void setEnabled(bool enabled);
+
+        bool isEnabled() const
+        {
+            return enabled;
+        }
+
+        /*
+         * RETURNS FALSE IF THE CONFIG CAN'T BE PARSED, OR IF IT DOES NOT CONTAIN A "gc.presets" ARRAY
+         *
+         * PRESETS WITH THE SAME NAME ARE REPLACED
+         */
+        bool loadPresets(chr::InputSource::Ref inputSource);
+        bool loadPresets(const std::string &json);
+
+        /*
+         * THE MEMORY BOUNDS ARE CLAMPED TO WHAT JSGC_MAX_BYTES CAN HOLD (I.E. 4095 MB)
+         */
+        void addPreset(const Preset &preset);
+
+        /*
+         * THE PRESET IS APPLIED IMMEDIATELY IF THE CONTROLLER IS ENABLED
+         *
+         * RETURNS FALSE IF THERE IS NO SUCH A PRESET
+         */
+        bool usePreset(const std::string &name);
+
+        const Preset& getPreset() const
+        {
+            return preset;
+        }
+
+        std::vector<std::string> getPresetNames() const;
+
+        /*
+         * TO BE INVOKED ONCE PER FRAME
+         *
+         * RETURNS TRUE IF SOME PARAMETER WAS ADJUSTED
+         */
+        bool update();
+
+        // ---
+
+        const std::deque<Adjustment>& getAdjustments() const
+        {
+            return adjustments;
+        }
+
+        uint32_t getAdjustmentCount() const
+        {
+            return adjustmentCount;
+        }
+
+        /*
+         * BYTES PER SECOND, BETWEEN THE LAST TWO COLLECTIONS
+         */
+        double getAllocationRate() const
+        {
+            return allocationRate;
+        }
+
+    protected:
+        GCScheduler &scheduler;
+
+        bool enabled = false;
+        Preset preset;
+        std::map<std::string, Preset> presets;
+
+        std::deque<Adjustment> adjustments;
+        uint32_t adjustmentCount = 0;
+
+        std::chrono::steady_clock::time_point startTime;
+        std::chrono::steady_clock::time_point lastCollectionStart;
+        std::chrono::steady_clock::time_point lastCollectionEnd;
+
+        bool collected = false;
+        uint32_t collectionCount = 0; // SINCE THE LAST EVALUATION
+        uint32_t bytesAfterCollection = 0;
+        double allocationRate = 0;
+        double collectionInterval = 0; // MILLISECONDS, BETWEEN THE STARTS OF THE LAST TWO COLLECTIONS
+        uint64_t pauseIndex = 0; // IN GCTelemetry's PauseRing
+
+        void applyPreset();
+        void evaluate();
+        double getPeakPause();
+
+        bool adjust(JSGCParamKey key, const char *parameter, uint32_t value, const std::string &reason);
+        bool adjustBudget(double millis, const std::string &reason);
+        void record(const char *parameter, uint32_t from, uint32_t to, const std::string &reason);
+
+        void gcCallback(JSRuntime *rt, JSGCStatus status);
+    };
+}
@@ -0,0 +1,220 @@
+/*
+ * JSP: https://github.com/arielm/jsp
+ * COPYRIGHT (C) 2014-2015, ARIEL MALKA ALL RIGHTS RESERVED.
+ *
+ * THE FOLLOWING SOURCE-CODE IS DISTRIBUTED UNDER THE SIMPLIFIED BSD LICENSE:
+ * https://github.com/arielm/jsp/blob/master/LICENSE
+ */
+
+#include "jsp/GCScheduler.h"
+#include "jsp/GCTelemetry.h"
+
+#include "chronotext/Log.h"
+
+using namespace std;
+
+namespace jsp
+{
+    size_t GCScheduler::HISTORY_SIZE = 64;
+    double GCScheduler::MIN_SLICE_MILLIS = 1;
+
+    void GCScheduler::setEnabled(bool enabled)
+    {
+        if (rt && (enabled != this->enabled))
+        {
+            this->enabled = enabled;
+
+            if (enabled)
+            {
+                startTime = chrono::steady_clock::now();
+
+                previousMode = JS_GetGCParameter(rt, JSGC_MODE);
+                previousSliceBudget = JS_GetGCParameter(rt, JSGC_SLICE_TIME_BUDGET);
+
+                JS_SetGCParameter(rt, JSGC_MODE, JSGC_MODE_INCREMENTAL);
+                JS_SetGCParameter(rt, JSGC_SLICE_TIME_BUDGET, uint32_t(budget));
+
+                fallbackReported = false;
+                isIncremental(); // I.E. REPORTING RIGHT AWAY IF INCREMENTAL GC IS ALREADY DISABLED
+            }
+            else
+            {
+                finishCycle();
+
+                JS_SetGCParameter(rt, JSGC_MODE, previousMode);
+                JS_SetGCParameter(rt, JSGC_SLICE_TIME_BUDGET, previousSliceBudget);
+            }
+        }
+    }
+
+    void GCScheduler::setBudget(double millis)
+    {
+        budget = max(millis, MIN_SLICE_MILLIS);
+
+        if (rt && enabled)
+        {
+            JS_SetGCParameter(rt, JSGC_SLICE_TIME_BUDGET, uint32_t(budget));
+        }
+    }
+
+    bool GCScheduler::update(double availableMillis)
+    {
+        if (rt && enabled)
+        {
+            double sliceBudget = (availableMillis < 0) ? budget : min(budget, availableMillis);
+
+            if (sliceBudget >= MIN_SLICE_MILLIS)
+            {
+                bool inProgress = IsIncrementalGCInProgress(rt);
+
+                if (inProgress || (isIncremental() && shouldStartCycle()))
+                {
+                    Slice slice;
+                    slice.timestamp = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+                    slice.budgetMillis = sliceBudget;
+                    slice.phase = getPhase();
+                    slice.cycleStarted = !inProgress;
+                    slice.bytesBefore = JS_GetGCParameter(rt, JSGC_BYTES);
+
+                    GCTelemetry::ReasonScope reason("SCHEDULED");
+                    auto sliceStart = chrono::steady_clock::now();
+
+                    if (inProgress)
+                    {
+                        PrepareForIncrementalGC(rt);
+                    }
+                    else
+                    {
+                        PrepareForFullGC(rt);
+                        cycleRequested = false;
+                    }
+
+                    IncrementalGC(rt, gcreason::API, int64_t(sliceBudget));
+
+                    slice.durationMillis = chrono::duration<double, milli>(chrono::steady_clock::now() - sliceStart).count();
+                    slice.cycleFinished = !IsIncrementalGCInProgress(rt);
+                    slice.bytesAfter = JS_GetGCParameter(rt, JSGC_BYTES);
+
+                    record(slice);
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    void GCScheduler::finishCycle()
+    {
+        if (rt && IsIncrementalGCInProgress(rt))
+        {
+            PrepareForIncrementalGC(rt);
+            FinishIncrementalGC(rt, gcreason::API);
+        }
+    }
+
+    bool GCScheduler::isCollecting() const
+    {
+        return rt && IsIncrementalGCInProgress(rt);
+    }
+
+    /*
+     * WITHOUT INCREMENTAL GC, EACH SCHEDULED "SLICE" WOULD BE A FULL NON-INCREMENTAL COLLECTION
+     */
+    bool GCScheduler::isIncremental() const
+    {
+        if (rt && IsIncrementalGCEnabled(rt))
+        {
+            return true;
+        }
+
+        if (!fallbackReported)
+        {
+            LOGI << "GCScheduler: INCREMENTAL GC IS DISABLED | FALLING BACK TO NON-SCHEDULED GC" << endl;
+            fallbackReported = true;
+        }
+
+        return false;
+    }
+
+    GCScheduler::Phase GCScheduler::getPhase() const
+    {
+        if (isCollecting())
+        {
+#if defined(JSP_USE_PRIVATE_APIS)
+            switch (rt->gcIncrementalState)
+            {
+                case js::gc::MARK_ROOTS:
+                    return PHASE_MARK_ROOTS;
+
+                case js::gc::MARK:
+                    return PHASE_MARK;
+
+                case js::gc::SWEEP:
+                    return PHASE_SWEEP;
+
+                default:
+                    break;
+            }
+#endif
+            return PHASE_INCREMENTAL;
+        }
+
+        return PHASE_IDLE;
+    }
+
+    const char* GCScheduler::getPhaseName(Phase phase)
+    {
+        switch (phase)
+        {
+            case PHASE_INCREMENTAL:
+                return "INCREMENTAL";
+
+            case PHASE_MARK_ROOTS:
+                return "MARK_ROOTS";
+
+            case PHASE_MARK:
+                return "MARK";
+
+            case PHASE_SWEEP:
+                return "SWEEP";
+
+            default:
+                return "IDLE";
+        }
+    }
+
+    void GCScheduler::clearHistory()
+    {
+        history.clear();
+
+        sliceCount = 0;
+        cycleCount = 0;
+        maxSliceMillis = 0;
+    }
+
+    // ---
+
+    bool GCScheduler::shouldStartCycle() const
+    {
+        return cycleRequested || (JS_GetGCParameter(rt, JSGC_BYTES) >= triggerRatio * JS_GetGCParameter(rt, JSGC_MAX_BYTES));
+    }
+
+    void GCScheduler::record(const Slice &slice)
+    {
+        history.push_back(slice);
+
+        while (history.size() > HISTORY_SIZE)
+        {
+            history.pop_front();
+        }
+
+        sliceCount++;
+        maxSliceMillis = max(maxSliceMillis, slice.durationMillis);
+
+        if (slice.cycleFinished)
+        {
+            cycleCount++;
+        }
+    }
+}
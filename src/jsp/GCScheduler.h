@@ -0,0 +1,182 @@
+/*
+ * JSP: https://github.com/arielm/jsp
+ * COPYRIGHT (C) 2014-2015, ARIEL MALKA ALL RIGHTS RESERVED.
+ *
+ * THE FOLLOWING SOURCE-CODE IS DISTRIBUTED UNDER THE SIMPLIFIED BSD LICENSE:
+ * https://github.com/arielm/jsp/blob/master/LICENSE
+ */
+
+/*
+ * INCREMENTAL GC, DRIVEN PER FRAME (ONE GCScheduler PER Manager, SEE Manager::getGCScheduler)
+ *
+ * WITHOUT SCHEDULER: SPIDERMONKEY IS COLLECTING NON-INCREMENTALLY, WHENEVER THE HEAP IS CROSSING ITS TRIGGER,
+ * I.E. AT ANY POINT OF THE FRAME (TYPICALLY: 20-50 MS SPIKES)
+ *
+ * WITH SCHEDULER:
+ * - JSGC_MODE_INCREMENTAL IS SET, AND JSGC_SLICE_TIME_BUDGET IS MATCHING THE BUDGET (I.E. FOR THE SLICES TRIGGERED BY SPIDERMONKEY)
+ * - update() IS RUNNING A SLICE OF JS::IncrementalGC WHEN A CYCLE IS IN PROGRESS, OR WHEN THE HEAP IS CROSSING
+ *   triggerRatio * JSGC_MAX_BYTES (I.E. AHEAD OF SPIDERMONKEY'S OWN TRIGGER)
+ * - THE LAST SLICES ARE KEPT IN HISTORY (SEE HISTORY_SIZE)
+ *
+ * LIMITATIONS:
+ * - SLICES CAN EXCEED THEIR BUDGET (E.G. MARKING THE ROOTS, OR SWEEPING A LARGE ZONE)
+ * - INCREMENTAL GC CAN BE DISABLED BY SPIDERMONKEY (E.G. A JSClass WITH A TRACE-HOOK BUT WITHOUT JSCLASS_IMPLEMENTS_BARRIERS):
+ *   NO CYCLE IS STARTED BY update() IN SUCH A CASE, I.E. SPIDERMONKEY IS COLLECTING BY ITSELF, AS WITHOUT SCHEDULER
+ * - WITHOUT JSP_USE_PRIVATE_APIS: THE PHASE IS EITHER PHASE_IDLE OR PHASE_INCREMENTAL
+ *
+ * USAGE:
+ *
+ * manager.getGCScheduler().setEnabled(true);
+ * manager.getGCScheduler().setBudget(4);
+ *
+ * manager.getGCScheduler().update(frameSlackMillis); // ONCE PER FRAME, DURING IDLE TIME
+ */
+
+#pragma once
+
+#include "jsp/Context.h"
+
+#include <chrono>
+#include <deque>
+
+namespace jsp
+{
+    class GCScheduler
+    {
+    public:
+        static size_t HISTORY_SIZE;
+        static double MIN_SLICE_MILLIS;
+
+        enum Phase
+        {
+            PHASE_IDLE,
+            PHASE_INCREMENTAL, // IN PROGRESS, BUT THE EXACT PHASE IS UNKNOWN
+            PHASE_MARK_ROOTS,
+            PHASE_MARK,
+            PHASE_SWEEP
+        };
+
+        struct Slice
+        {
+            double timestamp; // SECONDS, SINCE THE SCHEDULER WAS ENABLED
+            double budgetMillis;
+            double durationMillis;
+
+            Phase phase; // WHEN THE SLICE STARTED
+            bool cycleStarted;
+            bool cycleFinished;
+
+            uint32_t bytesBefore;
+            uint32_t bytesAfter;
+        };
+
+        /*
+         * THE PREVIOUS JSGC_MODE AND JSGC_SLICE_TIME_BUDGET ARE RESTORED UPON DISABLING
+         */
+        void setEnabled(bool enabled);
+
+        bool isEnabled() const
+        {
+            return enabled;
+        }
+
+        /*
+         * MILLISECONDS PER FRAME
+         */
+        void setBudget(double millis);
+
+        double getBudget() const
+        {
+            return budget;
+        }
+
+        /*
+         * A NEW CYCLE IS STARTED WHEN JSGC_BYTES IS CROSSING triggerRatio * JSGC_MAX_BYTES
+         */
+        void setTriggerRatio(double ratio)
+        {
+            triggerRatio = ratio;
+        }
+
+        double getTriggerRatio() const
+        {
+            return triggerRatio;
+        }
+
+        /*
+         * A NEW CYCLE WILL BE STARTED UPON THE NEXT update(), REGARDLESS OF THE HEAP SIZE
+         */
+        void requestCycle()
+        {
+            cycleRequested = true;
+        }
+
+        /*
+         * TO BE INVOKED ONCE PER FRAME, DURING IDLE TIME
+         *
+         * availableMillis: THE FRAME SLACK (THE SLICE IS LIMITED TO THE SMALLEST OF THE BUDGET AND THE SLACK), OR NEGATIVE
+         *
+         * RETURNS TRUE IF A SLICE WAS RUN
+         */
+        bool update(double availableMillis = -1);
+
+        /*
+         * BLOCKING: FINISHES THE CYCLE IN PROGRESS, IF ANY
+         */
+        void finishCycle();
+
+        bool isCollecting() const;
+        Phase getPhase() const;
+
+        /*
+         * FALSE WHEN SPIDERMONKEY HAS DISABLED INCREMENTAL GC (SEE JS::IsIncrementalGCEnabled)
+         */
+        bool isIncremental() const;
+
+        static const char* getPhaseName(Phase phase);
+
+        // ---
+
+        const std::deque<Slice>& getHistory() const
+        {
+            return history;
+        }
+
+        void clearHistory();
+
+        uint32_t getSliceCount() const
+        {
+            return sliceCount;
+        }
+
+        uint32_t getCycleCount() const
+        {
+            return cycleCount;
+        }
+
+        double getMaxSliceMillis() const
+        {
+            return maxSliceMillis;
+        }
+
+    protected:
+        bool enabled = false;
+        double budget = 4;
+        double triggerRatio = 0.5;
+        bool cycleRequested = false;
+
+        uint32_t previousMode = JSGC_MODE_GLOBAL;
+        uint32_t previousSliceBudget = 0;
+        mutable bool fallbackReported = false;
+
+        std::deque<Slice> history;
+        uint32_t sliceCount = 0;
+        uint32_t cycleCount = 0;
+        double maxSliceMillis = 0;
+
+        std::chrono::steady_clock::time_point startTime;
+
+        bool shouldStartCycle() const;
+        void record(const Slice &slice);
+    };
+}
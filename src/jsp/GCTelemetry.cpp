@@ -0,0 +1,378 @@
+/*
+ * JSP: https://github.com/arielm/jsp
+ * COPYRIGHT (C) 2014-2015, ARIEL MALKA ALL RIGHTS RESERVED.
+ *
+ * THE FOLLOWING SOURCE-CODE IS DISTRIBUTED UNDER THE SIMPLIFIED BSD LICENSE:
+ * https://github.com/arielm/jsp/blob/master/LICENSE
+ */
+
+#include "jsp/GCTelemetry.h"
+#include "jsp/Proto.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace jsp
+{
+    void PauseRing::push(float millis)
+    {
+        auto index = pushCount.load(memory_order_relaxed);
+
+        slots[index % CAPACITY].store(millis, memory_order_relaxed);
+        pushCount.store(index + 1, memory_order_release);
+    }
+
+    /*
+     * THE SLOT AT INDEX end MAY BE BEING WRITTEN BY AN IN-FLIGHT PUSH (I.E. NOT YET PUBLISHED VIA pushCount):
+     * IT IS ALSO THE SLOT OF end - CAPACITY, WHICH IS THEREFORE NEVER COPIED
+     */
+    vector<float> PauseRing::snapshot() const
+    {
+        auto end = pushCount.load(memory_order_acquire);
+        auto begin = end - min<uint64_t>(end, CAPACITY - 1);
+
+        vector<float> result;
+        result.reserve(end - begin);
+
+        for (auto i = begin; i < end; i++)
+        {
+            result.push_back(slots[i % CAPACITY].load(memory_order_relaxed));
+        }
+
+        /*
+         * THE INDICES BELOW endAfter - (CAPACITY - 1) MAY HAVE BEEN OVERWRITTEN IN THE MEANTIME (INCLUDING BY AN IN-FLIGHT PUSH)
+         */
+        atomic_thread_fence(memory_order_acquire);
+        auto endAfter = pushCount.load(memory_order_relaxed);
+
+        if (endAfter > begin + (CAPACITY - 1))
+        {
+            auto overwritten = min<uint64_t>(endAfter - (CAPACITY - 1) - begin, result.size());
+            result.erase(result.begin(), result.begin() + overwritten);
+        }
+
+        return result;
+    }
+
+    // ---
+
+    double PauseHistogram::getUpperBound(int bucket)
+    {
+        return 0.25 * double(1 << bucket);
+    }
+
+    PauseHistogram::PauseHistogram()
+    {
+        clear();
+    }
+
+    void PauseHistogram::add(double millis)
+    {
+        int bucket = 0;
+
+        while ((bucket < BUCKET_COUNT - 1) && (millis > getUpperBound(bucket)))
+        {
+            bucket++;
+        }
+
+        counts[bucket].fetch_add(1, memory_order_relaxed);
+    }
+
+    void PauseHistogram::clear()
+    {
+        for (auto &count : counts)
+        {
+            count.store(0, memory_order_relaxed);
+        }
+    }
+
+    uint32_t PauseHistogram::getTotalCount() const
+    {
+        uint32_t total = 0;
+
+        for (auto &count : counts)
+        {
+            total += count.load(memory_order_relaxed);
+        }
+
+        return total;
+    }
+
+    double PauseHistogram::getPercentile(double p) const
+    {
+        uint32_t total = getTotalCount();
+
+        if (total > 0)
+        {
+            uint32_t accumulated = 0;
+
+            for (int bucket = 0; bucket < BUCKET_COUNT; bucket++)
+            {
+                accumulated += getCount(bucket);
+
+                if (accumulated >= p * total)
+                {
+                    return getUpperBound(bucket);
+                }
+            }
+        }
+
+        return 0;
+    }
+
+    // ---
+
+    size_t GCTelemetry::HISTORY_SIZE = 64;
+
+    thread_local GCTelemetry::Statics *GCTelemetry::statics = nullptr;
+    thread_local const char *GCTelemetry::reason = nullptr;
+
+    GCTelemetry::ReasonScope::ReasonScope(const char *reason)
+    :
+    previousReason(GCTelemetry::reason)
+    {
+        GCTelemetry::reason = reason;
+    }
+
+    GCTelemetry::ReasonScope::~ReasonScope()
+    {
+        GCTelemetry::reason = previousReason;
+    }
+
+    bool GCTelemetry::init()
+    {
+        if (!statics)
+        {
+            statics = new Statics;
+            statics->startTime = chrono::steady_clock::now();
+
+            JSP::addGCCallback(statics, BIND_STATIC2(GCTelemetry::gcCallback));
+            statics->previousSliceCallback = SetGCSliceCallback(rt, sliceCallback);
+
+            JS_DefineFunction(cx, globalHandle(), "getGCTelemetry", function_getGCTelemetry, 0, 0);
+        }
+
+        return bool(statics);
+    }
+
+    void GCTelemetry::uninit()
+    {
+        if (statics)
+        {
+            SetGCSliceCallback(rt, statics->previousSliceCallback);
+            JSP::removeGCCallback(statics);
+
+            delete statics;
+            statics = nullptr;
+        }
+    }
+
+    void GCTelemetry::reset()
+    {
+        if (statics)
+        {
+            statics->collections.clear();
+            statics->collectionCount = 0;
+
+            statics->pauseRing.clear();
+            statics->pauseHistogram.clear();
+        }
+    }
+
+    // ---
+
+    uint32_t GCTelemetry::getCollectionCount()
+    {
+        return statics ? statics->collectionCount : 0;
+    }
+
+    vector<GCTelemetry::Collection> GCTelemetry::getCollections()
+    {
+        if (statics)
+        {
+            return vector<Collection>(statics->collections.begin(), statics->collections.end());
+        }
+
+        return {};
+    }
+
+    double GCTelemetry::getRecentPausePercentile(double p)
+    {
+        if (statics)
+        {
+            auto pauses = statics->pauseRing.snapshot();
+
+            if (!pauses.empty())
+            {
+                sort(pauses.begin(), pauses.end());
+                return pauses[min<size_t>(pauses.size() - 1, p * pauses.size())];
+            }
+        }
+
+        return 0;
+    }
+
+    PauseRing* GCTelemetry::getPauseRing()
+    {
+        return statics ? &statics->pauseRing : nullptr;
+    }
+
+    PauseHistogram* GCTelemetry::getPauseHistogram()
+    {
+        return statics ? &statics->pauseHistogram : nullptr;
+    }
+
+    // ---
+
+    /*
+     * THE ORDER BETWEEN THE GC-CALLBACK AND THE SLICE-CALLBACK IS NOT GUARANTEED: THE FIRST ONE TO KICK-IN IS STARTING THE CYCLE,
+     * AND THE CYCLE IS COMMITTED ONCE BOTH OF THEM HAVE ENDED
+     */
+    void GCTelemetry::beginCycle(JSRuntime *rt)
+    {
+        if (!statics->inCycle)
+        {
+            statics->inCycle = true;
+            statics->engineEnded = false;
+            statics->slicesEnded = false;
+
+            statics->cycleStart = chrono::steady_clock::now();
+
+            statics->current = Collection();
+            statics->current.timestamp = chrono::duration<double>(statics->cycleStart - statics->startTime).count();
+            statics->current.reason = reason ? reason : "ENGINE";
+            statics->current.bytesBefore = JS_GetGCParameter(rt, JSGC_BYTES);
+        }
+    }
+
+    void GCTelemetry::commitCycle(JSRuntime *rt)
+    {
+        if (statics->inCycle && statics->engineEnded && statics->slicesEnded)
+        {
+            statics->current.durationMillis = chrono::duration<double, milli>(chrono::steady_clock::now() - statics->cycleStart).count();
+            statics->current.bytesAfter = JS_GetGCParameter(rt, JSGC_BYTES);
+
+            statics->collections.push_back(statics->current);
+            statics->collectionCount++;
+
+            while (statics->collections.size() > HISTORY_SIZE)
+            {
+                statics->collections.pop_front();
+            }
+
+            statics->inCycle = false;
+        }
+    }
+
+    void GCTelemetry::gcCallback(JSRuntime *rt, JSGCStatus status)
+    {
+        if (status == JSGC_BEGIN)
+        {
+            beginCycle(rt);
+        }
+        else if (status == JSGC_END)
+        {
+            statics->engineEnded = true;
+            commitCycle(rt);
+        }
+    }
+
+    void GCTelemetry::sliceCallback(JSRuntime *rt, GCProgress progress, const GCDescription &desc)
+    {
+        switch (progress)
+        {
+            case GC_CYCLE_BEGIN:
+            case GC_SLICE_BEGIN:
+            {
+                beginCycle(rt);
+                statics->sliceStart = chrono::steady_clock::now();
+                break;
+            }
+
+            case GC_SLICE_END:
+            case GC_CYCLE_END:
+            {
+                double pause = chrono::duration<double, milli>(chrono::steady_clock::now() - statics->sliceStart).count();
+
+                statics->pauseRing.push(pause);
+                statics->pauseHistogram.add(pause);
+
+                statics->current.sliceCount++;
+                statics->current.pauseMillis += pause;
+                statics->current.maxPauseMillis = max(statics->current.maxPauseMillis, pause);
+
+                if (progress == GC_CYCLE_END)
+                {
+                    statics->slicesEnded = true;
+                    commitCycle(rt);
+                }
+
+                break;
+            }
+        }
+
+        if (statics->previousSliceCallback)
+        {
+            statics->previousSliceCallback(rt, progress, desc);
+        }
+    }
+
+    // ---
+
+    bool GCTelemetry::function_getGCTelemetry(JSContext *cx, unsigned argc, Value *vp)
+    {
+        auto args = CallArgsFromVp(argc, vp);
+
+        auto defineNumber = [](HandleObject object, const char *name, double number)
+        {
+            return Proto::define(object, name, number, JSPROP_ENUMERATE);
+        };
+
+        auto collections = getCollections();
+
+        RootedObject result(cx, Proto::newPlainObject());
+        RootedObject pauses(cx, Proto::newPlainObject());
+        RootedObject array(cx, Proto::newArray(collections.size()));
+
+        if (!result || !pauses || !array)
+        {
+            return false;
+        }
+
+        defineNumber(pauses, "p50", getRecentPausePercentile(0.5));
+        defineNumber(pauses, "p95", getRecentPausePercentile(0.95));
+        defineNumber(pauses, "p99", getRecentPausePercentile(0.99));
+        defineNumber(pauses, "max", getRecentPausePercentile(1));
+
+        for (size_t i = 0; i < collections.size(); i++)
+        {
+            const auto &collection = collections[i];
+            RootedObject entry(cx, Proto::newPlainObject());
+
+            if (!entry
+                || !defineNumber(entry, "timestamp", collection.timestamp)
+                || !defineNumber(entry, "duration", collection.durationMillis)
+                || !defineNumber(entry, "pause", collection.pauseMillis)
+                || !defineNumber(entry, "maxPause", collection.maxPauseMillis)
+                || !defineNumber(entry, "bytesBefore", collection.bytesBefore)
+                || !defineNumber(entry, "bytesAfter", collection.bytesAfter)
+                || !defineNumber(entry, "slices", collection.sliceCount)
+                || !Proto::define(entry, "reason", collection.reason, JSPROP_ENUMERATE)
+                || !Proto::define(array, int(i), entry.get(), JSPROP_ENUMERATE))
+            {
+                return false;
+            }
+        }
+
+        if (!defineNumber(result, "count", getCollectionCount())
+            || !Proto::define(result, "pauses", pauses.get(), JSPROP_ENUMERATE)
+            || !Proto::define(result, "collections", array.get(), JSPROP_ENUMERATE))
+        {
+            return false;
+        }
+
+        args.rval().setObject(*result);
+        return true;
+    }
+}
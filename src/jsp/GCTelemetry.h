@@ -0,0 +1,189 @@
+/*
+ * JSP: https://github.com/arielm/jsp
+ * COPYRIGHT (C) 2014-2015, ARIEL MALKA ALL RIGHTS RESERVED.
+ *
+ * THE FOLLOWING SOURCE-CODE IS DISTRIBUTED UNDER THE SIMPLIFIED BSD LICENSE:
+ * https://github.com/arielm/jsp/blob/master/LICENSE
+ */
+
+/*
+ * GC TELEMETRY, FOR CORRELATING FRAME HITCHES WITH COLLECTIONS
+ *
+ * FOR EACH COLLECTION (SEE GCTelemetry::Collection):
+ * - TIMESTAMP, DURATION (FROM JSGC_BEGIN TO JSGC_END, VIA JSP::addGCCallback) AND REASON
+ * - JSGC_BYTES BEFORE AND AFTER
+ * - NUMBER OF SLICES AND PAUSE-TIME (VIA JS::SetGCSliceCallback: EACH SLICE IS A PAUSE)
+ *
+ * THE PAUSES OF EACH SLICE ARE ALSO FED TO:
+ * - A LOCK-FREE RING-BUFFER OF THE RECENT PAUSES (READABLE FROM ANY THREAD, E.G. BY A REPORTING THREAD)
+ * - A LOG-SCALE HISTOGRAM OF ALL THE PAUSES SINCE THE LAST reset()
+ *
+ * REASONS:
+ * - "API": JSP::forceGC()
+ * - "SCHEDULED": GCScheduler
+ * - "ENGINE": TRIGGERED BY SPIDERMONKEY ITSELF (E.G. ALLOCATION THRESHOLDS)
+ *
+ * JS SIDE: getGCTelemetry() IS RETURNING {count, pauses: {p50, p95, p99, max}, collections: [...]}
+ */
+
+#pragma once
+
+#include "jsp/Context.h"
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+
+namespace jsp
+{
+    /*
+     * SINGLE-WRITER (THE THREAD OF THE ENGINE), MULTIPLE READERS
+     */
+    class PauseRing
+    {
+    public:
+        static constexpr size_t CAPACITY = 256;
+
+        void push(float millis);
+
+        /*
+         * THE RECENT PAUSES (AT MOST CAPACITY - 1), FROM OLDEST TO NEWEST
+         *
+         * THE PAUSES OVERWRITTEN WHILE COPYING, AND THE SLOT OF A PUSH IN PROGRESS, ARE LEFT OUT
+         */
+        std::vector<float> snapshot() const;
+
+        uint64_t getPushCount() const
+        {
+            return pushCount.load(std::memory_order_acquire);
+        }
+
+        void clear()
+        {
+            pushCount.store(0, std::memory_order_release);
+        }
+
+    protected:
+        std::atomic<float> slots[CAPACITY];
+        std::atomic<uint64_t> pushCount {0};
+    };
+
+    class PauseHistogram
+    {
+    public:
+        /*
+         * UPPER-BOUNDS: 0.25 MS, 0.5 MS, 1 MS, ..., 4096 MS (THE LAST BUCKET IS UNBOUNDED)
+         */
+        static constexpr int BUCKET_COUNT = 16;
+        static double getUpperBound(int bucket);
+
+        PauseHistogram();
+
+        void add(double millis);
+        void clear();
+
+        uint32_t getCount(int bucket) const
+        {
+            return counts[bucket].load(std::memory_order_relaxed);
+        }
+
+        uint32_t getTotalCount() const;
+
+        /*
+         * APPROXIMATED BY THE UPPER-BOUND OF THE BUCKET CONTAINING THE PERCENTILE (E.G. 0.99)
+         */
+        double getPercentile(double p) const;
+
+    protected:
+        std::atomic<uint32_t> counts[BUCKET_COUNT];
+    };
+
+    // ---
+
+    class GCTelemetry
+    {
+    public:
+        static size_t HISTORY_SIZE;
+
+        struct Collection
+        {
+            double timestamp; // SECONDS, SINCE init()
+            double durationMillis; // INCLUDING THE TIME BETWEEN THE SLICES OF AN INCREMENTAL COLLECTION
+            double pauseMillis; // SUM OF THE SLICES
+            double maxPauseMillis;
+
+            const char *reason;
+            uint32_t bytesBefore;
+            uint32_t bytesAfter;
+            int sliceCount;
+        };
+
+        /*
+         * FOR TAGGING THE COLLECTIONS STARTED WITHIN THE SCOPE
+         */
+        struct ReasonScope
+        {
+            ReasonScope(const char *reason);
+            ~ReasonScope();
+
+            const char *previousReason;
+        };
+
+        static bool init();
+        static void uninit();
+
+        static void reset();
+
+        // ---
+
+        static uint32_t getCollectionCount();
+
+        /*
+         * THE LAST COLLECTIONS (SEE HISTORY_SIZE), FROM OLDEST TO NEWEST
+         */
+        static std::vector<Collection> getCollections();
+
+        /*
+         * EXACT, BASED ON THE RECENT PAUSES (SEE PauseRing)
+         */
+        static double getRecentPausePercentile(double p);
+
+        /*
+         * MUST NOT BE USED AFTER THE ENGINE IS SHUT-DOWN
+         */
+        static PauseRing* getPauseRing();
+        static PauseHistogram* getPauseHistogram();
+
+    protected:
+        struct Statics
+        {
+            std::deque<Collection> collections;
+            uint32_t collectionCount = 0;
+
+            PauseRing pauseRing;
+            PauseHistogram pauseHistogram;
+
+            std::chrono::steady_clock::time_point startTime;
+            std::chrono::steady_clock::time_point cycleStart;
+            std::chrono::steady_clock::time_point sliceStart;
+
+            Collection current;
+            bool inCycle = false;
+            bool engineEnded = false;
+            bool slicesEnded = false;
+
+            GCSliceCallback previousSliceCallback = nullptr;
+        };
+
+        static thread_local Statics *statics;
+        static thread_local const char *reason;
+
+        static void beginCycle(JSRuntime *rt);
+        static void commitCycle(JSRuntime *rt);
+
+        static void gcCallback(JSRuntime *rt, JSGCStatus status);
+        static void sliceCallback(JSRuntime *rt, GCProgress progress, const GCDescription &desc);
+
+        static bool function_getGCTelemetry(JSContext *cx, unsigned argc, Value *vp);
+    };
+}
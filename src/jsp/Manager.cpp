@@ -13,7 +13,10 @@
 
 #include "jsp/Manager.h"
 #include "jsp/Barker.h"
+#include "jsp/CompileTask.h"
+#include "jsp/GCTelemetry.h"
 #include "jsp/Proxy.h"
+#include "jsp/ScriptCache.h"
 
 #include "chronotext/utils/Utils.h"
 
@@ -27,9 +30,17 @@ namespace jsp
     size_t Manager::STACK_CHUNK_SIZE = 8192;
     size_t Manager::MAX_STACK_SIZE = 128 * sizeof(size_t) * 1024;
     
-    JSUseHelperThreads Manager::USE_HELPER_THREADS = JS_NO_HELPER_THREADS;
+    /*
+     * NECESSARY FOR OFF-MAIN-THREAD COMPILATION (SEE CompileTask)
+     */
+    JSUseHelperThreads Manager::USE_HELPER_THREADS = JS_USE_HELPER_THREADS;
     bool Manager::EXTRA_WARNINGS = true;
     
+    thread_local Manager* Manager::current = nullptr;
+    
+    mutex Manager::engineMutex;
+    int Manager::engineCount = 0;
+    
     const JSClass Manager::global_class =
     {
         "global",
@@ -172,13 +183,18 @@ namespace jsp
 
     bool Manager::init()
     {
-        if (!initialized)
+        if (!initialized && !current)
         {
             if (performInit())
             {
+                current = this;
+                
                 JS_DefineFunctions(cx, globalHandle(), global_functions);
                 
                 JSP::init();
+                GCTelemetry::init();
+                ScriptCache::init();
+                CompileTask::init();
                 Barker::init();
                 Proxy::init();
                 
@@ -191,29 +207,74 @@ namespace jsp
         return initialized;
     }
     
+    /*
+     * NO-OP WHEN NOT INVOKED ON THE THREAD OF THE ENGINE
+     */
     void Manager::shutdown()
     {
-        if (initialized)
+        if (initialized && (current == this))
         {
+            gcController.setEnabled(false);
+            gcScheduler.setEnabled(false);
+            gcScheduler.clearHistory();
+            
             Barker::uninit();
             Proxy::uninit();
+            CompileTask::uninit();
+            ScriptCache::uninit();
+            GCTelemetry::uninit();
             JSP::uninit();
 
             performShutdown();
             
             // ---
             
+            current = nullptr;
             initialized = false;
         }
     }
     
+    Manager* Manager::getCurrent()
+    {
+        return current;
+    }
+    
+    int Manager::getEngineCount()
+    {
+        lock_guard<mutex> lock(engineMutex);
+        return engineCount;
+    }
+    
+    bool Manager::acquireEngine()
+    {
+        lock_guard<mutex> lock(engineMutex);
+        
+        if ((engineCount > 0) || JS_Init())
+        {
+            engineCount++;
+            return true;
+        }
+        
+        return false;
+    }
+    
+    void Manager::releaseEngine()
+    {
+        lock_guard<mutex> lock(engineMutex);
+        
+        if (--engineCount == 0)
+        {
+            JS_ShutDown();
+        }
+    }
+    
     // ---
     
     bool Manager::performInit()
     {
         if (!rt && !cx)
         {
-            if (JS_Init())
+            if (acquireEngine())
             {
                 if (createRuntime())
                 {
@@ -228,6 +289,10 @@ namespace jsp
                         }
                     }
                 }
+                else
+                {
+                    releaseEngine();
+                }
             }
         }
         
@@ -252,7 +317,7 @@ namespace jsp
             JS_DestroyRuntime(rt);
             rt = nullptr;
             
-            JS_ShutDown();
+            releaseEngine();
         }
     }
     
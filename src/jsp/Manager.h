@@ -6,16 +6,42 @@
  * https://github.com/arielm/jsp/blob/master/LICENSE
  */
 
+/*
+ * ONE Manager PER ENGINE, I.E. PER THREAD:
+ *
+ * - init() AND shutdown() MUST BE INVOKED ON THE THREAD WHICH IS GOING TO USE THE ENGINE
+ * - THE RUNTIME, CONTEXT, GLOBAL-OBJECT AND THE STATICS OF JSP, Barker, Proxy, ScriptCache, CompileTask AND GCTelemetry ARE THREAD-LOCAL (SEE Context.h)
+ * - OBJECTS HOLDING GC-THINGS (E.G. PropertyKey, PeerClass, StructReader) MUST NOT BE SHARED BETWEEN ENGINES
+ * - JS_Init() AND JS_ShutDown() ARE INVOKED RESPECTIVELY WHEN THE FIRST ENGINE IS CREATED AND WHEN THE LAST ONE IS DESTROYED
+ *
+ * E.G. N ENGINES ON N THREADS:
+ *
+ * std::thread worker([]
+ * {
+ *     jsp::Manager manager;
+ *
+ *     if (manager.init())
+ *     {
+ *         Proto::executeScript(source);
+ *         manager.shutdown();
+ *     }
+ * });
+ */
+
 #pragma once
 
 #include "jsp/Context.h"
+#include "jsp/GCController.h"
+#include "jsp/GCScheduler.h"
+
+#include <mutex>
 
 namespace jsp
 {
     class Manager
     {
     public:
-        static uint32_t MAX_BYTES;
+        static uint32_t MAX_BYTES; // INITIAL VALUE: CAN BE ADJUSTED AT RUN-TIME (SEE GCController)
         static size_t STACK_CHUNK_SIZE;
         static size_t MAX_STACK_SIZE;
         
@@ -45,7 +71,39 @@ namespace jsp
         virtual bool createContext();
         virtual bool createGlobal();
         
+        bool isInitialized() const
+        {
+            return initialized;
+        }
+        
+        GCScheduler& getGCScheduler()
+        {
+            return gcScheduler;
+        }
+        
+        GCController& getGCController()
+        {
+            return gcController;
+        }
+        
+        /*
+         * THE Manager OF THE ENGINE RUNNING ON THE CURRENT THREAD, OR NULL
+         */
+        static Manager* getCurrent();
+        
+        static int getEngineCount();
+        
     protected:
         bool initialized = false;
+        GCScheduler gcScheduler;
+        GCController gcController {gcScheduler};
+        
+        static thread_local Manager *current;
+        
+        static std::mutex engineMutex;
+        static int engineCount;
+        
+        static bool acquireEngine();
+        static void releaseEngine();
     };
 }
@@ -0,0 +1,51 @@
+/*
+ * JSP: https://github.com/arielm/jsp
+ * COPYRIGHT (C) 2014-2015, ARIEL MALKA ALL RIGHTS RESERVED.
+ *
+ * THE FOLLOWING SOURCE-CODE IS DISTRIBUTED UNDER THE SIMPLIFIED BSD LICENSE:
+ * https://github.com/arielm/jsp/blob/master/LICENSE
+ */
+
+#include "jsp/MappedFile.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace ci;
+
+namespace jsp
+{
+    MappedFile::MappedFile(const fs::path &filePath)
+    {
+        int fd = open(filePath.string().data(), O_RDONLY);
+
+        if (fd != -1)
+        {
+            struct stat st;
+
+            if ((fstat(fd, &st) == 0) && (st.st_size > 0))
+            {
+                void *mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+                if (mapped != MAP_FAILED)
+                {
+                    data = mapped;
+                    dataSize = st.st_size;
+                }
+            }
+
+            close(fd); // THE MAPPING REMAINS VALID AFTER CLOSING
+        }
+    }
+
+    MappedFile::~MappedFile()
+    {
+        if (data)
+        {
+            munmap(data, dataSize);
+        }
+    }
+}
@@ -0,0 +1,50 @@
+/*
+ * JSP: https://github.com/arielm/jsp
+ * COPYRIGHT (C) 2014-2015, ARIEL MALKA ALL RIGHTS RESERVED.
+ *
+ * THE FOLLOWING SOURCE-CODE IS DISTRIBUTED UNDER THE SIMPLIFIED BSD LICENSE:
+ * https://github.com/arielm/jsp/blob/master/LICENSE
+ */
+
+/*
+ * READ-ONLY MEMORY-MAPPED FILE (POSIX: OSX, IOS AND ANDROID)
+ *
+ * - THE MAPPING IS RELEASED UPON DESTRUCTION
+ * - FILES EMBEDDED IN ANDROID ASSETS CAN'T BE MAPPED THIS WAY
+ */
+
+#pragma once
+
+#include "cinder/Filesystem.h"
+
+namespace jsp
+{
+    class MappedFile
+    {
+    public:
+        MappedFile(const ci::fs::path &filePath);
+        ~MappedFile();
+
+        bool isValid() const
+        {
+            return data != nullptr;
+        }
+
+        const void* getData() const
+        {
+            return data;
+        }
+
+        size_t getDataSize() const
+        {
+            return dataSize;
+        }
+
+    protected:
+        void *data = nullptr;
+        size_t dataSize = 0;
+
+        MappedFile(const MappedFile &other) = delete;
+        void operator=(const MappedFile &other) = delete;
+    };
+}
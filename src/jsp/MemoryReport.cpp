@@ -0,0 +1,291 @@
+/*
+ * JSP: https://github.com/arielm/jsp
+ * COPYRIGHT (C) 2014-2015, ARIEL MALKA ALL RIGHTS RESERVED.
+ *
+ * THE FOLLOWING SOURCE-CODE IS DISTRIBUTED UNDER THE SIMPLIFIED BSD LICENSE:
+ * https://github.com/arielm/jsp/blob/master/LICENSE
+ */
+
+#include "jsp/MemoryReport.h"
+#include "jsp/Barker.h"
+#include "jsp/CloneBuffer.h"
+#include "jsp/Proxy.h"
+#include "jsp/ScriptCache.h"
+
+#include "js/MemoryMetrics.h"
+
+#include "chronotext/Exception.h"
+#include "chronotext/utils/Utils.h"
+
+#if defined(__APPLE__)
+#   include <malloc/malloc.h>
+#else
+#   include <malloc.h>
+#endif
+
+using namespace std;
+
+namespace jsp
+{
+    static size_t mallocSizeOf(const void *ptr)
+    {
+#if defined(__APPLE__)
+        return malloc_size(ptr);
+#else
+        return malloc_usable_size(const_cast<void*>(ptr));
+#endif
+    }
+
+    /*
+     * initExtraCompartmentStats() IS INVOKED IN THE SAME ORDER AS THE COMPARTMENTS ARE APPENDED TO compartmentStatsVector
+     */
+    class RuntimeStats : public JS::RuntimeStats
+    {
+    public:
+        vector<string> compartmentNames;
+
+        RuntimeStats()
+        :
+        JS::RuntimeStats(mallocSizeOf)
+        {}
+
+        void initExtraZoneStats(JS::Zone *zone, JS::ZoneStats *zStats) override
+        {
+            zStats->extra = nullptr;
+        }
+
+        void initExtraCompartmentStats(JSCompartment *c, JS::CompartmentStats *cStats) override
+        {
+            cStats->extra = nullptr;
+
+            if (c == js::GetObjectCompartment(global))
+            {
+                compartmentNames.emplace_back("global");
+            }
+            else
+            {
+                compartmentNames.emplace_back("compartment #" + ci::toString(compartmentNames.size()));
+            }
+        }
+    };
+
+    // ---
+
+    size_t MemoryReport::Compartment::getTotal() const
+    {
+        return objectsOrdinary + objectsFunction + objectsArray + objectsWrapper + objectsSlots + objectsPrivate + shapes + scripts + jitData + other;
+    }
+
+    size_t MemoryReport::Overhead::getTotal() const
+    {
+        return tracerBytes + barkerBytes + proxyBytes + scriptCacheBytes + cloneBufferBytes;
+    }
+
+    MemoryReport MemoryReport::collect()
+    {
+        RuntimeStats stats;
+
+        if (!JS::CollectRuntimeStats(rt, &stats, nullptr, false))
+        {
+            throw EXCEPTION(MemoryReport, "COLLECTION FAILED");
+        }
+
+        MemoryReport report;
+
+        report.runtime.gcHeapChunkTotal = stats.gcHeapChunkTotal;
+        report.runtime.gcHeapGCThings = stats.gcHeapGCThings;
+        report.runtime.gcHeapUnused = stats.gcHeapUnusedArenas + stats.gcHeapUnusedChunks;
+        report.runtime.gcHeapChunkAdmin = stats.gcHeapChunkAdmin;
+        report.runtime.gcHeapDecommitted = stats.gcHeapDecommittedArenas;
+
+        report.runtime.atomsTable = stats.runtime.atomsTable;
+        report.runtime.scriptSources = stats.runtime.scriptSources;
+        report.runtime.other = stats.runtime.object + stats.runtime.contexts + stats.runtime.temporary + stats.runtime.interpreterStack;
+
+        report.runtime.ionCode = stats.runtime.code.ion;
+        report.runtime.baselineCode = stats.runtime.code.baseline;
+        report.runtime.regexpCode = stats.runtime.code.regexp;
+        report.runtime.otherCode = stats.runtime.code.other;
+        report.runtime.unusedCode = stats.runtime.code.unused;
+
+        for (auto &zStats : stats.zoneStatsVector)
+        {
+            report.zones.strings += zStats.stringInfo.gcHeap + zStats.stringInfo.mallocHeap;
+            report.zones.lazyScripts += zStats.lazyScriptsGCHeap + zStats.lazyScriptsMallocHeap;
+            report.zones.typeObjects += zStats.typeObjectsGCHeap + zStats.typeObjectsMallocHeap + zStats.typePool;
+            report.zones.jitCode += zStats.jitCodesGCHeap;
+            report.zones.unusedGCThings += zStats.unusedGCThings;
+            report.zones.arenaAdmin += zStats.gcHeapArenaAdmin;
+        }
+
+        for (size_t i = 0; i < stats.compartmentStatsVector.length(); i++)
+        {
+            const auto &cStats = stats.compartmentStatsVector[i];
+
+            Compartment compartment;
+            compartment.name = (i < stats.compartmentNames.size()) ? stats.compartmentNames[i] : "compartment #" + ci::toString(i);
+
+            compartment.objectsOrdinary = cStats.objectsGCHeapOrdinary;
+            compartment.objectsFunction = cStats.objectsGCHeapFunction;
+            compartment.objectsArray = cStats.objectsGCHeapDenseArray + cStats.objectsGCHeapSlowArray;
+            compartment.objectsWrapper = cStats.objectsGCHeapCrossCompartmentWrapper;
+            compartment.objectsSlots = cStats.objectsExtra.mallocHeapSlots + cStats.objectsExtra.mallocHeapElementsNonAsmJS;
+            compartment.objectsPrivate = cStats.objectsPrivate;
+
+            compartment.shapes =
+            cStats.shapesGCHeapTreeGlobalParented +
+            cStats.shapesGCHeapTreeNonGlobalParented +
+            cStats.shapesGCHeapDict +
+            cStats.shapesGCHeapBase +
+            cStats.shapesMallocHeapTreeTables +
+            cStats.shapesMallocHeapDictTables +
+            cStats.shapesMallocHeapTreeShapeKids +
+            cStats.shapesMallocHeapCompartmentTables;
+
+            compartment.scripts = cStats.scriptsGCHeap + cStats.scriptsMallocHeapData;
+            compartment.jitData = cStats.baselineData + cStats.baselineStubsFallback + cStats.baselineStubsOptimized + cStats.ionData;
+            compartment.other = cStats.compartmentObject + cStats.crossCompartmentWrappersTable + cStats.regexpCompartment + cStats.debuggeesSet;
+
+            compartment.other +=
+            cStats.typeInference.typeScripts +
+            cStats.typeInference.typeResults +
+            cStats.typeInference.pendingArrays +
+            cStats.typeInference.allocationSiteTables +
+            cStats.typeInference.arrayTypeTables +
+            cStats.typeInference.objectTypeTables;
+
+            report.compartments.push_back(compartment);
+        }
+
+        report.overhead.tracedCount = JSP::getTracedCount();
+        report.overhead.tracerBytes = JSP::getTracerByteSize();
+
+        report.overhead.barkerCount = Barker::getInstanceCount();
+        report.overhead.barkerBytes = Barker::getStaticsByteSize();
+
+        report.overhead.proxyCount = Proxy::getInstanceCount();
+        report.overhead.proxyBytes = Proxy::getStaticsByteSize();
+
+        report.overhead.scriptCacheCount = ScriptCache::getEntryCount();
+        report.overhead.scriptCacheBytes = ScriptCache::getByteSize();
+
+        report.overhead.cloneBufferCount = CloneBuffer::getLiveCount();
+        report.overhead.cloneBufferBytes = CloneBuffer::getLiveBytes();
+
+        return report;
+    }
+
+    // ---
+
+    /*
+     * NOT USING JSP::stringify() IN ORDER TO LEAVE THE MEASURED HEAP UNTOUCHED
+     */
+    string MemoryReport::toJSON() const
+    {
+        stringstream out;
+        bool first = true;
+
+        auto separate = [&]()
+        {
+            out << (first ? "\n" : ",\n");
+            first = false;
+        };
+
+        auto beginObject = [&](const char *indent, const char *name)
+        {
+            separate();
+            out << indent;
+
+            if (name)
+            {
+                out << "\"" << name << "\": ";
+            }
+
+            out << "{";
+            first = true;
+        };
+
+        auto endObject = [&](const char *indent)
+        {
+            out << "\n" << indent << "}";
+            first = false;
+        };
+
+        auto writeSize = [&](const char *indent, const char *name, size_t value)
+        {
+            separate();
+            out << indent << "\"" << name << "\": " << value;
+        };
+
+        out << "{";
+
+        beginObject("  ", "runtime");
+        writeSize("    ", "gcHeapChunkTotal", runtime.gcHeapChunkTotal);
+        writeSize("    ", "gcHeapGCThings", runtime.gcHeapGCThings);
+        writeSize("    ", "gcHeapUnused", runtime.gcHeapUnused);
+        writeSize("    ", "gcHeapChunkAdmin", runtime.gcHeapChunkAdmin);
+        writeSize("    ", "gcHeapDecommitted", runtime.gcHeapDecommitted);
+        writeSize("    ", "atomsTable", runtime.atomsTable);
+        writeSize("    ", "scriptSources", runtime.scriptSources);
+        writeSize("    ", "other", runtime.other);
+        writeSize("    ", "ionCode", runtime.ionCode);
+        writeSize("    ", "baselineCode", runtime.baselineCode);
+        writeSize("    ", "regexpCode", runtime.regexpCode);
+        writeSize("    ", "otherCode", runtime.otherCode);
+        writeSize("    ", "unusedCode", runtime.unusedCode);
+        endObject("  ");
+
+        beginObject("  ", "zones");
+        writeSize("    ", "strings", zones.strings);
+        writeSize("    ", "lazyScripts", zones.lazyScripts);
+        writeSize("    ", "typeObjects", zones.typeObjects);
+        writeSize("    ", "jitCode", zones.jitCode);
+        writeSize("    ", "unusedGCThings", zones.unusedGCThings);
+        writeSize("    ", "arenaAdmin", zones.arenaAdmin);
+        endObject("  ");
+
+        separate();
+        out << "  \"compartments\": [";
+        first = true;
+
+        for (const auto &compartment : compartments)
+        {
+            beginObject("    ", nullptr);
+            separate();
+            out << "      \"name\": \"" << compartment.name << "\""; // NO ESCAPING REQUIRED (SEE RuntimeStats)
+            writeSize("      ", "objectsOrdinary", compartment.objectsOrdinary);
+            writeSize("      ", "objectsFunction", compartment.objectsFunction);
+            writeSize("      ", "objectsArray", compartment.objectsArray);
+            writeSize("      ", "objectsWrapper", compartment.objectsWrapper);
+            writeSize("      ", "objectsSlots", compartment.objectsSlots);
+            writeSize("      ", "objectsPrivate", compartment.objectsPrivate);
+            writeSize("      ", "shapes", compartment.shapes);
+            writeSize("      ", "scripts", compartment.scripts);
+            writeSize("      ", "jitData", compartment.jitData);
+            writeSize("      ", "other", compartment.other);
+            writeSize("      ", "total", compartment.getTotal());
+            endObject("    ");
+        }
+
+        out << "\n  ]";
+        first = false;
+
+        beginObject("  ", "jsp");
+        writeSize("    ", "tracedCount", overhead.tracedCount);
+        writeSize("    ", "tracerBytes", overhead.tracerBytes);
+        writeSize("    ", "barkerCount", overhead.barkerCount);
+        writeSize("    ", "barkerBytes", overhead.barkerBytes);
+        writeSize("    ", "proxyCount", overhead.proxyCount);
+        writeSize("    ", "proxyBytes", overhead.proxyBytes);
+        writeSize("    ", "scriptCacheCount", overhead.scriptCacheCount);
+        writeSize("    ", "scriptCacheBytes", overhead.scriptCacheBytes);
+        writeSize("    ", "cloneBufferCount", overhead.cloneBufferCount);
+        writeSize("    ", "cloneBufferBytes", overhead.cloneBufferBytes);
+        writeSize("    ", "total", overhead.getTotal());
+        endObject("  ");
+
+        out << "\n}\n";
+
+        return out.str();
+    }
+}
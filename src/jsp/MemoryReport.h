@@ -0,0 +1,131 @@
+/*
+ * JSP: https://github.com/arielm/jsp
+ * COPYRIGHT (C) 2014-2015, ARIEL MALKA ALL RIGHTS RESERVED.
+ *
+ * THE FOLLOWING SOURCE-CODE IS DISTRIBUTED UNDER THE SIMPLIFIED BSD LICENSE:
+ * https://github.com/arielm/jsp/blob/master/LICENSE
+ */
+
+/*
+ * A SNAPSHOT OF THE MEMORY USED BY THE CURRENT ENGINE, VIA JS::CollectRuntimeStats
+ *
+ * - RUNTIME: GC-HEAP (CHUNKS, LIVE GC-THINGS, UNUSED ARENAS...), ATOMS, SCRIPT-SOURCES AND JIT-CODE (ION, BASELINE, REGEXP)
+ * - ZONES (SUMMED): STRINGS, LAZY-SCRIPTS, TYPE-OBJECTS AND JIT-CODE GC-THINGS
+ * - PER COMPARTMENT: OBJECTS (BY CLASS: ORDINARY, FUNCTION, ARRAY, CROSS-COMPARTMENT-WRAPPER), SHAPES, SCRIPTS AND JIT-DATA
+ * - JSP'S OWN OVERHEAD: TRACER REGISTRIES, Barker AND Proxy STATICS, ScriptCache AND CloneBuffer BUFFERS
+ *
+ * ALL THE SIZES ARE IN BYTES
+ *
+ * THE JSON OUTPUT (SEE toJSON) IS STABLE, I.E. TWO REPORTS CAN BE DIFFED OFFLINE
+ *
+ * LIMITATIONS:
+ * - WRITTEN AGAINST THE ESR31 LAYOUT OF js/MemoryMetrics.h (WHICH IS NOT A STABLE API)
+ * - THE "PER OBJECT CLASS" BREAKDOWN IS LIMITED TO THE CATEGORIES TRACKED BY ESR31
+ * - COMPARTMENTS ARE NOT NAMED BY SPIDERMONKEY: "global" IS THE COMPARTMENT OF THE GLOBAL OBJECT, THE OTHERS ARE NUMBERED
+ * - THE SIZE OF JSP'S STATICS IS APPROXIMATED
+ *
+ * USAGE:
+ *
+ * auto report = MemoryReport::collect();
+ * writeFile("memory.json", report.toJSON());
+ */
+
+#pragma once
+
+#include "jsp/Context.h"
+
+namespace jsp
+{
+    class MemoryReport
+    {
+    public:
+        struct Runtime
+        {
+            size_t gcHeapChunkTotal = 0;
+            size_t gcHeapGCThings = 0;
+            size_t gcHeapUnused = 0; // UNUSED ARENAS AND CHUNKS
+            size_t gcHeapChunkAdmin = 0;
+            size_t gcHeapDecommitted = 0;
+
+            size_t atomsTable = 0;
+            size_t scriptSources = 0;
+            size_t other = 0; // RUNTIME OBJECT, CONTEXTS, TEMPORARY, INTERPRETER-STACK...
+
+            size_t ionCode = 0;
+            size_t baselineCode = 0;
+            size_t regexpCode = 0;
+            size_t otherCode = 0;
+            size_t unusedCode = 0;
+        };
+
+        struct Zones
+        {
+            size_t strings = 0;
+            size_t lazyScripts = 0;
+            size_t typeObjects = 0;
+            size_t jitCode = 0; // JIT-CODE GC-THINGS (THE CODE ITSELF IS ACCOUNTED IN Runtime)
+            size_t unusedGCThings = 0;
+            size_t arenaAdmin = 0;
+        };
+
+        struct Compartment
+        {
+            std::string name;
+
+            size_t objectsOrdinary = 0;
+            size_t objectsFunction = 0;
+            size_t objectsArray = 0;
+            size_t objectsWrapper = 0;
+            size_t objectsSlots = 0; // MALLOC-HEAP SLOTS AND ELEMENTS
+            size_t objectsPrivate = 0;
+
+            size_t shapes = 0;
+            size_t scripts = 0;
+            size_t jitData = 0; // BASELINE AND ION DATA, BASELINE STUBS
+            size_t other = 0; // COMPARTMENT OBJECT AND TABLES, TYPE-INFERENCE...
+
+            size_t getTotal() const;
+        };
+
+        struct Overhead
+        {
+            size_t tracedCount = 0;
+            size_t tracerBytes = 0;
+
+            size_t barkerCount = 0;
+            size_t barkerBytes = 0;
+
+            size_t proxyCount = 0;
+            size_t proxyBytes = 0;
+
+            size_t scriptCacheCount = 0;
+            size_t scriptCacheBytes = 0;
+
+            size_t cloneBufferCount = 0; // ACROSS ALL THE ENGINES
+            size_t cloneBufferBytes = 0;
+
+            size_t getTotal() const;
+        };
+
+        Runtime runtime;
+        Zones zones;
+        std::vector<Compartment> compartments;
+        Overhead overhead;
+
+        /*
+         * THROWS UPON FAILURE
+         */
+        static MemoryReport collect();
+
+        std::string toJSON() const;
+
+        /*
+         * APPROXIMATED: std::map (AND std::set) NODES ARE MADE OF THE VALUE, 3 POINTERS AND A COLOR
+         */
+        template<typename M>
+        static size_t mapByteSize(const M &map)
+        {
+            return map.size() * (sizeof(typename M::value_type) + 4 * sizeof(void*));
+        }
+    };
+}
@@ -0,0 +1,311 @@
+/*
+ * JSP: https://github.com/arielm/jsp
+ * COPYRIGHT (C) 2014-2015, ARIEL MALKA ALL RIGHTS RESERVED.
+ *
+ * THE FOLLOWING SOURCE-CODE IS DISTRIBUTED UNDER THE SIMPLIFIED BSD LICENSE:
+ * https://github.com/arielm/jsp/blob/master/LICENSE
+ */
+
+/*
+ * NATIVE-CALLS, AS REGISTERED VIA Proxy::registerNativeCall()
+ *
+ * 1) "GENERIC": A std::function RECEIVING THE RAW CallArgs (AND CONVERTING THEM BY ITSELF)
+ *
+ * 2) "TYPED": A FUNCTION OR METHOD WITH A REGULAR C++ SIGNATURE, E.G.
+ *    double Entity::scale(double factor)
+ *
+ *    - THE INVOKER IS GENERATED AT COMPILE-TIME FOR THE GIVEN SIGNATURE
+ *    - EACH ARGUMENT IS CONVERTED ONCE (FAST-PATHS FOR INT32 AND DOUBLE, OTHERWISE VIA JSP::convertMaybe)
+ *    - A JS-ERROR IS REPORTED IF AN ARGUMENT CAN'T BE CONVERTED
+ *    - THE RETURN-VALUE (IF ANY) IS CONVERTED VIA JSP::toValue
+ *    - NO std::function, NO PER-CALL ALLOCATION
+ */
+
+#pragma once
+
+#include "jsp/Context.h"
+
+#include "mozilla/FloatingPoint.h"
+
+#include <cstring>
+#include <functional>
+#include <tuple>
+#include <type_traits>
+
+namespace jsp
+{
+    typedef std::function<bool(const CallArgs&)> NativeCallFnType;
+
+    struct NativeCall
+    {
+        /*
+         * THE INSTANCE IS PASSED SEPARATELY, ALLOWING THE SAME NativeCall TO BE SHARED BY SEVERAL INSTANCES (SEE PeerClass)
+         */
+        typedef bool (*InvokerType)(const NativeCall &nativeCall, void *instance, const CallArgs &args);
+
+        /*
+         * LARGE-ENOUGH FOR ANY MEMBER-FUNCTION POINTER (E.G. 2 POINTERS WITH THE ITANIUM C++ ABI)
+         */
+        static constexpr size_t TARGET_STORAGE_SIZE = 4 * sizeof(void*);
+
+        std::string name;
+        NativeCallFnType fn;
+
+        InvokerType invoker = nullptr;
+        void *instance = nullptr;
+        alignas(void*) char target[TARGET_STORAGE_SIZE];
+
+        NativeCall(const std::string &name, const NativeCallFnType &fn)
+        :
+        name(name),
+        fn(fn)
+        {}
+
+        template<typename T>
+        NativeCall(const std::string &name, InvokerType invoker, void *instance, const T &target)
+        :
+        name(name),
+        invoker(invoker),
+        instance(instance)
+        {
+            static_assert(sizeof(T) <= TARGET_STORAGE_SIZE, "UNSUPPORTED TARGET");
+            std::memcpy(this->target, &target, sizeof(T));
+        }
+
+        template<typename T>
+        T getTarget() const
+        {
+            T result;
+            std::memcpy(&result, target, sizeof(T));
+
+            return result;
+        }
+
+        bool isEmpty() const
+        {
+            return !fn && !invoker;
+        }
+
+        /*
+         * FOR INVOKING A TYPED NATIVE-CALL WHOSE STORAGE MAY BE REALLOCATED (OR CLEARED) DURING THE CALL
+         *
+         * THE NAME IS LEFT OUT, I.E. NO PER-CALL ALLOCATION
+         */
+        NativeCall copyInvoker() const
+        {
+            NativeCall copy("", nullptr);
+            copy.invoker = invoker;
+            copy.instance = instance;
+            std::memcpy(copy.target, target, TARGET_STORAGE_SIZE);
+
+            return copy;
+        }
+    };
+
+    // ---
+
+    template<typename T>
+    struct NativeCallArgument
+    {
+        inline static bool convert(HandleValue value, T &result)
+        {
+            return JSP::convertMaybe(value, result);
+        }
+    };
+
+    template<>
+    struct NativeCallArgument<int32_t>
+    {
+        inline static bool convert(HandleValue value, int32_t &result)
+        {
+            if (value.isInt32())
+            {
+                result = value.toInt32();
+                return true;
+            }
+
+            if (value.isDouble())
+            {
+                return mozilla::NumberEqualsInt32(value.toDouble(), &result); // I.E. -0 IS ACCEPTED AS 0, BUT NOT NaN, INFINITY OR OUT-OF-RANGE
+            }
+
+            return false;
+        }
+    };
+
+    template<>
+    struct NativeCallArgument<double>
+    {
+        inline static bool convert(HandleValue value, double &result)
+        {
+            if (value.isInt32())
+            {
+                result = value.toInt32();
+                return true;
+            }
+
+            if (value.isDouble())
+            {
+                result = value.toDouble();
+                return true;
+            }
+
+            return false;
+        }
+    };
+
+    template<>
+    struct NativeCallArgument<float>
+    {
+        inline static bool convert(HandleValue value, float &result)
+        {
+            double d;
+
+            if (NativeCallArgument<double>::convert(value, d))
+            {
+                result = float(d);
+                return true;
+            }
+
+            return false;
+        }
+    };
+
+    // ---
+
+    template<typename R>
+    struct NativeCallResult
+    {
+        template<typename F>
+        inline static bool set(const CallArgs &args, F &&fn)
+        {
+            const R result = fn();
+            args.rval().set(JSP::toValue<R>(result));
+
+            return true;
+        }
+    };
+
+    template<>
+    struct NativeCallResult<void>
+    {
+        template<typename F>
+        inline static bool set(const CallArgs &args, F &&fn)
+        {
+            fn();
+            args.rval().setUndefined();
+
+            return true;
+        }
+    };
+
+    // ---
+
+    template<size_t... I>
+    struct NativeCallIndices
+    {};
+
+    template<size_t N, size_t... I>
+    struct BuildNativeCallIndices : BuildNativeCallIndices<N - 1, N - 1, I...>
+    {};
+
+    template<size_t... I>
+    struct BuildNativeCallIndices<0, I...>
+    {
+        typedef NativeCallIndices<I...> type;
+    };
+
+    template<typename R, typename... Args>
+    class NativeCallInvoker
+    {
+    public:
+        /*
+         * B: THE TYPE THE INSTANCE WAS STORED AS (E.G. Proxy), BEFORE BEING CONVERTED TO void*
+         */
+        template<class C, typename M, class B = C>
+        static bool invokeMethod(const NativeCall &nativeCall, void *instance, const CallArgs &args)
+        {
+            Arguments arguments;
+
+            if (!convertArguments<0>(args, arguments))
+            {
+                return reportInvalidArguments(nativeCall);
+            }
+
+            auto target = static_cast<C*>(static_cast<B*>(instance));
+            auto method = nativeCall.getTarget<M>();
+
+            return NativeCallResult<R>::set(args, [&]() { return callMethod(target, method, arguments, Indices()); });
+        }
+
+        template<typename F>
+        static bool invokeFunction(const NativeCall &nativeCall, void *instance, const CallArgs &args)
+        {
+            Arguments arguments;
+
+            if (!convertArguments<0>(args, arguments))
+            {
+                return reportInvalidArguments(nativeCall);
+            }
+
+            auto function = nativeCall.getTarget<F>();
+
+            return NativeCallResult<R>::set(args, [&]() { return callFunction(function, arguments, Indices()); });
+        }
+
+    protected:
+        typedef std::tuple<typename std::decay<Args>::type...> Arguments;
+        typedef typename BuildNativeCallIndices<sizeof...(Args)>::type Indices;
+
+        template<size_t I>
+        static typename std::enable_if<(I < sizeof...(Args)), bool>::type convertArguments(const CallArgs &args, Arguments &arguments)
+        {
+            typedef typename std::tuple_element<I, Arguments>::type T;
+
+            return NativeCallArgument<T>::convert(args.get(I), std::get<I>(arguments)) && convertArguments<I + 1>(args, arguments);
+        }
+
+        template<size_t I>
+        static typename std::enable_if<(I == sizeof...(Args)), bool>::type convertArguments(const CallArgs &args, Arguments &arguments)
+        {
+            return true;
+        }
+
+        template<class C, typename M, size_t... I>
+        static R callMethod(C *instance, M method, Arguments &arguments, NativeCallIndices<I...>)
+        {
+            return (instance->*method)(std::get<I>(arguments)...);
+        }
+
+        template<typename F, size_t... I>
+        static R callFunction(F function, Arguments &arguments, NativeCallIndices<I...>)
+        {
+            return function(std::get<I>(arguments)...);
+        }
+
+        static bool reportInvalidArguments(const NativeCall &nativeCall)
+        {
+            JS_ReportError(cx, "%s: INVALID ARGUMENTS", nativeCall.name.data());
+            return false;
+        }
+    };
+
+    // ---
+
+    /*
+     * METHODS RECEIVING THE RAW CallArgs
+     */
+    template<class C, class B = C>
+    struct NativeCallRawInvoker
+    {
+        typedef bool (C::*M)(const CallArgs&);
+
+        static bool invokeMethod(const NativeCall &nativeCall, void *instance, const CallArgs &args)
+        {
+            auto target = static_cast<C*>(static_cast<B*>(instance));
+            auto method = nativeCall.getTarget<M>();
+
+            return (target->*method)(args);
+        }
+    };
+}
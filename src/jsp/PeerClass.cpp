@@ -0,0 +1,222 @@
+/*
+ * JSP: https://github.com/arielm/jsp
+ * COPYRIGHT (C) 2014-2015, ARIEL MALKA ALL RIGHTS RESERVED.
+ *
+ * THE FOLLOWING SOURCE-CODE IS DISTRIBUTED UNDER THE SIMPLIFIED BSD LICENSE:
+ * https://github.com/arielm/jsp/blob/master/LICENSE
+ */
+
+#include "jsp/PeerClass.h"
+#include "jsp/Proxy.h"
+
+using namespace std;
+using namespace JS;
+
+namespace jsp
+{
+    PeerClass::PeerClass(const PeerClass &other)
+    :
+    methods(other.methods)
+    {}
+
+    /*
+     * THE FUNCTIONS OF THE PROTOTYPE MAY OUTLIVE THE PeerClass: THEIR RESERVED-SLOT 1 (POINTING TO THE PeerClass) IS CLEARED
+     */
+    PeerClass::~PeerClass()
+    {
+        if (hasPrototype())
+        {
+            RootedObject object(cx, prototype.get());
+            RootedValue value(cx);
+
+            for (auto &method : methods)
+            {
+                if (JS_GetProperty(cx, object, method.name.data(), &value) && value.isObject())
+                {
+                    SetFunctionNativeReserved(&value.toObject(), 1, UndefinedValue());
+                }
+            }
+        }
+
+        resetPrototype();
+    }
+
+    /*
+     * IF THE PROTOTYPE ALREADY EXISTS: THE METHOD IS DEFINED ON IT
+     */
+    PeerClass& PeerClass::addMethod(const NativeCall &method)
+    {
+        methods.push_back(method);
+
+        if (hasPrototype())
+        {
+            RootedObject object(cx, prototype.get());
+
+            if (!defineMethod(object, methods.size() - 1))
+            {
+                resetPrototype(); // I.E. TO BE RE-CREATED UPON NEXT newPeer()
+            }
+        }
+
+        return *this;
+    }
+
+    JSObject* PeerClass::newPeer(Proxy *instance)
+    {
+        if (hasPrototype() || createPrototype())
+        {
+            RootedObject proto(cx, prototype.get());
+            JSObject *peer = JS_NewObject(cx, &clazz, proto, NullPtr());
+
+            if (peer)
+            {
+                JS_SetReservedSlot(peer, 0, PrivateValue(instance));
+                return peer;
+            }
+        }
+
+        return nullptr;
+    }
+
+    Proxy* PeerClass::getInstance(JSObject *peer)
+    {
+        if (peer && (JS_GetClass(peer) == &clazz))
+        {
+            const Value &value = JS_GetReservedSlot(peer, 0);
+
+            if (!value.isUndefined())
+            {
+                return static_cast<Proxy*>(value.toPrivate());
+            }
+        }
+
+        return nullptr;
+    }
+
+    void PeerClass::detach(JSObject *peer)
+    {
+        if (peer && (JS_GetClass(peer) == &clazz))
+        {
+            JS_SetReservedSlot(peer, 0, UndefinedValue());
+        }
+    }
+
+    // ---
+
+    bool PeerClass::hasPrototype() const
+    {
+        return prototype && (prototypeGeneration == JSP::getGeneration());
+    }
+
+    /*
+     * THE PROTOTYPE MAY BE CREATED IN THE NURSERY: Heap<WrappedObject> TAKES CARE OF THE POST-BARRIER AND OF THE TRACING
+     */
+    bool PeerClass::createPrototype()
+    {
+        resetPrototype();
+
+        RootedObject object(cx, JS_NewObject(cx, nullptr, NullPtr(), NullPtr()));
+
+        if (!object)
+        {
+            return false;
+        }
+
+        for (size_t i = 0; i < methods.size(); i++)
+        {
+            if (!defineMethod(object, i))
+            {
+                return false;
+            }
+        }
+
+        prototype = object.get();
+        prototypeGeneration = JSP::getGeneration();
+
+        return true;
+    }
+
+    bool PeerClass::defineMethod(HandleObject object, size_t index)
+    {
+        auto function = DefineFunctionWithReserved(cx, object, methods[index].name.data(), forwardMethodCall, 0, JSPROP_ENUMERATE | JSPROP_READONLY | JSPROP_PERMANENT);
+
+        if (function)
+        {
+            SetFunctionNativeReserved(function, 0, Int32Value(index));
+            SetFunctionNativeReserved(function, 1, PrivateValue(this));
+
+            return true;
+        }
+
+        return false;
+    }
+
+    /*
+     * A PROTOTYPE BELONGING TO A PREVIOUS RUNTIME (E.G. STATICS DESTROYED AFTER JSP::uninit) IS FORGOTTEN WITHOUT ANY BARRIER
+     */
+    void PeerClass::resetPrototype()
+    {
+        if (prototypeGeneration == JSP::getGeneration())
+        {
+            prototype = nullptr;
+        }
+        else
+        {
+            *prototype.unsafeGet() = static_cast<JSObject*>(nullptr);
+        }
+    }
+
+    // ---
+
+    /*
+     * PEERS ARE CREATED IN THE NURSERY, LIKE ANY OTHER "PLAIN" JS-OBJECT (I.E. NO FINALIZER, SEE Barker::clazz)
+     */
+    const JSClass PeerClass::clazz =
+    {
+        "Peer",
+        JSCLASS_HAS_RESERVED_SLOTS(1),
+        JS_PropertyStub,
+        JS_DeletePropertyStub,
+        JS_PropertyStub,
+        JS_StrictPropertyStub,
+        JS_EnumerateStub,
+        JS_ResolveStub,
+        JS_ConvertStub,
+        nullptr,/*finalize*/
+        nullptr,
+        nullptr,
+        nullptr,
+        nullptr
+    };
+
+    /*
+     * THE PeerClass OF THE Proxy MUST BE THE ONE OF THE FUNCTION, E.G. NOT THE CASE WITH: Entity.prototype.scale.call(someOtherPeer)
+     */
+    bool PeerClass::forwardMethodCall(JSContext *cx, unsigned argc, Value *vp)
+    {
+        auto args = CallArgsFromVp(argc, vp);
+        auto function = &args.callee().as<JSFunction>();
+
+        const Value &peerClassValue = GetFunctionNativeReserved(function, 1);
+
+        if (args.thisv().isObject() && !peerClassValue.isUndefined()) // I.E. NOT DETACHED FROM ITS PeerClass
+        {
+            auto proxy = getInstance(&args.thisv().toObject());
+
+            if (proxy)
+            {
+                auto peerClass = static_cast<PeerClass*>(peerClassValue.toPrivate());
+                auto index = size_t(GetFunctionNativeReserved(function, 0).toInt32());
+
+                if ((proxy->getPeerClass() == peerClass) && (index < peerClass->methods.size()))
+                {
+                    const auto method = peerClass->methods[index].copyInvoker(); // I.E. THE METHOD CAN ADD METHODS (REALLOCATING methods)
+                    return method.invoker(method, proxy, args);
+                }
+            }
+        }
+
+        JS_ReportError(cx, "PeerClass: INCOMPATIBLE OR DETACHED PEER");
+        return false;
+    }
+}
@@ -0,0 +1,114 @@
+/*
+ * JSP: https://github.com/arielm/jsp
+ * COPYRIGHT (C) 2014-2015, ARIEL MALKA ALL RIGHTS RESERVED.
+ *
+ * THE FOLLOWING SOURCE-CODE IS DISTRIBUTED UNDER THE SIMPLIFIED BSD LICENSE:
+ * https://github.com/arielm/jsp/blob/master/LICENSE
+ */
+
+/*
+ * NATIVE METHODS DECLARED ONCE PER Proxy SUBCLASS, ON A PROTOTYPE SHARED BY ALL THE PEERS
+ *
+ * IN THE SPIRIT OF JS_InitClass (SEE Barker::init), BUT:
+ * - WITHOUT ANY GLOBAL CONSTRUCTOR
+ * - WITH TYPED METHODS (SEE NativeCall.h)
+ *
+ * COMPARED TO Proxy::registerNativeCall(), WHICH IS CREATING ONE FUNCTION PER METHOD AND PER INSTANCE:
+ * - ONE FUNCTION PER METHOD, FOR ALL THE INSTANCES (E.G. 20 INSTEAD OF 1,000,000 WITH 50K INSTANCES AND 20 METHODS)
+ * - THE Proxy IS STORED IN THE (ONLY) RESERVED-SLOT OF ITS PEER, AND RESET WHEN THE Proxy IS DESTROYED
+ *
+ * - THE PROTOTYPE IS CREATED LAZILY (I.E. A PeerClass CAN BE DECLARED STATICALLY, BEFORE THE RUNTIME EXISTS)
+ * - METHODS ADDED AFTER THE CREATION OF THE PROTOTYPE ARE DEFINED ON IT (I.E. EXISTING PEERS ARE AFFECTED)
+ * - THE FUNCTIONS ARE DETACHED FROM THE PeerClass WHEN IT IS DESTROYED (I.E. CALLING THEM REPORTS A JS-ERROR)
+ * - COPIES ARE NOT SHARING THEIR PROTOTYPE
+ * - THE PROTOTYPE BELONGS TO A SINGLE ENGINE (I.E. A STATIC PeerClass SHOULD BE thread_local WHEN USING MULTIPLE ENGINES)
+ *
+ * USAGE:
+ *
+ * class Entity : public Proxy
+ * {
+ * public:
+ *     static PeerClass peerClass;
+ *
+ *     Entity() : Proxy(PeerProperties("Entity", false, &peerClass)) {}
+ *
+ *     double scale(double factor);
+ * };
+ *
+ * PeerClass Entity::peerClass = PeerClass().addMethod("scale", &Entity::scale);
+ */
+
+#pragma once
+
+#include "jsp/NativeCall.h"
+#include "jsp/WrappedObject.h"
+
+namespace jsp
+{
+    class Proxy;
+
+    class PeerClass
+    {
+    public:
+        PeerClass() = default;
+        PeerClass(const PeerClass &other);
+        ~PeerClass();
+
+        template<class C, typename R, typename... Args>
+        PeerClass& addMethod(const std::string &name, R (C::*method)(Args...))
+        {
+            typedef R (C::*M)(Args...);
+            return addMethod(NativeCall(name, &NativeCallInvoker<R, Args...>::template invokeMethod<C, M, Proxy>, nullptr, method));
+        }
+
+        template<class C, typename R, typename... Args>
+        PeerClass& addMethod(const std::string &name, R (C::*method)(Args...) const)
+        {
+            typedef R (C::*M)(Args...) const;
+            return addMethod(NativeCall(name, &NativeCallInvoker<R, Args...>::template invokeMethod<const C, M, const Proxy>, nullptr, method));
+        }
+
+        template<class C>
+        PeerClass& addMethod(const std::string &name, bool (C::*method)(const CallArgs&))
+        {
+            return addMethod(NativeCall(name, &NativeCallRawInvoker<C, Proxy>::invokeMethod, nullptr, method));
+        }
+
+        size_t getMethodCount() const
+        {
+            return methods.size();
+        }
+
+        /*
+         * RETURNS NULL UPON FAILURE
+         */
+        JSObject* newPeer(Proxy *instance);
+
+        /*
+         * RETURNS NULL IF THE OBJECT IS NOT A PEER, OR IF ITS Proxy IS GONE
+         */
+        static Proxy* getInstance(JSObject *peer);
+        static void detach(JSObject *peer);
+
+    protected:
+        std::vector<NativeCall> methods;
+
+        Heap<WrappedObject> prototype;
+        uint32_t prototypeGeneration = 0;
+
+        PeerClass& addMethod(const NativeCall &method);
+
+        bool hasPrototype() const;
+        bool createPrototype();
+        bool defineMethod(HandleObject object, size_t index);
+        void resetPrototype();
+
+        void operator=(const PeerClass &other) = delete;
+
+        // ---
+
+        static const JSClass clazz;
+
+        static bool forwardMethodCall(JSContext *cx, unsigned argc, Value *vp);
+    };
+}
@@ -0,0 +1,99 @@
+/*
+ * JSP: https://github.com/arielm/jsp
+ * COPYRIGHT (C) 2014-2015, ARIEL MALKA ALL RIGHTS RESERVED.
+ *
+ * THE FOLLOWING SOURCE-CODE IS DISTRIBUTED UNDER THE SIMPLIFIED BSD LICENSE:
+ * https://github.com/arielm/jsp/blob/master/LICENSE
+ */
+
+#include "jsp/PropertyKey.h"
+
+using namespace std;
+
+namespace jsp
+{
+    PropertyKey::PropertyKey(const char *name)
+    :
+    name(name),
+    id(JSID_VOID),
+    generation(0)
+    {}
+
+    PropertyKey::PropertyKey(const string &name)
+    :
+    name(name),
+    id(JSID_VOID),
+    generation(0)
+    {}
+
+    PropertyKey::PropertyKey(const PropertyKey &other)
+    :
+    name(other.name),
+    id(JSID_VOID),
+    generation(0)
+    {}
+
+    PropertyKey& PropertyKey::operator=(const PropertyKey &other)
+    {
+        if (this != &other)
+        {
+            reset();
+            name = other.name;
+        }
+
+        return *this;
+    }
+
+    /*
+     * NOTHING TO UNREGISTER FOR UNRESOLVED KEYS, E.G. STATIC KEYS DESTROYED AFTER JSP::uninit()
+     */
+    PropertyKey::~PropertyKey()
+    {
+        reset();
+    }
+
+    /*
+     * A KEY RESOLVED BY ANOTHER GENERATION IS STALE: ITS ATOM MAY BELONG TO ANOTHER (OR TO A DEAD) RUNTIME
+     * AND IT IS NOT REGISTERED IN THE TRACER-REGISTRY OF THE CURRENT ONE
+     */
+    HandleId PropertyKey::get() const
+    {
+        if (generation != JSP::getGeneration())
+        {
+            id = JSID_VOID;
+            generation = JSP::getGeneration();
+        }
+
+        if (JSID_IS_VOID(id))
+        {
+            JSAtom *atom = JSP::toAtom(name.data(), name.size(), false);
+
+            if (atom)
+            {
+                id = js::AtomToId(atom); // INDEX-LIKE NAMES (E.G. "0") ARE RESOLVED AS "INT JSID"
+
+                if (JSID_IS_STRING(id))
+                {
+                    JSP::addTracedKey(const_cast<PropertyKey*>(this));
+                }
+            }
+        }
+
+        return HandleId::fromMarkedLocation(&id);
+    }
+
+    void PropertyKey::trace(JSTracer *trc)
+    {
+        JS_CallIdTracer(trc, &id, "PropertyKey");
+    }
+
+    void PropertyKey::reset()
+    {
+        if (JSID_IS_STRING(id) && (generation == JSP::getGeneration()))
+        {
+            JSP::removeTracedKey(this);
+        }
+
+        id = JSID_VOID;
+    }
+}
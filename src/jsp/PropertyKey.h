@@ -0,0 +1,76 @@
+/*
+ * JSP: https://github.com/arielm/jsp
+ * COPYRIGHT (C) 2014-2015, ARIEL MALKA ALL RIGHTS RESERVED.
+ *
+ * THE FOLLOWING SOURCE-CODE IS DISTRIBUTED UNDER THE SIMPLIFIED BSD LICENSE:
+ * https://github.com/arielm/jsp/blob/master/LICENSE
+ */
+
+/*
+ * PROPERTY-NAME "INTERNED" ONCE, AS A JSID
+ *
+ * - RESOLVED LAZILY, UPON FIRST ACCESS (I.E. STATIC KEYS CAN BE DECLARED BEFORE THE RUNTIME EXISTS)
+ * - THE UNDERLYING ATOM IS NOT PINNED: IT IS TRACED VIA JSP (SEE JSP::addTracedKey)
+ * - NO POST-BARRIER REQUIRED: ATOMS ARE NEVER ALLOCATED IN THE NURSERY
+ * - RESET UPON JSP::uninit(), I.E. RESOLVED AGAIN BY THE NEXT RUNTIME
+ * - BOUND TO THE JSP GENERATION IT WAS RESOLVED IN: A KEY RESOLVED BY ANOTHER RUNTIME IS NEVER RETURNED AS-IS
+ *
+ * A KEY IS RESOLVED AND TRACED BY ONE ENGINE AT A TIME: STATIC KEYS MUST BE thread_local (SEE Manager.h)
+ *
+ * DECLARING KEYS ONCE PER C++ CLASS:
+ *
+ * class Entity
+ * {
+ *     static thread_local const jsp::PropertyKey KEY_POSITION;
+ * };
+ *
+ * thread_local const jsp::PropertyKey Entity::KEY_POSITION("position");
+ *
+ * ALTERNATIVELY, ONE KEY PER CALL-SITE (AND PER THREAD): Proto::get<FLOAT32>(object, JSP_PROPERTY_KEY("x"))
+ */
+
+#pragma once
+
+#include "jsp/Context.h"
+
+#define JSP_PROPERTY_KEY(NAME) ([]() -> const jsp::PropertyKey& { static thread_local const jsp::PropertyKey key(NAME); return key; }())
+
+namespace jsp
+{
+    class PropertyKey
+    {
+    public:
+        explicit PropertyKey(const char *name);
+        explicit PropertyKey(const std::string &name);
+
+        PropertyKey(const PropertyKey &other);
+        PropertyKey& operator=(const PropertyKey &other);
+
+        ~PropertyKey();
+
+        const std::string& getName() const
+        {
+            return name;
+        }
+
+        /*
+         * RETURNS A "VOID" JSID UPON FAILURE
+         */
+        JS::HandleId get() const;
+
+        operator JS::HandleId () const
+        {
+            return get();
+        }
+
+    protected:
+        friend class ::JSP;
+
+        std::string name;
+        mutable jsid id;
+        mutable uint32_t generation;
+
+        void trace(JSTracer *trc);
+        void reset();
+    };
+}
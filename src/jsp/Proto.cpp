@@ -7,6 +7,15 @@
  */
 
 #include "jsp/Proto.h"
+#include "jsp/Bytecode.h"
+#include "jsp/ScriptCache.h"
+#include "jsp/ScriptLoader.h"
+
+#if defined(JSP_USE_PRIVATE_APIS)
+#include "jsarray.h"
+#include "vm/ArrayObject.h"
+#include "vm/ForOfPIC.h"
+#endif
 
 #include "chronotext/utils/Utils.h"
 
@@ -16,10 +25,42 @@ using namespace chr;
 
 namespace jsp
 {
+#if defined(JSP_USE_PRIVATE_APIS)
+    namespace
+    {
+        /*
+         * I.E. NO PROXIES, NO "EXOTIC" OBJECTS AND NO INDEXED PROPERTIES OUTSIDE OF THE DENSE ELEMENTS (INCLUDING ALONG THE PROTOTYPE CHAIN)
+         *
+         * FOR SUCH ARRAYS, "HOLES" AND INDICES BEYOND THE INITIALIZED-LENGTH CAN ONLY RESOLVE TO UNDEFINED
+         *
+         * THE ITERATION PROTOCOL MUST BE THE ORIGINAL ONE AS WELL: NO OWN @@iterator, AND NEITHER Array.prototype[@@iterator]
+         * NOR ArrayIterator.prototype.next OVERRIDDEN (SAME GUARD AS SPIDERMONKEY'S OWN for-of OPTIMIZATION, SEE vm/ForOfPIC.h)
+         */
+        inline bool isPlainDenseArray(HandleObject object)
+        {
+            if (object && object->is<js::ArrayObject>() && !js::ObjectMayHaveExtraIndexedProperties(object))
+            {
+                auto stubChain = js::ForOfPIC::getOrCreate(cx);
+                bool optimized = false;
+                
+                if (stubChain && stubChain->tryOptimizeArray(cx, object, &optimized))
+                {
+                    return optimized;
+                }
+                
+                JS_ClearPendingException(cx);
+            }
+            
+            return false;
+        }
+    }
+    
+#endif
+
     bool Proto::exec(const string &source, const ReadOnlyCompileOptions &options)
     {
         RootedValue result(cx);
-        bool success = Evaluate(cx, globalHandle(), options, source.data(), source.size(), &result);
+        bool success = evaluate(source, options, &result);
         
         if (JS_IsExceptionPending(cx))
         {
@@ -51,11 +92,68 @@ namespace jsp
         executeScript(utils::readText<string>(inputSource), inputSource->getFilePathHint());
     }
     
+    size_t Proto::precompileScript(InputSource::Ref inputSource, const fs::path &bytecodePath)
+    {
+        return Bytecode::write(utils::readText<string>(inputSource), inputSource->getFilePathHint(), writeFile(bytecodePath));
+    }
+    
+    void Proto::executeScript(InputSource::Ref inputSource, const fs::path &bytecodePath)
+    {
+        string source = utils::readText<string>(inputSource);
+        RootedScript script(cx, Bytecode::read(bytecodePath, source));
+        
+        if (script)
+        {
+            RootedValue result(cx);
+            bool success = JS_ExecuteScript(cx, globalHandle(), script, &result);
+            
+            if (JS_IsExceptionPending(cx))
+            {
+                JS_ReportPendingException(cx);
+                JS_ClearPendingException(cx);
+            }
+            
+            if (!success)
+            {
+                throw EXCEPTION(Proto, "EXECUTION FAILED");
+            }
+        }
+        else
+        {
+            executeScript(source, inputSource->getFilePathHint());
+        }
+    }
+    
+    CompileTask::Ref Proto::compileScriptAsync(const string &source, const string &file, int line, const CompileTask::Callback &callback)
+    {
+        auto task = CompileTask::start(source, file, line, callback);
+        
+        if (!task)
+        {
+            throw EXCEPTION(Proto, "COMPILATION FAILED");
+        }
+        
+        return task;
+    }
+    
+    CompileTask::Ref Proto::compileScriptAsync(InputSource::Ref inputSource, const CompileTask::Callback &callback)
+    {
+        return compileScriptAsync(utils::readText<string>(inputSource), inputSource->getFilePathHint(), 1, callback);
+    }
+    
+    void Proto::executeScripts(const vector<InputSource::Ref> &inputSources)
+    {
+        if (!ScriptLoader(inputSources).run())
+        {
+            throw EXCEPTION(Proto, "EXECUTION FAILED");
+        }
+    }
+    
     // ---
     
     bool Proto::eval(const string &source, const ReadOnlyCompileOptions &options, MutableHandleValue result)
     {
-        bool success = Evaluate(cx, globalHandle(), options, source.data(), source.size(), result);
+        bool success = evaluate(source, options, result);
         
         if (JS_IsExceptionPending(cx))
         {
@@ -96,6 +194,21 @@ namespace jsp
         return evaluateObject(utils::readText<string>(inputSource), inputSource->getFilePathHint());
     }
     
+    /*
+     * REPEATED EVALUATIONS OF THE SAME SOURCE ARE SKIPPING THE FRONT-END (SEE ScriptCache.h)
+     */
+    bool Proto::evaluate(const string &source, const ReadOnlyCompileOptions &options, MutableHandleValue result)
+    {
+        RootedScript script(cx, ScriptCache::compile(source, options));
+        
+        if (script)
+        {
+            return JS_ExecuteScript(cx, globalHandle(), script, result);
+        }
+        
+        return false; // I.E. COMPILATION-ERROR
+    }
+    
     // ---
     
     Value Proto::call(HandleObject object, const char *functionName, const HandleValueArray& args)
@@ -255,6 +368,101 @@ namespace jsp
     
     // ---
     
+    bool Proto::hasProperty(HandleObject object, const PropertyKey &key)
+    {
+        if (object)
+        {
+            HandleId id = key.get();
+            bool found;
+            
+            if (!JSID_IS_VOID(id) && JS_HasPropertyById(cx, object, id, &found))
+            {
+                return found;
+            }
+        }
+        
+        return false;
+    }
+    
+    bool Proto::hasOwnProperty(HandleObject object, const PropertyKey &key)
+    {
+        if (object)
+        {
+            HandleId id = key.get();
+            bool found;
+            
+            if (!JSID_IS_VOID(id) && JS_AlreadyHasOwnPropertyById(cx, object, id, &found))
+            {
+                return found;
+            }
+        }
+        
+        return false;
+    }
+    
+    bool Proto::getProperty(HandleObject object, const PropertyKey &key, MutableHandleValue result)
+    {
+        if (object)
+        {
+            HandleId id = key.get();
+            
+            if (!JSID_IS_VOID(id))
+            {
+                return JS_GetPropertyById(cx, object, id, result);
+            }
+        }
+        
+        return false;
+    }
+    
+    bool Proto::setProperty(HandleObject object, const PropertyKey &key, HandleValue value)
+    {
+        if (object)
+        {
+            HandleId id = key.get();
+            
+            if (!JSID_IS_VOID(id))
+            {
+                return JS_SetPropertyById(cx, object, id, value);
+            }
+        }
+        
+        return false;
+    }
+    
+    bool Proto::defineProperty(HandleObject object, const PropertyKey &key, HandleValue value, unsigned attrs)
+    {
+        if (object)
+        {
+            HandleId id = key.get();
+            
+            if (!JSID_IS_VOID(id))
+            {
+                return JS_DefinePropertyById(cx, object, id, value, nullptr, nullptr, attrs);
+            }
+        }
+        
+        return false;
+    }
+    
+    bool Proto::deleteProperty(HandleObject object, const PropertyKey &key)
+    {
+        if (object)
+        {
+            HandleId id = key.get();
+            bool success;
+            
+            if (!JSID_IS_VOID(id) && JS_DeletePropertyById2(cx, object, id, &success))
+            {
+                return success;
+            }
+        }
+        
+        return false;
+    }
+    
+    // ---
+    
     JSObject* Proto::newArray(size_t length)
     {
         return JS_NewArrayObject(cx, length);
@@ -280,10 +488,34 @@ namespace jsp
         return false;
     }
     
+    /*
+     * THE "TRUE" ELEMENT-COUNT (I.E. IGNORING UNDEFINED ELEMENTS)
+     *
+     * THE ITERATION PROTOCOL IS ONLY USED FOR PROXIES AND "EXOTIC" OBJECTS
+     */
     uint32_t Proto::getElementCount(HandleObject array)
     {
         uint32_t elementCount = 0;
         
+#if defined(JSP_USE_PRIVATE_APIS)
+        if (isPlainDenseArray(array))
+        {
+            uint32_t end = std::min(array->getDenseInitializedLength(), array->as<js::ArrayObject>().length());
+            
+            for (uint32_t i = 0; i < end; i++)
+            {
+                const Value &value = array->getDenseElement(i);
+                
+                if (!value.isMagic() && !value.isUndefined()) // I.E. NOT A "HOLE"
+                {
+                    elementCount++;
+                }
+            }
+            
+            return elementCount;
+        }
+#endif
+        
         RootedValue iterable(cx, ObjectOrNullValue(array));
         ForOfIterator it(cx);
         
@@ -343,6 +575,32 @@ namespace jsp
     {
         uint32_t getCount = 0;
         
+#if defined(JSP_USE_PRIVATE_APIS)
+        if (isPlainDenseArray(sourceArray))
+        {
+            uint32_t length = sourceArray->as<js::ArrayObject>().length();
+            uint32_t end = std::min(sourceArray->getDenseInitializedLength(), length);
+            
+            if (elements.reserve(elements.length() + length)) // FROM HERE: NO GC, I.E. THE ELEMENTS CAN'T BE RELOCATED
+            {
+                for (uint32_t i = 0; i < end; i++)
+                {
+                    const Value &value = sourceArray->getDenseElement(i);
+                    elements.infallibleAppend(value.isMagic() ? UndefinedValue() : value); // I.E. A "HOLE"
+                }
+                
+                for (uint32_t i = end; i < length; i++)
+                {
+                    elements.infallibleAppend(UndefinedValue());
+                }
+                
+                getCount = length;
+            }
+            
+            return getCount;
+        }
+#endif
+        
         RootedValue iterable(cx, ObjectOrNullValue(sourceArray));
         ForOfIterator it(cx);
         
@@ -432,4 +690,11 @@ namespace jsp
         
         return false;
     }
+    
+    // ---
+    
+    void Proto::freeTypedArrayBuffer(void *buffer)
+    {
+        js_free(buffer);
+    }
 }
@@ -16,11 +16,57 @@
 #pragma once
 
 #include "jsp/Context.h"
+#include "jsp/PropertyKey.h"
+#include "jsp/CompileTask.h"
 
 #include "chronotext/InputSource.h"
 
 namespace jsp
 {
+    /*
+     * MAPPING BETWEEN C++ NUMBER-TYPES AND JS TYPED-ARRAYS
+     */
+    template<typename T>
+    struct TypedArray;
+    
+    template<>
+    struct TypedArray<float>
+    {
+        static JSObject* create(uint32_t length) { return JS_NewFloat32Array(cx, length); }
+        static JSObject* createWithBuffer(HandleObject buffer) { return JS_NewFloat32ArrayWithBuffer(cx, buffer, 0, -1); }
+        static bool is(JSObject *object) { return JS_IsFloat32Array(object); }
+        static float* getData(JSObject *object) { return JS_GetFloat32ArrayData(object); }
+    };
+    
+    template<>
+    struct TypedArray<double>
+    {
+        static JSObject* create(uint32_t length) { return JS_NewFloat64Array(cx, length); }
+        static JSObject* createWithBuffer(HandleObject buffer) { return JS_NewFloat64ArrayWithBuffer(cx, buffer, 0, -1); }
+        static bool is(JSObject *object) { return JS_IsFloat64Array(object); }
+        static double* getData(JSObject *object) { return JS_GetFloat64ArrayData(object); }
+    };
+    
+    template<>
+    struct TypedArray<int32_t>
+    {
+        static JSObject* create(uint32_t length) { return JS_NewInt32Array(cx, length); }
+        static JSObject* createWithBuffer(HandleObject buffer) { return JS_NewInt32ArrayWithBuffer(cx, buffer, 0, -1); }
+        static bool is(JSObject *object) { return JS_IsInt32Array(object); }
+        static int32_t* getData(JSObject *object) { return JS_GetInt32ArrayData(object); }
+    };
+    
+    template<>
+    struct TypedArray<uint32_t>
+    {
+        static JSObject* create(uint32_t length) { return JS_NewUint32Array(cx, length); }
+        static JSObject* createWithBuffer(HandleObject buffer) { return JS_NewUint32ArrayWithBuffer(cx, buffer, 0, -1); }
+        static bool is(JSObject *object) { return JS_IsUint32Array(object); }
+        static uint32_t* getData(JSObject *object) { return JS_GetUint32ArrayData(object); }
+    };
+    
+    // ---
+    
     class Proto : public JSP
     {
     public:
@@ -56,6 +102,27 @@ namespace jsp
          */
         static void executeScript(chr::InputSource::Ref inputSource);
         
+        /*
+         * PRECOMPILED SCRIPTS (SEE Bytecode.h)
+         *
+         * executeScript() FALLS BACK TO THE SOURCE WHEN THE BYTECODE FILE IS MISSING, OR NOT MATCHING THE SOURCE OR THE BUILD
+         */
+        static size_t precompileScript(chr::InputSource::Ref inputSource, const ci::fs::path &bytecodePath);
+        static void executeScript(chr::InputSource::Ref inputSource, const ci::fs::path &bytecodePath);
+        
+        /*
+         * OFF-MAIN-THREAD COMPILATION (SEE CompileTask.h)
+         *
+         * THE SCRIPT IS EXECUTED ON THE MAIN THREAD, UPON CompileTask::dispatch(), UNLESS A CALLBACK IS PROVIDED
+         */
+        static CompileTask::Ref compileScriptAsync(const std::string &source, const std::string &file = "", int line = 1, const CompileTask::Callback &callback = nullptr);
+        static CompileTask::Ref compileScriptAsync(chr::InputSource::Ref inputSource, const CompileTask::Callback &callback = nullptr);
+        
+        /*
+         * SCRIPTS READ IN PARALLEL, COMPILED AS SOON AS THEY ARRIVE AND EXECUTED IN DECLARED ORDER (SEE ScriptLoader.h)
+         */
+        static void executeScripts(const std::vector<chr::InputSource::Ref> &inputSources);
+        
         /*
          * TODO INSTEAD:
          *
@@ -91,6 +158,11 @@ namespace jsp
          */
         static JSObject* evaluateObject(chr::InputSource::Ref inputSource);
         
+        /*
+         * SHARED BY exec() AND eval(): GOING THROUGH THE SCRIPT-CACHE, WHEN AVAILABLE
+         */
+        static bool evaluate(const std::string &source, const ReadOnlyCompileOptions &options, MutableHandleValue result);
+        
         // ---
         
         /*
@@ -139,11 +211,36 @@ namespace jsp
         
         // ---
         
+        /*
+         * SAME AS ABOVE, WITH PROPERTY-NAMES RESOLVED ONCE (SEE PropertyKey.h)
+         */
+        
+        static bool hasProperty(HandleObject object, const PropertyKey &key);
+        static bool hasOwnProperty(HandleObject object, const PropertyKey &key);
+        
+        static bool getProperty(HandleObject object, const PropertyKey &key, MutableHandleValue result);
+        static bool setProperty(HandleObject object, const PropertyKey &key, HandleValue value);
+        
+        static bool defineProperty(HandleObject object, const PropertyKey &key, HandleValue value, unsigned attrs = 0);
+        static bool deleteProperty(HandleObject object, const PropertyKey &key);
+        
+        //
+        
+        template<typename T>
+        static T get(HandleObject targetObject, const PropertyKey &propertyKey, const typename TypeTraits<T>::defaultType defaultValue = TypeTraits<T>::defaultValue());
+        
+        template<typename T>
+        static bool set(HandleObject targetObject, const PropertyKey &propertyKey, T &&value);
+        
+        template<typename T>
+        static bool define(HandleObject targetObject, const PropertyKey &propertyKey, T &&value, unsigned attrs = 0);
+        
+        // ---
+        
         /*
          * TODO:
          *
          * 1) C++11 ITERATORS?
-         * 2) INTEGRATION WITH JS TYPED-ARRAYS?
          */
 
         /*
@@ -191,6 +288,46 @@ namespace jsp
         
         template<typename T>
         static uint32_t appendElements(HandleObject targetArray, const std::vector<T> &elements);
+        
+        // ---
+        
+        /*
+         * TYPED-ARRAYS: ONE memcpy INSTEAD OF ONE VM ROUND-TRIP PER ELEMENT
+         *
+         * SUPPORTED TYPES: float (Float32Array), double (Float64Array), int32_t (Int32Array) AND uint32_t (Uint32Array)
+         */
+        
+        template<typename T>
+        static JSObject* newTypedArray(const std::vector<T> &elements);
+        
+        /*
+         * RETURNS FALSE IF sourceArray IS NOT A TYPED-ARRAY OF THE CORRESPONDING TYPE
+         */
+        template<typename T>
+        static bool getTypedArrayElements(HandleObject sourceArray, std::vector<T> &elements);
+        
+        /*
+         * DIRECT ACCESS, WITHOUT COPYING
+         * THE RETURNED POINTER IS ONLY VALID UNTIL THE NEXT OPERATION THAT CAN TRIGGER GC
+         */
+        template<typename T>
+        static T* getTypedArrayData(HandleObject typedArray, uint32_t *length);
+        
+        /*
+         * "EXTERNAL" BUFFERS: C++ MEMORY WRAPPED BY A TYPED-ARRAY, WITHOUT COPYING
+         *
+         * - THE MEMORY MUST BE ALLOCATED VIA allocateTypedArrayBuffer<T>()
+         *   (SPIDERMONKEY 31 CAN'T ADOPT ARBITRARY C++ MEMORY)
+         * - OWNERSHIP IS ALWAYS TRANSFERRED TO THE TYPED-ARRAY, EVEN UPON FAILURE
+         * - A BUFFER WHICH IS NOT ADOPTED MUST BE RELEASED VIA freeTypedArrayBuffer()
+         */
+        
+        template<typename T>
+        static T* allocateTypedArrayBuffer(uint32_t length);
+        static void freeTypedArrayBuffer(void *buffer);
+        
+        template<typename T>
+        static JSObject* newTypedArray(T *buffer, uint32_t length);
     };
     
     // ---
@@ -225,6 +362,36 @@ namespace jsp
     
     // ---
     
+    template<typename T>
+    inline T Proto::get(HandleObject targetObject, const PropertyKey &propertyKey, const typename TypeTraits<T>::defaultType defaultValue)
+    {
+        T result;
+        RootedValue value(cx);
+        
+        if (!getProperty(targetObject, propertyKey, &value) || !convertMaybe(value, result))
+        {
+            result = defaultValue;
+        }
+        
+        return result; // RVO-COMPLIANT
+    }
+    
+    template<typename T>
+    inline bool Proto::set(HandleObject targetObject, const PropertyKey &propertyKey, T &&value)
+    {
+        RootedValue rooted(cx, toValue<T>(std::forward<T>(value)));
+        return setProperty(targetObject, propertyKey, rooted);
+    }
+    
+    template<typename T>
+    inline bool Proto::define(HandleObject targetObject, const PropertyKey &propertyKey, T &&value, unsigned attrs)
+    {
+        RootedValue rooted(cx, toValue<T>(std::forward<T>(value)));
+        return defineProperty(targetObject, propertyKey, rooted, attrs);
+    }
+    
+    // ---
+    
     template<typename T>
     inline T Proto::get(HandleObject targetArray, int elementIndex, const typename TypeTraits<T>::defaultType defaultValue)
     {
@@ -319,4 +486,75 @@ namespace jsp
         
         return appendCount;
     }
+    
+    // ---
+    
+    template<typename T>
+    JSObject* Proto::newTypedArray(const std::vector<T> &elements)
+    {
+        JSObject *typedArray = TypedArray<T>::create(elements.size());
+        
+        if (typedArray && !elements.empty())
+        {
+            memcpy(TypedArray<T>::getData(typedArray), elements.data(), elements.size() * sizeof(T));
+        }
+        
+        return typedArray;
+    }
+    
+    template<typename T>
+    bool Proto::getTypedArrayElements(HandleObject sourceArray, std::vector<T> &elements)
+    {
+        if (sourceArray && TypedArray<T>::is(sourceArray))
+        {
+            auto length = JS_GetTypedArrayLength(sourceArray);
+            elements.resize(length);
+            
+            if (length)
+            {
+                memcpy(elements.data(), TypedArray<T>::getData(sourceArray), length * sizeof(T));
+            }
+            
+            return true;
+        }
+        
+        return false;
+    }
+    
+    template<typename T>
+    T* Proto::getTypedArrayData(HandleObject typedArray, uint32_t *length)
+    {
+        if (typedArray && TypedArray<T>::is(typedArray))
+        {
+            *length = JS_GetTypedArrayLength(typedArray);
+            return TypedArray<T>::getData(typedArray);
+        }
+        
+        *length = 0;
+        return nullptr;
+    }
+    
+    template<typename T>
+    T* Proto::allocateTypedArrayBuffer(uint32_t length)
+    {
+        return reinterpret_cast<T*>(JS_AllocateArrayBufferContents(cx, length * sizeof(T)));
+    }
+    
+    template<typename T>
+    JSObject* Proto::newTypedArray(T *buffer, uint32_t length)
+    {
+        if (buffer)
+        {
+            RootedObject arrayBuffer(cx, JS_NewArrayBufferWithContents(cx, length * sizeof(T), buffer));
+            
+            if (arrayBuffer)
+            {
+                return TypedArray<T>::createWithBuffer(arrayBuffer);
+            }
+            
+            freeTypedArrayBuffer(buffer);
+        }
+        
+        return nullptr;
+    }
 }
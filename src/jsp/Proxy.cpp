@@ -7,6 +7,7 @@
  */
 
 #include "jsp/Proxy.h"
+#include "jsp/MemoryReport.h"
 
 #include "chronotext/utils/Utils.h"
 
@@ -15,8 +16,8 @@ using namespace chr;
 
 namespace jsp
 {
-    Proxy::Statics *Proxy::statics = nullptr;
-    int32_t Proxy::lastInstanceId = -1;
+    thread_local Proxy::Statics *Proxy::statics = nullptr;
+    thread_local uint64_t Proxy::lastInstanceGeneration = 0;
 
     bool Proxy::init()
     {
@@ -24,7 +25,7 @@ namespace jsp
         {
             statics = new Statics;
             
-            statics->peers = newPlainObject();
+            statics->peers = JS_NewObject(cx, &peersClass, NullPtr(), NullPtr());
             define(globalHandle(), "peers", statics->peers, JSPROP_ENUMERATE | JSPROP_READONLY); // XXX: CAN'T BE MADE "PERMANENT"
         }
         
@@ -36,11 +37,13 @@ namespace jsp
         if (statics)
         {
             /*
-             * PURPOSELY NOT RESETTING lastInstanceId IN ORDER TO PREVENT INSTANCES
+             * PURPOSELY NOT RESETTING lastInstanceGeneration IN ORDER TO PREVENT INSTANCES
              * POTENTIALLY ALIVE AT THIS STAGE TO "INTERFER" IN THE FUTURE (TODO: TEST)
              */
             
             statics->instances.clear();
+            statics->freeIndices.clear();
+            statics->peerGroups.clear();
             
             statics->peers = nullptr;
             deleteProperty(globalHandle(), "peers");
@@ -50,104 +53,329 @@ namespace jsp
         }
     }
     
-    int32_t Proxy::addInstance(Proxy *instance)
+    size_t Proxy::getInstanceCount()
     {
+        return statics ? (statics->instances.size() - statics->freeIndices.size()) : 0;
+    }
+    
+    size_t Proxy::getStaticsByteSize()
+    {
+        size_t size = 0;
+        
+        if (statics)
+        {
+            size += sizeof(Statics);
+            size += statics->instances.capacity() * sizeof(InstanceEntry);
+            size += statics->freeIndices.capacity() * sizeof(int32_t);
+            size += MemoryReport::mapByteSize(statics->peerGroups);
+            
+            for (auto &element : statics->peerGroups)
+            {
+                size += element.first.capacity();
+                size += element.second.freeElementIndices.capacity() * sizeof(int32_t);
+                size += element.second.pendingInstances.capacity() * sizeof(Proxy*);
+            }
+        }
+        
+        return size;
+    }
+    
+    void Proxy::addInstance(Proxy *instance)
+    {
+        lastInstanceGeneration = (lastInstanceGeneration % GENERATION_MASK) + 1; // I.E. NEVER 0
+        instance->instanceGeneration = lastInstanceGeneration;
+        
+        if (statics->freeIndices.empty())
+        {
+            instance->instanceIndex = statics->instances.size();
+            statics->instances.push_back(InstanceEntry{instance, instance->instanceGeneration});
+        }
+        else
+        {
+            instance->instanceIndex = statics->freeIndices.back();
+            statics->freeIndices.pop_back();
+            statics->instances[instance->instanceIndex] = InstanceEntry{instance, instance->instanceGeneration};
+        }
+        
         if (!instance->peerProperties.name.empty())
         {
-            const char *name = instance->peerProperties.name.data();
+            addPeer(instance);
+        }
+    }
+    
+    bool Proxy::removeInstance(Proxy *instance)
+    {
+        if (getInstance(instance->instanceIndex, instance->instanceGeneration) == instance)
+        {
+            if (instance->peerState != PEER_NONE)
+            {
+                removePeer(instance);
+            }
             
-            RootedValue peerValue(cx);
-            getProperty(statics->peers, name, &peerValue);
+            statics->instances[instance->instanceIndex].instance = nullptr;
+            statics->freeIndices.push_back(instance->instanceIndex);
             
-            bool peerIsDefined = !peerValue.isUndefined();
-            bool peerIsArray = isArray(peerValue);
+            instance->instanceIndex = -1;
+            return true;
+        }
+        
+        return false;
+    }
+    
+    Proxy* Proxy::getInstance(int32_t instanceIndex, uint64_t instanceGeneration)
+    {
+        if (statics && (instanceIndex >= 0) && (size_t(instanceIndex) < statics->instances.size()))
+        {
+            const auto &entry = statics->instances[instanceIndex];
+            
+            if (entry.generation == instanceGeneration)
+            {
+                return entry.instance;
+            }
+        }
+        
+        return nullptr;
+    }
+    
+    // ---
+    
+    /*
+     * THE PROXY REMAINS PEER-LESS IF:
+     * - ITS PEER-NAME IS TAKEN BY A SINGLETON
+     * - IT IS A SINGLETON AND ITS PEER-NAME IS ALREADY TAKEN
+     * - ITS PEER-NAME IS TAKEN BY A PROPERTY WHICH IS NOT MANAGED BY Proxy (E.G. DEFINED FROM JS)
+     */
+    void Proxy::addPeer(Proxy *instance)
+    {
+        const auto &name = instance->peerProperties.name;
+        bool isSingleton = instance->peerProperties.isSingleton;
+        
+        auto found = statics->peerGroups.find(name);
+        
+        if (found == statics->peerGroups.end())
+        {
+            if (hasOwnProperty(statics->peers, name.data()))
+            {
+                return;
+            }
             
-            bool singletonEnabled = !peerIsDefined;
-            bool multipleInstancesEnabled = (peerIsDefined && peerIsArray) || !peerIsDefined;
+            found = statics->peerGroups.emplace(name, PeerGroup()).first;
+            found->second.isSingleton = isSingleton;
+        }
+        else if (isSingleton || found->second.isSingleton)
+        {
+            return;
+        }
+        
+        auto &group = found->second;
+        group.liveCount++;
+        
+        if (!isSingleton)
+        {
+            if (group.freeElementIndices.empty())
+            {
+                instance->peerElementIndex = group.length++;
+            }
+            else
+            {
+                instance->peerElementIndex = group.freeElementIndices.back();
+                group.freeElementIndices.pop_back();
+            }
+        }
+        
+        /*
+         * ONCE peers[name] IS DEFINED, IT WON'T BE RESOLVED ANYMORE: LAZY PEERS MUST BE CREATED IMMEDIATELY
+         */
+        if (instance->peerProperties.isLazy && !group.isDefined)
+        {
+            instance->peerState = PEER_PENDING;
+            instance->pendingIndex = group.pendingInstances.size();
+            group.pendingInstances.push_back(instance);
+        }
+        else
+        {
+            materializePeer(instance, group);
+        }
+    }
+    
+    void Proxy::removePeer(Proxy *instance)
+    {
+        const auto &name = instance->peerProperties.name;
+        auto found = statics->peerGroups.find(name);
+        
+        if (found != statics->peerGroups.end())
+        {
+            auto &group = found->second;
             
-            if ((instance->peerProperties.isSingleton && singletonEnabled) || (!instance->peerProperties.isSingleton && multipleInstancesEnabled))
+            if (instance->peerState == PEER_PENDING)
             {
-                if (instance->peerProperties.isSingleton)
+                auto last = group.pendingInstances.back();
+                last->pendingIndex = instance->pendingIndex;
+                group.pendingInstances[instance->pendingIndex] = last;
+                group.pendingInstances.pop_back();
+            }
+            else
+            {
+                if (instance->peerProperties.peerClass)
+                {
+                    PeerClass::detach(instance->peer.get()); // I.E. THE PEER (AND ITS METHODS) CAN OUTLIVE THE PROXY
+                }
+                
+                if (group.isSingleton)
                 {
-                    instance->peer = instance->createPeer();
-                    define(statics->peers, name, instance->peer, JSPROP_ENUMERATE | JSPROP_READONLY); // XXX: CAN'T BE MADE "PERMANENT"
+                    deleteProperty(statics->peers, name.data());
                 }
                 else
                 {
-                    RootedObject peerArray(cx);
-                    instance->peerElementIndex = 0;
+                    RootedObject peerArray(cx, get<OBJECT>(statics->peers, name.data()));
                     
-                    if (peerIsDefined)
+                    if (peerArray)
                     {
-                        peerArray = peerValue.toObjectOrNull();
-                        instance->peerElementIndex = getLength(peerArray);
+                        deleteElement(peerArray, instance->peerElementIndex);
                     }
-                    else
-                    {
-                        peerArray = newArray();
-                        define(statics->peers, name, peerArray, JSPROP_ENUMERATE | JSPROP_READONLY); // XXX: CAN'T BE MADE "PERMANENT"
-                    }
-                    
-                    instance->peer = instance->createPeer();
-                    define(peerArray, instance->peerElementIndex, instance->peer, JSPROP_READONLY); // XXX: CAN'T BE MADE "PERMANENT"
+                }
+            }
+            
+            if (--group.liveCount == 0)
+            {
+                if (group.isDefined && !group.isSingleton)
+                {
+                    deleteProperty(statics->peers, name.data());
                 }
                 
-                int32_t instanceId = ++lastInstanceId;
-                statics->instances.emplace(instanceId, instance);
-                
-                return instanceId;
+                statics->peerGroups.erase(found);
+            }
+            else if (!group.isSingleton)
+            {
+                group.freeElementIndices.push_back(instance->peerElementIndex);
             }
         }
         
-        return -1;
+        instance->peerState = PEER_NONE;
+        instance->pendingIndex = -1;
     }
     
-    bool Proxy::removeInstance(int32_t instanceId)
+    void Proxy::materializePeer(Proxy *instance, PeerGroup &group)
     {
-        Proxy *instance = getInstance(instanceId);
+        const char *name = instance->peerProperties.name.data();
         
-        if (instance)
+        instance->peerState = PEER_CREATED;
+        instance->pendingIndex = -1;
+        
+        RootedObject peer(cx, instance->createPeer());
+        
+        if (peer)
         {
-            const char *name = instance->peerProperties.name.data();
-            
-            RootedObject peer(cx, get<OBJECT>(statics->peers, name));
-         
-            if (peer)
+            if (group.isSingleton)
+            {
+                define(statics->peers, name, peer, JSPROP_ENUMERATE | JSPROP_READONLY); // XXX: CAN'T BE MADE "PERMANENT"
+            }
+            else
             {
-                if (instance->peerProperties.isSingleton)
+                RootedObject peerArray(cx, group.isDefined ? get<OBJECT>(statics->peers, name) : nullptr);
+                
+                if (!peerArray)
                 {
-                    deleteProperty(statics->peers, name);
+                    peerArray = newArray();
+                    define(statics->peers, name, peerArray, JSPROP_ENUMERATE | JSPROP_READONLY); // XXX: CAN'T BE MADE "PERMANENT"
                 }
-                else
+                
+                define(peerArray, instance->peerElementIndex, peer, JSPROP_READONLY); // XXX: CAN'T BE MADE "PERMANENT"
+            }
+            
+            bool wasDefined = group.isDefined;
+            group.isDefined = true;
+            instance->peer = peer.get();
+            
+            /*
+             * NATIVE-CALLS REGISTERED WHILE THE PEER WAS PENDING
+             */
+            for (size_t nativeCallId = 0; nativeCallId < instance->nativeCalls.size(); nativeCallId++)
+            {
+                const auto &nativeCall = instance->nativeCalls[nativeCallId];
+                
+                if (!nativeCall.isEmpty())
                 {
-                    deleteElement(peer, instance->peerElementIndex);
-                    
-                    if (getElementCount(peer) == 0)
-                    {
-                        deleteProperty(statics->peers, name);
-                    }
+                    instance->defineNativeCall(nativeCall.name, int32_t(nativeCallId));
                 }
             }
             
-            // ---
-            
-            statics->instances.erase(instanceId);
-            return true;
+            /*
+             * ONCE peers[name] IS DEFINED, THE RESOLVE-HOOK WON'T BE INVOKED FOR IT: PENDING PEERS OF THE GROUP MUST BE CREATED NOW
+             */
+            if (!wasDefined && !group.pendingInstances.empty())
+            {
+                materializePendingPeers(group);
+            }
         }
+    }
+    
+    void Proxy::materializePendingPeers(PeerGroup &group)
+    {
+        vector<Proxy*> pendingInstances;
+        pendingInstances.swap(group.pendingInstances);
         
-        return false;
+        for (auto instance : pendingInstances)
+        {
+            materializePeer(instance, group);
+        }
     }
     
-    Proxy* Proxy::getInstance(int32_t instanceId)
+    // ---
+    
+    /*
+     * THE RESOLVE-HOOK IS ONLY INVOKED FOR PROPERTIES NOT (YET) DEFINED ON peers
+     */
+    const JSClass Proxy::peersClass =
+    {
+        "Peers",
+        0,
+        JS_PropertyStub,
+        JS_DeletePropertyStub,
+        JS_PropertyStub,
+        JS_StrictPropertyStub,
+        enumeratePeers,
+        resolvePeers,
+        JS_ConvertStub,
+        nullptr,
+        nullptr,
+        nullptr,
+        nullptr,
+        nullptr
+    };
+    
+    bool Proxy::resolvePeers(JSContext *cx, HandleObject object, HandleId id)
     {
-        auto found = statics->instances.find(instanceId);
+        if (statics && JSID_IS_STRING(id))
+        {
+            auto found = statics->peerGroups.find(JSP::toString(JSID_TO_STRING(id)));
+            
+            if ((found != statics->peerGroups.end()) && !found->second.pendingInstances.empty())
+            {
+                materializePendingPeers(found->second);
+            }
+        }
         
-        if (found != statics->instances.end())
+        return true;
+    }
+    
+    /*
+     * E.G. for (var name in peers) OR toSource(peers)
+     */
+    bool Proxy::enumeratePeers(JSContext *cx, HandleObject object)
+    {
+        if (statics)
         {
-            return found->second;
+            for (auto &entry : statics->peerGroups)
+            {
+                if (!entry.second.pendingInstances.empty())
+                {
+                    materializePendingPeers(entry.second);
+                }
+            }
         }
         
-        return nullptr;
+        return true;
     }
     
     // ---
@@ -156,21 +384,26 @@ namespace jsp
     :
     peerProperties(defaultPeerProperties())
     {
-        instanceId = addInstance(this);
-        assert(instanceId > -1); // TODO INSTEAD: ALLOW PEER-LESS PROXIES
+        addInstance(this);
     }
     
     Proxy::Proxy(const string &peerName, bool isSingleton)
     :
     peerProperties(PeerProperties(peerName, isSingleton))
     {
-        instanceId = addInstance(this);
-        assert(instanceId > -1); // TODO INSTEAD: ALLOW PEER-LESS PROXIES
+        addInstance(this);
+    }
+
+    Proxy::Proxy(const PeerProperties &peerProperties)
+    :
+    peerProperties(peerProperties)
+    {
+        addInstance(this);
     }
 
     Proxy::~Proxy()
     {
-        removeInstance(instanceId);
+        removeInstance(this);
     }
     
     // ---
@@ -182,7 +415,7 @@ namespace jsp
     
     JSObject* Proxy::createPeer()
     {
-        RootedObject object(cx, newPlainObject());
+        RootedObject object(cx, peerProperties.peerClass ? peerProperties.peerClass->newPeer(this) : newPlainObject());
         
         define(object, "name", peerProperties.name, JSPROP_READONLY | JSPROP_PERMANENT);
         define(object, "isSingleton", peerProperties.isSingleton, JSPROP_READONLY | JSPROP_PERMANENT);
@@ -197,6 +430,11 @@ namespace jsp
     
     std::string Proxy::getPeerAccessor()
     {
+        if (peerState == PEER_NONE)
+        {
+            return "";
+        }
+        
         string result = "peers";
         
         if (isIdentifier(peerProperties.name))
@@ -216,27 +454,26 @@ namespace jsp
         return result;
     }
     
-    // ---
-    
-    int32_t Proxy::registerNativeCall(const string &name, const NativeCallFnType &fn)
+    JSObject* Proxy::getPeer()
     {
-        auto nativeCallId = getNativeCallId(name);
-        
-        if (nativeCallId == -1)
+        if (peerState == PEER_PENDING)
         {
-            auto function = DefineFunctionWithReserved(cx, peer.get(), name.data(), forwardNativeCall, 0, JSPROP_ENUMERATE | JSPROP_READONLY); // XXX: CAN'T BE MADE "PERMANENT"
+            auto found = statics->peerGroups.find(peerProperties.name);
             
-            if (function)
+            if (found != statics->peerGroups.end())
             {
-                nativeCalls.emplace(++lastNativeCallId, NativeCall(name, fn));
-                nativeCallId = lastNativeCallId;
-                
-                SetFunctionNativeReserved(function, 0, NumberValue(instanceId));
-                SetFunctionNativeReserved(function, 1, NumberValue(nativeCallId));
+                materializePendingPeers(found->second);
             }
         }
         
-        return nativeCallId;
+        return peer.get();
+    }
+    
+    // ---
+    
+    int32_t Proxy::registerNativeCall(const string &name, const NativeCallFnType &fn)
+    {
+        return addNativeCall(NativeCall(name, fn));
     }
     
     bool Proxy::unregisterNativeCall(const string &name)
@@ -245,8 +482,13 @@ namespace jsp
         
         if (nativeCallId != -1)
         {
-            deleteProperty(peer, name.data());
-            nativeCalls.erase(nativeCallId);
+            if (peer)
+            {
+                deleteProperty(peer, name.data());
+            }
+            
+            nativeCalls[nativeCallId] = NativeCall("", nullptr);
+            nativeCallIds.erase(name);
             
             return true;
         }
@@ -258,6 +500,42 @@ namespace jsp
     {
         return nativeCall.fn(args);
     }
+    
+    int32_t Proxy::addNativeCall(const NativeCall &nativeCall)
+    {
+        const auto &name = nativeCall.name;
+        auto nativeCallId = getNativeCallId(name);
+        
+        if ((nativeCallId == -1) && (nativeCalls.size() <= size_t(NATIVE_CALL_ID_MASK)))
+        {
+            /*
+             * WITHOUT A PEER (YET): THE FUNCTION WILL BE DEFINED WHEN (AND IF) THE PEER IS CREATED
+             */
+            if (!peer || defineNativeCall(name, int32_t(nativeCalls.size())))
+            {
+                nativeCallId = nativeCalls.size();
+                nativeCalls.push_back(nativeCall);
+                nativeCallIds.emplace(name, nativeCallId);
+            }
+        }
+        
+        return nativeCallId;
+    }
+    
+    bool Proxy::defineNativeCall(const string &name, int32_t nativeCallId)
+    {
+        auto function = DefineFunctionWithReserved(cx, peer.get(), name.data(), forwardNativeCall, 0, JSPROP_ENUMERATE | JSPROP_READONLY); // XXX: CAN'T BE MADE "PERMANENT"
+        
+        if (function)
+        {
+            SetFunctionNativeReserved(function, 0, Int32Value(instanceIndex));
+            SetFunctionNativeReserved(function, 1, DoubleValue(double((instanceGeneration << NATIVE_CALL_ID_BITS) | uint64_t(nativeCallId))));
+            
+            return true;
+        }
+        
+        return false;
+    }
 
     // ---
     
@@ -266,34 +544,50 @@ namespace jsp
         auto args = CallArgsFromVp(argc, vp);
         auto function = &args.callee().as<JSFunction>();
         
-        auto proxyId = GetFunctionNativeReserved(function, 0).toInt32();
-        auto proxy = getInstance(proxyId);
+        auto instanceIndex = GetFunctionNativeReserved(function, 0).toInt32();
+        auto tag = uint64_t(GetFunctionNativeReserved(function, 1).toNumber());
+        
+        auto proxy = getInstance(instanceIndex, tag >> NATIVE_CALL_ID_BITS);
         
         if (proxy)
         {
-            auto nativeCallId = GetFunctionNativeReserved(function, 1).toInt32();
-            auto nativeCall = proxy->getNativeCall(nativeCallId);
+            auto nativeCall = proxy->getNativeCall(int32_t(tag & NATIVE_CALL_ID_MASK));
             
+            /*
+             * THE HANDLER CAN (UN)REGISTER NATIVE-CALLS, I.E. REALLOCATE nativeCalls OR CLEAR ITS OWN ENTRY:
+             * IT IS THEREFORE INVOKED FROM A COPY
+             */
             if (nativeCall)
             {
-                return proxy->apply(*nativeCall, args);
+                if (nativeCall->invoker)
+                {
+                    const auto typedCall = nativeCall->copyInvoker();
+                    return typedCall.invoker(typedCall, typedCall.instance, args);
+                }
+                
+                const auto genericCall = *nativeCall;
+                return proxy->apply(genericCall, args);
             }
         }
         
         /*
-         * TODO: REPORT JS-ERROR
+         * E.G. A FUNCTION OUTLIVING ITS PROXY: REPORTED AS A (CATCHABLE) JS-ERROR
          */
+        JS_ReportError(cx, "Proxy: NATIVE-CALL NOT AVAILABLE");
         
         return false;
     }
     
     const NativeCall* Proxy::getNativeCall(int32_t nativeCallId) const
     {
-        const auto found = nativeCalls.find(nativeCallId);
-        
-        if (found != nativeCalls.end())
+        if ((nativeCallId >= 0) && (size_t(nativeCallId) < nativeCalls.size()))
         {
-            return &found->second;
+            const auto &nativeCall = nativeCalls[nativeCallId];
+            
+            if (!nativeCall.isEmpty())
+            {
+                return &nativeCall;
+            }
         }
         
         return nullptr;
@@ -301,12 +595,11 @@ namespace jsp
     
     int32_t Proxy::getNativeCallId(const string &name) const
     {
-        for (auto &element : nativeCalls)
+        auto found = nativeCallIds.find(name);
+        
+        if (found != nativeCallIds.end())
         {
-            if (name == element.second.name)
-            {
-                return element.first;
-            }
+            return found->second;
         }
         
         return -1;
@@ -6,12 +6,21 @@
  * https://github.com/arielm/jsp/blob/master/LICENSE
  */
 
+/*
+ * PEERS:
+ *
+ * - EAGER (DEFAULT): THE PEER IS CREATED TOGETHER WITH THE PROXY
+ * - LAZY (PeerProperties::isLazy): THE PEER IS CREATED UPON FIRST ACCESS TO peers[name] FROM JS (VIA A RESOLVE-HOOK ON peers),
+ *   OR UPON Proxy::getPeer() FROM C++
+ * - NONE: WHEN THE PEER-NAME IS EMPTY, OR WHEN IT IS ALREADY TAKEN (E.G. BY A SINGLETON)
+ *
+ * NATIVE-CALLS CAN BE REGISTERED IN ALL CASES: THE CORRESPONDING FUNCTIONS ARE DEFINED WHEN (AND IF) THE PEER IS CREATED
+ */
+
 /*
  * TODO:
  *
- * 1) IT SHOULD BE POSSIBLE TO CREATE A (C++)PROXY WITHOUT ANY (JS)PEER, E.G.
- *    - WHEN PEER-NAME IS ALREADY TAKEN (I.E. FOR SINGLETONS)
- *    - WHEN PEER-NAME IS NOT A JS-IDENTIFIER
+ * 1) IT SHOULD NOT BE POSSIBLE TO CREATE A PEER WHEN ITS NAME IS NOT A JS-IDENTIFIER
  *
  * 2) PEERS COULD HAVE A "NAMESPACE" (IN ADDITION TO THEIR NAME), E.G.
  *    - v1.FileManager
@@ -33,32 +42,29 @@
 
 #include "jsp/Proto.h"
 #include "jsp/WrappedObject.h"
+#include "jsp/NativeCall.h"
+#include "jsp/PeerClass.h"
 
 namespace jsp
 {
-    typedef std::function<bool(const CallArgs&)> NativeCallFnType;
-    
-    struct NativeCall
-    {
-        std::string name;
-        NativeCallFnType fn;
-        
-        NativeCall(const std::string &name, const NativeCallFnType &fn)
-        :
-        name(name),
-        fn(fn)
-        {}
-    };
-    
     struct PeerProperties
     {
         std::string name;
         bool isSingleton;
         
-        PeerProperties(const std::string &name = "", bool isSingleton = false)
+        /*
+         * OPTIONAL: METHODS SHARED BY ALL THE PEERS OF THE CLASS (SEE PeerClass.h)
+         */
+        PeerClass *peerClass;
+        
+        bool isLazy;
+        
+        PeerProperties(const std::string &name = "", bool isSingleton = false, PeerClass *peerClass = nullptr, bool isLazy = false)
         :
         name(name),
-        isSingleton(isSingleton)
+        isSingleton(isSingleton),
+        peerClass(peerClass),
+        isLazy(isLazy)
         {}
     };
     
@@ -69,21 +75,106 @@ namespace jsp
 
         Proxy();
         Proxy(const std::string &peerName, bool isSingleton = false);
+        explicit Proxy(const PeerProperties &peerProperties);
         
         virtual ~Proxy();
 
         // ---
         
+        /*
+         * RETURNS AN EMPTY STRING FOR PEER-LESS PROXIES
+         */
         virtual std::string getPeerAccessor();
+        
+        /*
+         * CREATES THE PEER IF NECESSARY (I.E. FOR LAZY PEERS)
+         *
+         * RETURNS NULL FOR PEER-LESS PROXIES
+         */
+        JSObject* getPeer();
+        
+        bool hasPeer() const
+        {
+            return peerState != PEER_NONE;
+        }
+        
+        const PeerClass* getPeerClass() const
+        {
+            return peerProperties.peerClass;
+        }
 
         virtual int32_t registerNativeCall(const std::string &name, const NativeCallFnType &fn);
         virtual bool unregisterNativeCall(const std::string &name);
+        
+        /*
+         * NOT INVOLVED IN TYPED NATIVE-CALLS
+         */
         virtual bool apply(const NativeCall &nativeCall, const CallArgs &args);
+        
+        /*
+         * TYPED NATIVE-CALLS (SEE NativeCall.h)
+         *
+         * FUNCTIONS RECEIVING THE RAW CallArgs ARE REGISTERED AS GENERIC NATIVE-CALLS
+         *
+         * SUBCLASSES OVERRIDING THE (VIRTUAL) GENERIC registerNativeCall ARE HIDING THE FOLLOWING OVERLOADS,
+         * UNLESS THEY DECLARE: using Proxy::registerNativeCall;
+         */
+        
+        template<typename R, typename... Args>
+        typename std::enable_if<!std::is_same<R(Args...), bool(const CallArgs&)>::value, int32_t>::type registerNativeCall(const std::string &name, R (*function)(Args...))
+        {
+            typedef R (*F)(Args...);
+            return addNativeCall(NativeCall(name, &NativeCallInvoker<R, Args...>::template invokeFunction<F>, nullptr, function));
+        }
+        
+        template<class C, typename R, typename... Args>
+        int32_t registerNativeCall(const std::string &name, C *instance, R (C::*method)(Args...))
+        {
+            typedef R (C::*M)(Args...);
+            return addNativeCall(NativeCall(name, &NativeCallInvoker<R, Args...>::template invokeMethod<C, M>, instance, method));
+        }
+        
+        template<class C, typename R, typename... Args>
+        int32_t registerNativeCall(const std::string &name, const C *instance, R (C::*method)(Args...) const)
+        {
+            typedef R (C::*M)(Args...) const;
+            return addNativeCall(NativeCall(name, &NativeCallInvoker<R, Args...>::template invokeMethod<const C, M>, const_cast<C*>(instance), method));
+        }
+        
+        template<class C>
+        int32_t registerNativeCall(const std::string &name, C *instance, bool (C::*method)(const CallArgs&))
+        {
+            return registerNativeCall(name, NativeCallFnType(BIND_INSTANCE1(method, instance)));
+        }
+        
+        /*
+         * FOR METHODS OF THE PROXY ITSELF, E.G. registerNativeCall("scale", &Entity::scale)
+         */
+        
+        template<class C, typename R, typename... Args>
+        int32_t registerNativeCall(const std::string &name, R (C::*method)(Args...))
+        {
+            static_assert(std::is_base_of<Proxy, C>::value, "C MUST BE A Proxy");
+            return registerNativeCall(name, static_cast<C*>(this), method);
+        }
+        
+        template<class C, typename R, typename... Args>
+        int32_t registerNativeCall(const std::string &name, R (C::*method)(Args...) const)
+        {
+            static_assert(std::is_base_of<Proxy, C>::value, "C MUST BE A Proxy");
+            return registerNativeCall(name, static_cast<const C*>(this), method);
+        }
 
         // ---
         
         static bool init();
         static void uninit();
+        
+        /*
+         * FOR MEMORY-REPORTING (SEE MemoryReport)
+         */
+        static size_t getInstanceCount();
+        static size_t getStaticsByteSize(); // APPROXIMATED
 
     protected:
         PeerProperties peerProperties;
@@ -95,26 +186,91 @@ namespace jsp
         static bool forwardNativeCall(JSContext *cx, unsigned argc, Value *vp);
         
     private:
-        int32_t instanceId = -1;
-        int32_t lastNativeCallId = -1;
-        std::map<int32_t, NativeCall> nativeCalls;
+        enum PeerState
+        {
+            PEER_NONE,
+            PEER_PENDING,
+            PEER_CREATED
+        };
         
+        int32_t instanceIndex = -1;
+        uint64_t instanceGeneration = 0;
+        
+        PeerState peerState = PEER_NONE;
+        int32_t pendingIndex = -1;
+        
+        /*
+         * INDEXED BY NATIVE-CALL ID (UNREGISTERED CALLS ARE LEFT EMPTY, I.E. IDS ARE NEVER REUSED)
+         */
+        std::vector<NativeCall> nativeCalls;
+        std::map<std::string, int32_t> nativeCallIds;
+        
+        int32_t addNativeCall(const NativeCall &nativeCall);
+        bool defineNativeCall(const std::string &name, int32_t nativeCallId);
         const NativeCall* getNativeCall(int32_t nativeCallId) const;
         int32_t getNativeCallId(const std::string &name) const;
         
         // ---
         
+        /*
+         * DISPATCHING FROM JS:
+         *
+         * - RESERVED-SLOT 0 OF EACH FORWARDING FUNCTION: THE INDEX OF THE INSTANCE
+         * - RESERVED-SLOT 1 (A DOUBLE, I.E. 53 EXACT BITS): THE GENERATION OF THE INSTANCE (HIGH 37 BITS) AND THE NATIVE-CALL ID (LOW 16 BITS)
+         * - A FUNCTION OUTLIVING ITS INSTANCE (OR ITS NATIVE-CALL) IS DETECTED VIA ITS GENERATION (OR VIA ITS EMPTY NATIVE-CALL)
+         * - EACH INSTANCE RECEIVES A NEW GENERATION, STORED IN ITS SLOT: A REUSED SLOT CAN'T MATCH A STALE FUNCTION
+         *   (UNLESS 2^37 INSTANCES ARE CREATED IN-BETWEEN)
+         */
+        static constexpr int32_t NATIVE_CALL_ID_BITS = 16;
+        static constexpr int32_t NATIVE_CALL_ID_MASK = (1 << NATIVE_CALL_ID_BITS) - 1;
+        static constexpr uint64_t GENERATION_MASK = (1ULL << (53 - NATIVE_CALL_ID_BITS)) - 1;
+        
+        struct InstanceEntry
+        {
+            Proxy *instance;
+            uint64_t generation;
+        };
+        
+        /*
+         * BOOKKEEPING FOR peers[name]:
+         *
+         * - THE INDICES OF DESTROYED (NON-SINGLETON) PROXIES ARE REUSED (I.E. THE LENGTH OF THE ARRAY IS BOUNDED BY THE PEAK NUMBER OF LIVE INSTANCES)
+         * - peers[name] IS REMOVED WHEN ITS LAST LIVE INSTANCE IS DESTROYED
+         * - LAZY PEERS ARE PENDING AS LONG AS peers[name] IS NOT DEFINED (THEY ARE ALL CREATED AT ONCE WHEN IT IS RESOLVED)
+         */
+        struct PeerGroup
+        {
+            bool isSingleton = false;
+            bool isDefined = false;
+            int32_t liveCount = 0;
+            int32_t length = 0;
+            std::vector<int32_t> freeElementIndices;
+            std::vector<Proxy*> pendingInstances;
+        };
+        
         struct Statics
         {
-            std::map<int32_t, Proxy*> instances;
+            std::vector<InstanceEntry> instances;
+            std::vector<int32_t> freeIndices;
+            std::map<std::string, PeerGroup> peerGroups;
             Heap<WrappedObject> peers;
         };
         
-        static Statics *statics;
-        static int32_t lastInstanceId;
+        static thread_local Statics *statics;
+        static thread_local uint64_t lastInstanceGeneration;
+        
+        static void addInstance(Proxy *instance);
+        static bool removeInstance(Proxy *instance);
+        static Proxy* getInstance(int32_t instanceIndex, uint64_t instanceGeneration);
+        
+        static void addPeer(Proxy *instance);
+        static void removePeer(Proxy *instance);
+        static void materializePeer(Proxy *instance, PeerGroup &group);
+        static void materializePendingPeers(PeerGroup &group);
+        
+        static const JSClass peersClass;
         
-        static int32_t addInstance(Proxy *instance);
-        static bool removeInstance(int32_t instanceId);
-        static Proxy* getInstance(int32_t instanceId);
+        static bool resolvePeers(JSContext *cx, HandleObject object, HandleId id);
+        static bool enumeratePeers(JSContext *cx, HandleObject object);
     };
 }
@@ -0,0 +1,198 @@
+/*
+ * JSP: https://github.com/arielm/jsp
+ * COPYRIGHT (C) 2014-2015, ARIEL MALKA ALL RIGHTS RESERVED.
+ *
+ * THE FOLLOWING SOURCE-CODE IS DISTRIBUTED UNDER THE SIMPLIFIED BSD LICENSE:
+ * https://github.com/arielm/jsp/blob/master/LICENSE
+ */
+
+#include "jsp/ScriptCache.h"
+
+using namespace std;
+
+namespace jsp
+{
+    size_t ScriptCache::MAX_BYTES = 16 * 1024 * 1024;
+
+    thread_local ScriptCache::Statics *ScriptCache::statics = nullptr;
+
+    bool ScriptCache::init()
+    {
+        if (!statics)
+        {
+            statics = new Statics;
+
+            /*
+             * THE USAGE OF statics IS ARBITRARY (I.E. ANY "UNIQUE" POINTER WILL DO THE JOB)
+             */
+            JSP::addTracerCallback(statics, BIND_STATIC1(ScriptCache::trace));
+        }
+
+        return bool(statics);
+    }
+
+    void ScriptCache::uninit()
+    {
+        if (statics)
+        {
+            JSP::removeTracerCallback(statics);
+
+            delete statics;
+            statics = nullptr;
+        }
+    }
+
+    // ---
+
+    JSScript* ScriptCache::compile(const string &source, const ReadOnlyCompileOptions &options)
+    {
+        CompileOptions compileOptions(cx, options);
+        compileOptions.setCompileAndGo(true); // SIMILAR TO WHAT JS::Evaluate() DOES WHEN TARGETING THE GLOBAL OBJECT
+
+        if (!statics || !options.filename() || !*options.filename())
+        {
+            return Compile(cx, globalHandle(), compileOptions, source.data(), source.size());
+        }
+
+        Key key {hashSource(source), source.size(), options.filename(), options.lineno, options.noScriptRval};
+        auto found = statics->entries.find(key);
+
+        if (found != statics->entries.end())
+        {
+            if (found->second.source == source)
+            {
+                statics->hitCount++;
+                found->second.lastUse = ++statics->useCounter;
+
+                return found->second.script;
+            }
+
+            /*
+             * HASH-COLLISION: THE NEW SCRIPT WILL TAKE OVER
+             */
+            statics->byteSize -= found->first.size;
+            statics->entries.erase(found);
+        }
+
+        statics->missCount++;
+
+        // ---
+
+        RootedScript script(cx, Compile(cx, globalHandle(), compileOptions, source.data(), source.size()));
+
+        if (script && (source.size() <= MAX_BYTES))
+        {
+            evict(source.size());
+
+            statics->entries.emplace(move(key), Entry {script, ++statics->useCounter, source});
+            statics->byteSize += source.size();
+        }
+
+        return script;
+    }
+
+    void ScriptCache::invalidate(const string &file)
+    {
+        if (statics)
+        {
+            for (auto it = statics->entries.begin(); it != statics->entries.end();)
+            {
+                if (it->first.file == file)
+                {
+                    statics->byteSize -= it->first.size;
+                    it = statics->entries.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+        }
+    }
+
+    void ScriptCache::clear()
+    {
+        if (statics)
+        {
+            statics->entries.clear();
+            statics->byteSize = 0;
+        }
+    }
+
+    // ---
+
+    uint32_t ScriptCache::getHitCount()
+    {
+        return statics ? statics->hitCount : 0;
+    }
+
+    uint32_t ScriptCache::getMissCount()
+    {
+        return statics ? statics->missCount : 0;
+    }
+
+    void ScriptCache::resetCounters()
+    {
+        if (statics)
+        {
+            statics->hitCount = 0;
+            statics->missCount = 0;
+        }
+    }
+
+    size_t ScriptCache::getEntryCount()
+    {
+        return statics ? statics->entries.size() : 0;
+    }
+
+    size_t ScriptCache::getByteSize()
+    {
+        return statics ? statics->byteSize : 0;
+    }
+
+    // ---
+
+    uint64_t ScriptCache::hashSource(const string &source)
+    {
+        uint64_t hash = 14695981039346656037ULL;
+
+        for (auto c : source)
+        {
+            hash = (hash ^ uint8_t(c)) * 1099511628211ULL;
+        }
+
+        return hash;
+    }
+
+    /*
+     * EVICTING THE LEAST-RECENTLY USED SCRIPTS, UNTIL THERE IS ROOM FOR requiredBytes
+     *
+     * LINEAR SEARCH: THE NUMBER OF CACHED SCRIPTS IS EXPECTED TO REMAIN SMALL
+     */
+    void ScriptCache::evict(size_t requiredBytes)
+    {
+        while (!statics->entries.empty() && (statics->byteSize + requiredBytes > MAX_BYTES))
+        {
+            auto oldest = statics->entries.begin();
+
+            for (auto it = statics->entries.begin(); it != statics->entries.end(); ++it)
+            {
+                if (it->second.lastUse < oldest->second.lastUse)
+                {
+                    oldest = it;
+                }
+            }
+
+            statics->byteSize -= oldest->first.size;
+            statics->entries.erase(oldest);
+        }
+    }
+
+    void ScriptCache::trace(JSTracer *trc)
+    {
+        for (auto &element : statics->entries)
+        {
+            JS_CallScriptTracer(trc, &element.second.script, "ScriptCache");
+        }
+    }
+}
@@ -0,0 +1,117 @@
+/*
+ * JSP: https://github.com/arielm/jsp
+ * COPYRIGHT (C) 2014-2015, ARIEL MALKA ALL RIGHTS RESERVED.
+ *
+ * THE FOLLOWING SOURCE-CODE IS DISTRIBUTED UNDER THE SIMPLIFIED BSD LICENSE:
+ * https://github.com/arielm/jsp/blob/master/LICENSE
+ */
+
+/*
+ * CACHE OF COMPILED SCRIPTS, USED BY Proto::exec() AND Proto::eval()
+ *
+ * - ONLY NAMED SOURCES ARE CACHED (I.E. WITH A FILE-NAME, AS WITH executeScript(InputSource) OR executeScript(source, file)):
+ *   ANONYMOUS SOURCES (ONE-OFF, DYNAMICALLY BUILT, ETC.) ARE COMPILED WITHOUT BEING RETAINED
+ * - KEYED BY SOURCE-HASH, SOURCE-SIZE, FILE-NAME, LINE AND "FLAVOR" (I.E. WITH OR WITHOUT RETURN-VALUE)
+ * - THE SOURCE ITSELF IS KEPT AND COMPARED UPON LOOKUP: A HASH-COLLISION IS A MISS
+ * - THE CACHED SCRIPTS ARE TRACED VIA JSP::addTracerCallback()
+ * - NO POST-BARRIER REQUIRED: SCRIPTS ARE NEVER ALLOCATED IN THE NURSERY
+ * - MEMORY-CAP: EXPRESSED IN SOURCE-BYTES (THE CACHE AND SPIDERMONKEY BOTH RETAIN THE SOURCE OF EACH SCRIPT, PLUS BYTECODE PROPORTIONAL TO IT)
+ *   - THE LEAST-RECENTLY USED SCRIPTS ARE EVICTED FIRST
+ *
+ * LIMITATIONS:
+ * - THE SOURCE STILL NEEDS TO BE READ (AND HASHED) IN ORDER TO BE LOOKED-UP
+ * - SCRIPTS ARE COMPILED FOR THE GLOBAL OBJECT ("COMPILE-AND-GO"): THE CACHE IS CLEARED UPON ScriptCache::uninit()
+ */
+
+#pragma once
+
+#include "jsp/Context.h"
+
+#include <unordered_map>
+
+namespace jsp
+{
+    class ScriptCache
+    {
+    public:
+        static size_t MAX_BYTES;
+
+        static bool init();
+        static void uninit();
+
+        /*
+         * RETURNS A CACHED SCRIPT, OR COMPILES (AND CACHES) A NEW ONE
+         * RETURNS NULL UPON COMPILATION-ERROR
+         *
+         * NOTHING IS CACHED IF THE CACHE IS NOT INITIALIZED, OR IF options HAS NO FILE-NAME
+         */
+        static JSScript* compile(const std::string &source, const ReadOnlyCompileOptions &options);
+
+        /*
+         * EXPLICIT INVALIDATION, E.G. WHEN A FILE HAS BEEN MODIFIED
+         */
+        static void invalidate(const std::string &file);
+        static void clear();
+
+        // ---
+
+        static uint32_t getHitCount();
+        static uint32_t getMissCount();
+        static void resetCounters();
+
+        static size_t getEntryCount();
+        static size_t getByteSize();
+
+        /*
+         * 64-BIT FNV-1A: NEGLIGIBLE, COMPARED TO PARSING AND COMPILING
+         */
+        static uint64_t hashSource(const std::string &source);
+
+    private:
+        struct Key
+        {
+            uint64_t hash;
+            size_t size;
+            std::string file;
+            unsigned line;
+            bool noScriptRval;
+
+            bool operator==(const Key &other) const
+            {
+                return (hash == other.hash) && (size == other.size) && (line == other.line) && (noScriptRval == other.noScriptRval) && (file == other.file);
+            }
+        };
+
+        struct KeyHasher
+        {
+            size_t operator()(const Key &key) const
+            {
+                return size_t(key.hash ^ (std::hash<std::string>()(key.file) + key.line));
+            }
+        };
+
+        struct Entry
+        {
+            JSScript *script;
+            uint64_t lastUse;
+            std::string source;
+        };
+
+        struct Statics
+        {
+            std::unordered_map<Key, Entry, KeyHasher> entries;
+
+            size_t byteSize = 0;
+            uint64_t useCounter = 0;
+
+            uint32_t hitCount = 0;
+            uint32_t missCount = 0;
+        };
+
+        static thread_local Statics *statics;
+
+        static void evict(size_t requiredBytes);
+
+        static void trace(JSTracer *trc);
+    };
+}
@@ -0,0 +1,236 @@
+/*
+ * JSP: https://github.com/arielm/jsp
+ * COPYRIGHT (C) 2014-2015, ARIEL MALKA ALL RIGHTS RESERVED.
+ *
+ * THE FOLLOWING SOURCE-CODE IS DISTRIBUTED UNDER THE SIMPLIFIED BSD LICENSE:
+ * https://github.com/arielm/jsp/blob/master/LICENSE
+ */
+
+#include "jsp/ScriptLoader.h"
+
+#include "chronotext/Log.h"
+#include "chronotext/utils/Utils.h"
+
+using namespace std;
+using namespace chr;
+
+namespace jsp
+{
+    int ScriptLoader::IO_THREAD_COUNT = 4;
+    bool ScriptLoader::LOG_VERBOSE = false;
+
+    namespace
+    {
+        inline double getElapsedSeconds(const chrono::steady_clock::time_point &since)
+        {
+            return chrono::duration<double>(chrono::steady_clock::now() - since).count();
+        }
+    }
+
+    ScriptLoader::ScriptLoader(const vector<InputSource::Ref> &inputSources)
+    :
+    entries(inputSources.size())
+    {
+        for (size_t i = 0; i < inputSources.size(); i++)
+        {
+            entries[i].inputSource = inputSources[i];
+            entries[i].timing.file = inputSources[i]->getFilePathHint();
+        }
+    }
+
+    /*
+     * THE I/O THREADS ARE NOT READING ANY NEW INPUT-SOURCE AFTER cancelled IS SET
+     */
+    ScriptLoader::~ScriptLoader()
+    {
+        cancelled = true;
+
+        for (auto &ioThread : ioThreads)
+        {
+            ioThread.join();
+        }
+    }
+
+    void ScriptLoader::start()
+    {
+        if (!started)
+        {
+            started = true;
+            startTime = chrono::steady_clock::now();
+
+            int threadCount = min<int>(IO_THREAD_COUNT, entries.size());
+
+            for (int i = 0; i < threadCount; i++)
+            {
+                ioThreads.emplace_back(&ScriptLoader::read, this);
+            }
+        }
+    }
+
+    bool ScriptLoader::update()
+    {
+        if (started && !isDone())
+        {
+            startCompilations();
+
+            while (!isDone())
+            {
+                auto &entry = entries[executionIndex];
+
+                if (entry.handled && !entry.task)
+                {
+                    LOGI << "ScriptLoader: INPUT-SOURCE ERROR | " << entry.timing.file << endl;
+
+                    stop(false);
+                    break;
+                }
+
+                if (!entry.handled || !entry.task->isCompiled())
+                {
+                    break;
+                }
+
+                execute(entry);
+            }
+        }
+
+        return isDone();
+    }
+
+    bool ScriptLoader::run()
+    {
+        start();
+
+        while (!update())
+        {
+            auto &entry = entries[executionIndex];
+
+            if (entry.task)
+            {
+                entry.task->finish(); // I.E. WAITING FOR THE HELPER THREAD
+            }
+            else
+            {
+                unique_lock<mutex> lock(readMutex);
+                readCondition.wait(lock, [this] { return readCount > handledCount; });
+            }
+        }
+
+        return !failed;
+    }
+
+    vector<ScriptLoader::Timing> ScriptLoader::getTimings() const
+    {
+        vector<Timing> timings;
+
+        for (size_t i = 0; i < executionIndex; i++)
+        {
+            timings.push_back(entries[i].timing);
+        }
+
+        return timings;
+    }
+
+    // ---
+
+    /*
+     * INVOKED ON THE I/O THREADS
+     */
+    void ScriptLoader::read()
+    {
+        while (!cancelled)
+        {
+            size_t index = nextReadIndex++;
+
+            if (index >= entries.size())
+            {
+                break;
+            }
+
+            auto &entry = entries[index];
+            auto readStart = chrono::steady_clock::now();
+
+            try
+            {
+                entry.source = utils::readText<string>(entry.inputSource);
+                entry.timing.readSeconds = getElapsedSeconds(readStart);
+                entry.readState = READ_DONE;
+            }
+            catch (exception &e)
+            {
+                entry.readState = READ_FAILED;
+            }
+
+            {
+                lock_guard<mutex> lock(readMutex);
+                readCount++;
+            }
+
+            readCondition.notify_all();
+        }
+    }
+
+    void ScriptLoader::startCompilations()
+    {
+        for (auto &entry : entries)
+        {
+            if (!entry.handled && (entry.readState != READ_PENDING))
+            {
+                if (entry.readState == READ_DONE)
+                {
+                    /*
+                     * THE CALLBACK IS PREVENTING CompileTask::dispatch() FROM EXECUTING THE SCRIPT OUT OF ORDER
+                     */
+                    entry.task = CompileTask::start(entry.source, entry.timing.file, 1, [](CompileTask&) {});
+
+                    entry.source.clear();
+                    entry.source.shrink_to_fit();
+                }
+
+                entry.handled = true;
+                handledCount++;
+            }
+        }
+    }
+
+    void ScriptLoader::execute(Entry &entry)
+    {
+        entry.timing.compileSeconds = entry.task->getCompileSeconds();
+        auto executionStart = chrono::steady_clock::now();
+
+        try
+        {
+            entry.task->execute();
+        }
+        catch (exception &e)
+        {
+            stop(false);
+            return;
+        }
+
+        entry.timing.executeSeconds = getElapsedSeconds(executionStart);
+        entry.task.reset();
+
+        if (LOG_VERBOSE)
+        {
+            LOGI << "ScriptLoader: " << entry.timing.file << " | READ: " << entry.timing.readSeconds * 1000 << " ms | COMPILE: " << entry.timing.compileSeconds * 1000 << " ms | EXECUTE: " << entry.timing.executeSeconds * 1000 << " ms" << endl;
+        }
+
+        if (++executionIndex == entries.size())
+        {
+            stop(true);
+        }
+    }
+
+    void ScriptLoader::stop(bool success)
+    {
+        failed = !success;
+        cancelled = true;
+        totalSeconds = getElapsedSeconds(startTime);
+
+        if (LOG_VERBOSE)
+        {
+            LOGI << "ScriptLoader: " << executionIndex << "/" << entries.size() << " SCRIPTS EXECUTED | TOTAL: " << totalSeconds * 1000 << " ms" << endl;
+        }
+    }
+}
@@ -0,0 +1,140 @@
+/*
+ * JSP: https://github.com/arielm/jsp
+ * COPYRIGHT (C) 2014-2015, ARIEL MALKA ALL RIGHTS RESERVED.
+ *
+ * THE FOLLOWING SOURCE-CODE IS DISTRIBUTED UNDER THE SIMPLIFIED BSD LICENSE:
+ * https://github.com/arielm/jsp/blob/master/LICENSE
+ */
+
+/*
+ * PIPELINED LOADING OF SEVERAL SCRIPTS:
+ *
+ * 1) THE INPUT-SOURCES ARE READ IN PARALLEL, ON A POOL OF I/O THREADS (SEE IO_THREAD_COUNT)
+ * 2) EACH SCRIPT IS COMPILED AS SOON AS IT ARRIVES, REGARDLESS OF THE DECLARED ORDER (SEE CompileTask)
+ * 3) THE SCRIPTS ARE EXECUTED ON THE MAIN THREAD, IN DECLARED ORDER
+ *
+ * - THE LOADING STOPS UPON THE FIRST FAILURE (I.E. INPUT-SOURCE, COMPILATION OR EXECUTION ERROR)
+ * - THE TIME SPENT IN EACH STAGE IS MEASURED PER SCRIPT (SEE getTimings() AND LOG_VERBOSE)
+ *
+ * LIMITATIONS:
+ * - THE INPUT-SOURCES MUST BE READABLE FROM ANY THREAD
+ *
+ * USAGE, BLOCKING:
+ *
+ * ScriptLoader loader({InputSource::getAsset("a.js"), InputSource::getAsset("b.js")});
+ * bool success = loader.run();
+ *
+ * USAGE, NON-BLOCKING:
+ *
+ * loader.start();
+ * loader.update(); // ONCE PER FRAME, UNTIL IT RETURNS TRUE
+ */
+
+#pragma once
+
+#include "jsp/CompileTask.h"
+
+#include "chronotext/InputSource.h"
+
+#include <thread>
+
+namespace jsp
+{
+    class ScriptLoader
+    {
+    public:
+        static int IO_THREAD_COUNT;
+        static bool LOG_VERBOSE;
+
+        struct Timing
+        {
+            std::string file;
+
+            double readSeconds = 0;
+            double compileSeconds = 0; // INCLUDING THE TIME SPENT WAITING FOR A HELPER THREAD
+            double executeSeconds = 0;
+        };
+
+        ScriptLoader(const std::vector<chr::InputSource::Ref> &inputSources);
+        ~ScriptLoader();
+
+        void start();
+
+        /*
+         * NON-BLOCKING: STARTS THE COMPILATION OF THE SCRIPTS READ IN THE MEANTIME, AND EXECUTES THE NEXT COMPILED ONES
+         *
+         * RETURNS TRUE WHEN THE LOADING IS OVER
+         */
+        bool update();
+
+        /*
+         * BLOCKING: RETURNS FALSE UPON FAILURE
+         */
+        bool run();
+
+        bool isDone() const
+        {
+            return failed || (executionIndex == entries.size());
+        }
+
+        bool hasFailed() const
+        {
+            return failed;
+        }
+
+        /*
+         * ONLY FOR THE EXECUTED SCRIPTS
+         */
+        std::vector<Timing> getTimings() const;
+
+        /*
+         * BETWEEN start() AND THE END OF THE LOADING
+         */
+        double getTotalSeconds() const
+        {
+            return totalSeconds;
+        }
+
+    protected:
+        enum
+        {
+            READ_PENDING,
+            READ_DONE,
+            READ_FAILED
+        };
+
+        struct Entry
+        {
+            chr::InputSource::Ref inputSource;
+            std::string source;
+            std::atomic<int> readState {READ_PENDING};
+
+            bool handled = false; // MAIN THREAD
+            Timing timing;
+            CompileTask::Ref task;
+        };
+
+        std::vector<Entry> entries;
+        std::vector<std::thread> ioThreads;
+
+        std::atomic<size_t> nextReadIndex {0};
+        std::atomic<size_t> readCount {0};
+        std::atomic<bool> cancelled {false};
+
+        std::mutex readMutex;
+        std::condition_variable readCondition;
+
+        size_t handledCount = 0;
+        size_t executionIndex = 0;
+        bool started = false;
+        bool failed = false;
+
+        std::chrono::steady_clock::time_point startTime;
+        double totalSeconds = 0;
+
+        void read();
+        void startCompilations();
+        void execute(Entry &entry);
+        void stop(bool success);
+    };
+}
@@ -0,0 +1,128 @@
+/*
+ * JSP: https://github.com/arielm/jsp
+ * COPYRIGHT (C) 2014-2015, ARIEL MALKA ALL RIGHTS RESERVED.
+ *
+ * THE FOLLOWING SOURCE-CODE IS DISTRIBUTED UNDER THE SIMPLIFIED BSD LICENSE:
+ * https://github.com/arielm/jsp/blob/master/LICENSE
+ */
+
+#include "jsp/Struct.h"
+
+#if defined(JSP_USE_PRIVATE_APIS)
+#include "jsinferinlines.h"
+#include "jsobjinlines.h"
+#endif
+
+using namespace std;
+using namespace JS;
+
+namespace jsp
+{
+    StructTemplate::StructTemplate(const vector<const char*> &names)
+    {
+        for (auto name : names)
+        {
+            bind(name);
+        }
+    }
+
+    /*
+     * NOTHING TO UNREGISTER IF THE TEMPLATE BELONGS TO A PREVIOUS RUNTIME, E.G. STATICS DESTROYED AFTER JSP::uninit()
+     */
+    StructTemplate::~StructTemplate()
+    {
+#if defined(JSP_USE_PRIVATE_APIS)
+        if (templateObject && (templateGeneration == JSP::getGeneration()))
+        {
+            JSP::removeTracerCallback(this);
+        }
+#endif
+    }
+
+    JSObject* StructTemplate::newObject()
+    {
+#if defined(JSP_USE_PRIVATE_APIS)
+        if ((templateObject && (templateGeneration == JSP::getGeneration())) || createTemplate())
+        {
+            RootedObject baseObject(cx, templateObject);
+            return js::CopyInitializerObject(cx, baseObject);
+        }
+
+        return nullptr;
+#else
+        return JS_NewObject(cx, nullptr, NullPtr(), NullPtr());
+#endif
+    }
+
+    bool StructTemplate::setField(HandleObject object, size_t index, HandleValue value)
+    {
+#if defined(JSP_USE_PRIVATE_APIS)
+        js::types::AddTypePropertyId(cx, object, keys[index].get(), value); // I.E. WHAT JSOP_INITPROP IS DOING
+        object->nativeSetSlot(templateSlots[index], value);
+
+        return true;
+#else
+        return JS_DefinePropertyById(cx, object, keys[index].get(), value, nullptr, nullptr, JSPROP_ENUMERATE);
+#endif
+    }
+
+#if defined(JSP_USE_PRIVATE_APIS)
+
+    /*
+     * ASSERTIONS REGARDING THE TEMPLATE OBJECT:
+     *
+     * - IT IS TENURED, WITH ENOUGH FIXED-SLOTS FOR UP TO 16 FIELDS
+     * - IT IS NOT IN "DICTIONARY MODE" (REQUIRED BY CopyInitializerObject)
+     * - ITS PROPERTIES ARE DEFINED VIA THE REGULAR PATH, I.E. TYPE-INFERENCE IS AWARE OF THEM
+     */
+    bool StructTemplate::createTemplate()
+    {
+        if (templateObject && (templateGeneration == JSP::getGeneration()))
+        {
+            JSP::removeTracerCallback(this);
+        }
+
+        templateObject = nullptr;
+        templateSlots.clear();
+
+        RootedObject object(cx, js::NewBuiltinClassInstance(cx, &JSObject::class_, js::gc::GetGCObjectKind(keys.size()), js::TenuredObject));
+
+        if (!object)
+        {
+            return false;
+        }
+
+        for (auto &key : keys)
+        {
+            if (!JS_DefinePropertyById(cx, object, key.get(), UndefinedValue(), nullptr, nullptr, JSPROP_ENUMERATE))
+            {
+                return false;
+            }
+
+            js::Shape *shape = object->nativeLookup(cx, key.get());
+
+            if (!shape || !shape->hasSlot())
+            {
+                return false;
+            }
+
+            templateSlots.push_back(shape->slot());
+        }
+
+        JS_ASSERT(!object->inDictionaryMode());
+
+        templateObject = object;
+        templateGeneration = JSP::getGeneration();
+
+        JSP::addTracerCallback(this, BIND_INSTANCE1(&StructTemplate::trace, this));
+
+        return true;
+    }
+
+    void StructTemplate::trace(JSTracer *trc)
+    {
+        JS_CallObjectTracer(trc, &templateObject, "StructTemplate");
+    }
+
+#endif
+}
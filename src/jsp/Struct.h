@@ -0,0 +1,245 @@
+/*
+ * JSP: https://github.com/arielm/jsp
+ * COPYRIGHT (C) 2014-2015, ARIEL MALKA ALL RIGHTS RESERVED.
+ *
+ * THE FOLLOWING SOURCE-CODE IS DISTRIBUTED UNDER THE SIMPLIFIED BSD LICENSE:
+ * https://github.com/arielm/jsp/blob/master/LICENSE
+ */
+
+/*
+ * C++ STRUCT <-> JS OBJECT MARSHALLING, WITH FIELDS DECLARED ONCE AT COMPILE-TIME
+ *
+ * - THE FIELDS ARE VISITED VIA A std::tuple (NO PER-FIELD VIRTUAL CALLS, NO PER-FIELD STRING HANDLING)
+ * - CONVERSION VIA JSP::toValue<T>() AND JSP::convertMaybe() (I.E. SAME RULES AS Proto::get<T>() AND Proto::set())
+ * - PROPERTY-NAMES ARE RESOLVED ONCE, AS PropertyKey
+ *
+ * toJS():
+ * - WITH JSP_USE_PRIVATE_APIS: ONE ALLOCATION, COPYING THE SHAPE OF A "TEMPLATE OBJECT" (I.E. LIKE THE JSOP_NEWOBJECT
+ *   OPCODE USED FOR OBJECT-LITERALS), FOLLOWED BY DIRECT SLOT WRITES
+ * - OTHERWISE: ONE JS_DefinePropertyById PER FIELD
+ *
+ * fromJS():
+ * - VIA A ShapeCache (SEE StructReader.h): OBJECTS CREATED VIA toJS() ARE ALWAYS "HITTING"
+ * - RETURNS FALSE IF A PROPERTY COULD NOT BE OBTAINED OR CONVERTED (THE CORRESPONDING MEMBER IS LEFT UNTOUCHED)
+ *
+ * USAGE (AT GLOBAL SCOPE):
+ *
+ * struct Entity
+ * {
+ *     float x;
+ *     float y;
+ *     std::string name;
+ * };
+ *
+ * JSP_STRUCT(Entity, JSP_STRUCT_FIELD(Entity, x), JSP_STRUCT_FIELD(Entity, y), JSP_STRUCT_FIELD(Entity, name))
+ *
+ * RootedObject object(cx, Struct<Entity>::toJS(entity));
+ * Struct<Entity>::fromJS(object, entity);
+ */
+
+#pragma once
+
+#include "jsp/StructReader.h"
+
+#include <tuple>
+
+#define JSP_STRUCT_FIELD(S, NAME) jsp::makeStructField(#NAME, &S::NAME)
+
+#define JSP_STRUCT(S, ...) \
+namespace jsp \
+{ \
+    template<> \
+    struct StructTraits<S> \
+    { \
+        typedef decltype(std::make_tuple(__VA_ARGS__)) Fields; \
+        \
+        static const Fields& fields() \
+        { \
+            static const Fields instance = std::make_tuple(__VA_ARGS__); \
+            return instance; \
+        } \
+    }; \
+}
+
+namespace jsp
+{
+    template<class S, typename T>
+    struct StructField
+    {
+        const char *name;
+        T S::*member;
+    };
+
+    template<class S, typename T>
+    inline StructField<S, T> makeStructField(const char *name, T S::*member)
+    {
+        return StructField<S, T>{name, member};
+    }
+
+    /*
+     * SPECIALIZED VIA JSP_STRUCT
+     */
+    template<class S>
+    struct StructTraits;
+
+    // ---
+
+    class StructTemplate : public ShapeCache
+    {
+    public:
+        StructTemplate(const std::vector<const char*> &names);
+        ~StructTemplate();
+
+        /*
+         * RETURNS AN OBJECT READY FOR setField() CALLS, OR NULL UPON FAILURE
+         */
+        JSObject* newObject();
+
+        /*
+         * ONLY FOR OBJECTS RETURNED BY newObject(), WITH EACH FIELD SET EXACTLY ONCE
+         */
+        bool setField(HandleObject object, size_t index, HandleValue value);
+
+    protected:
+#if defined(JSP_USE_PRIVATE_APIS)
+        JSObject *templateObject = nullptr;
+        std::vector<uint32_t> templateSlots;
+        uint32_t templateGeneration = 0;
+
+        bool createTemplate();
+        void trace(JSTracer *trc);
+#endif
+    };
+
+    // ---
+
+    template<class S>
+    class Struct
+    {
+    public:
+        /*
+         * RETURNS NULL UPON FAILURE
+         */
+        static JSObject* toJS(const S &source)
+        {
+            StructTemplate &structTemplate = getTemplate();
+            RootedObject object(cx, structTemplate.newObject());
+
+            if (object)
+            {
+                Writer writer(structTemplate, object, source);
+                forEach<0>(writer);
+
+                if (writer.success)
+                {
+                    return object;
+                }
+            }
+
+            return nullptr;
+        }
+
+        static bool fromJS(HandleObject object, S &target)
+        {
+            AutoValueVector values(cx);
+
+            if (getTemplate().get(object, values))
+            {
+                Reader reader(values, target);
+                forEach<0>(reader);
+
+                return reader.success;
+            }
+
+            return false;
+        }
+
+        static uint32_t getHitCount() { return getTemplate().getHitCount(); }
+        static uint32_t getMissCount() { return getTemplate().getMissCount(); }
+        static void resetCounters() { getTemplate().resetCounters(); }
+
+    protected:
+        typedef typename StructTraits<S>::Fields Fields;
+        static constexpr size_t FIELD_COUNT = std::tuple_size<Fields>::value;
+
+        struct Writer
+        {
+            StructTemplate &structTemplate;
+            HandleObject object;
+            const S &source;
+            bool success = true;
+
+            Writer(StructTemplate &structTemplate, HandleObject object, const S &source)
+            :
+            structTemplate(structTemplate),
+            object(object),
+            source(source)
+            {}
+
+            template<typename T>
+            void operator()(const StructField<S, T> &field, size_t index)
+            {
+                if (success)
+                {
+                    RootedValue value(cx, JSP::toValue<T>(source.*field.member));
+                    success = structTemplate.setField(object, index, value);
+                }
+            }
+        };
+
+        struct Reader
+        {
+            AutoValueVector &values;
+            S &target;
+            bool success = true;
+
+            Reader(AutoValueVector &values, S &target)
+            :
+            values(values),
+            target(target)
+            {}
+
+            template<typename T>
+            void operator()(const StructField<S, T> &field, size_t index)
+            {
+                success &= JSP::convertMaybe(values[index], target.*field.member);
+            }
+        };
+
+        struct NameCollector
+        {
+            std::vector<const char*> names;
+
+            template<typename T>
+            void operator()(const StructField<S, T> &field, size_t index)
+            {
+                names.push_back(field.name);
+            }
+        };
+
+        template<size_t I, class V>
+        static typename std::enable_if<(I < FIELD_COUNT)>::type forEach(V &visitor)
+        {
+            visitor(std::get<I>(StructTraits<S>::fields()), I);
+            forEach<I + 1>(visitor);
+        }
+
+        template<size_t I, class V>
+        static typename std::enable_if<(I == FIELD_COUNT)>::type forEach(V &visitor)
+        {}
+
+        static StructTemplate& getTemplate()
+        {
+            static thread_local StructTemplate instance(collectNames()); // I.E. ONE TEMPLATE PER ENGINE
+            return instance;
+        }
+
+        static std::vector<const char*> collectNames()
+        {
+            NameCollector collector;
+            forEach<0>(collector);
+
+            return collector.names;
+        }
+    };
+}
@@ -0,0 +1,122 @@
+/*
+ * JSP: https://github.com/arielm/jsp
+ * COPYRIGHT (C) 2014-2015, ARIEL MALKA ALL RIGHTS RESERVED.
+ *
+ * THE FOLLOWING SOURCE-CODE IS DISTRIBUTED UNDER THE SIMPLIFIED BSD LICENSE:
+ * https://github.com/arielm/jsp/blob/master/LICENSE
+ */
+
+#include "jsp/StructReader.h"
+
+#if defined(JSP_USE_PRIVATE_APIS)
+#include "jsobj.h"
+#include "vm/Shape.h"
+#endif
+
+using namespace std;
+using namespace JS;
+
+namespace jsp
+{
+    void ShapeCache::bind(const string &name)
+    {
+        keys.emplace_back(name);
+
+#if defined(JSP_USE_PRIVATE_APIS)
+        cachedShape = nullptr;
+#endif
+    }
+
+    bool ShapeCache::get(HandleObject object, AutoValueVector &values)
+    {
+        if (!object)
+        {
+            missCount++;
+            return false;
+        }
+
+        if (!values.reserve(values.length() + keys.size()))
+        {
+            return false;
+        }
+
+#if defined(JSP_USE_PRIVATE_APIS)
+        if (cachedShape && (object->lastProperty() == cachedShape))
+        {
+            if ((JS_GetGCParameter(rt, JSGC_NUMBER) == cachedGCNumber) && (JSP::getGeneration() == cachedGeneration))
+            {
+                hitCount++;
+
+                for (auto slot : cachedSlots)
+                {
+                    values.infallibleAppend(object->nativeGetSlot(slot));
+                }
+
+                return true;
+            }
+
+            cachedShape = nullptr;
+        }
+#endif
+
+        missCount++;
+
+        RootedValue value(cx);
+
+        for (auto &key : keys)
+        {
+            if (!JS_GetPropertyById(cx, object, key, &value))
+            {
+                return false;
+            }
+
+            values.infallibleAppend(value);
+        }
+
+#if defined(JSP_USE_PRIVATE_APIS)
+        cache(object);
+#endif
+
+        return true;
+    }
+
+#if defined(JSP_USE_PRIVATE_APIS)
+
+    /*
+     * CACHING ONLY WHEN EACH BOUND PROPERTY IS AN OWN DATA-PROPERTY OF THE OBJECT
+     *
+     * ASSERTION: THE SHAPE CAN'T CHANGE BETWEEN THE JS_GetPropertyById CALLS AND THE LOOKUPS BELOW,
+     * UNLESS A GETTER IS INVOLVED, IN WHICH CASE NOTHING IS CACHED ANYWAY
+     */
+    void ShapeCache::cache(HandleObject object)
+    {
+        cachedShape = nullptr;
+
+        if (!object->isNative() || JS::IsIncrementalGCInProgress(rt))
+        {
+            return;
+        }
+
+        vector<uint32_t> slots;
+        slots.reserve(keys.size());
+
+        for (auto &key : keys)
+        {
+            js::Shape *shape = object->nativeLookup(cx, key.get());
+
+            if (!shape || !shape->hasSlot() || !shape->hasDefaultGetter())
+            {
+                return;
+            }
+
+            slots.push_back(shape->slot());
+        }
+
+        cachedShape = object->lastProperty();
+        cachedSlots = move(slots);
+        cachedGCNumber = JS_GetGCParameter(rt, JSGC_NUMBER);
+        cachedGeneration = JSP::getGeneration();
+    }
+
+#endif
+}
@@ -0,0 +1,160 @@
+/*
+ * JSP: https://github.com/arielm/jsp
+ * COPYRIGHT (C) 2014-2015, ARIEL MALKA ALL RIGHTS RESERVED.
+ *
+ * THE FOLLOWING SOURCE-CODE IS DISTRIBUTED UNDER THE SIMPLIFIED BSD LICENSE:
+ * https://github.com/arielm/jsp/blob/master/LICENSE
+ */
+
+/*
+ * READING THE SAME PROPERTIES FROM MANY JS OBJECTS SHARING THE SAME SHAPE (E.G. ENTITY DESCRIPTORS RETURNED FROM SCRIPT)
+ *
+ * BASED ON THE INVESTIGATIONS IN TestingJS::testShapes1() AND TestingJS::testShapes2():
+ * - OBJECTS CREATED THE SAME WAY ARE SHARING THEIR "LAST PROPERTY" (I.E. THEIR SHAPE)
+ * - FOR A GIVEN SHAPE, EACH OWN DATA-PROPERTY IS ALWAYS STORED IN THE SAME SLOT
+ *
+ * ShapeCache IS A "MONOMORPHIC INLINE-CACHE":
+ * - HIT: THE SHAPE OF THE OBJECT IS THE CACHED ONE, AND THE VALUES ARE READ DIRECTLY FROM THE CACHED SLOTS
+ * - MISS: THE VALUES ARE OBTAINED VIA JS_GetPropertyById, AND THE SHAPE IS CACHED IF ALL THE PROPERTIES ARE OWN DATA-PROPERTIES
+ * - THE CACHED SHAPE IS FORGOTTEN UPON EACH GC (I.E. A DEAD SHAPE'S ADDRESS CAN'T BE REUSED "BEHIND OUR BACK")
+ * - NOTHING IS CACHED WHILE AN INCREMENTAL GC IS IN PROGRESS
+ * - THE CACHED SHAPE IS ALSO FORGOTTEN WHEN JSP IS RE-INITIALIZED (SEE JSP::getGeneration)
+ * - WITHOUT JSP_USE_PRIVATE_APIS: ALWAYS "MISSING"
+ *
+ * USAGE:
+ *
+ * struct Entity
+ * {
+ *     float x;
+ *     float y;
+ *     std::string name;
+ * };
+ *
+ * StructReader<Entity> reader;
+ * reader.bind("x", &Entity::x).bind("y", &Entity::y).bind("name", &Entity::name);
+ *
+ * Entity entity;
+ * reader.read(object, entity);
+ */
+
+#pragma once
+
+#include "jsp/PropertyKey.h"
+
+#include <memory>
+
+#if defined(JSP_USE_PRIVATE_APIS)
+namespace js
+{
+    class Shape;
+}
+#endif
+
+namespace jsp
+{
+    class ShapeCache
+    {
+    public:
+        ShapeCache() = default;
+
+        void bind(const std::string &name);
+
+        /*
+         * APPENDS ONE VALUE PER BOUND PROPERTY
+         * RETURNS FALSE IF object IS NULL, OR IF A PROPERTY COULD NOT BE OBTAINED
+         */
+        bool get(HandleObject object, AutoValueVector &values);
+
+        uint32_t getHitCount() const { return hitCount; }
+        uint32_t getMissCount() const { return missCount; }
+        void resetCounters() { hitCount = missCount = 0; }
+
+        size_t size() const { return keys.size(); }
+
+    protected:
+        std::vector<PropertyKey> keys;
+
+        uint32_t hitCount = 0;
+        uint32_t missCount = 0;
+
+#if defined(JSP_USE_PRIVATE_APIS)
+        js::Shape *cachedShape = nullptr;
+        std::vector<uint32_t> cachedSlots;
+        uint32_t cachedGCNumber = 0;
+        uint32_t cachedGeneration = 0;
+
+        void cache(HandleObject object);
+#endif
+
+        ShapeCache(const ShapeCache &other) = delete;
+        void operator=(const ShapeCache &other) = delete;
+    };
+
+    // ---
+
+    template<class S>
+    class StructReader
+    {
+    public:
+        template<typename T>
+        StructReader& bind(const std::string &name, T S::*member)
+        {
+            cache.bind(name);
+            fields.emplace_back(new Field<T>(member));
+
+            return *this;
+        }
+
+        /*
+         * RETURNS FALSE IF A PROPERTY COULD NOT BE OBTAINED OR CONVERTED (THE CORRESPONDING MEMBER IS LEFT UNTOUCHED)
+         */
+        bool read(HandleObject object, S &target)
+        {
+            AutoValueVector values(cx);
+
+            if (cache.get(object, values))
+            {
+                bool success = true;
+
+                for (size_t i = 0; i < fields.size(); i++)
+                {
+                    success &= fields[i]->assign(values[i], target);
+                }
+
+                return success;
+            }
+
+            return false;
+        }
+
+        uint32_t getHitCount() const { return cache.getHitCount(); }
+        uint32_t getMissCount() const { return cache.getMissCount(); }
+        void resetCounters() { cache.resetCounters(); }
+
+    protected:
+        struct FieldBase
+        {
+            virtual ~FieldBase() {}
+            virtual bool assign(HandleValue value, S &target) = 0;
+        };
+
+        template<typename T>
+        struct Field : public FieldBase
+        {
+            T S::*member;
+
+            Field(T S::*member)
+            :
+            member(member)
+            {}
+
+            bool assign(HandleValue value, S &target) final
+            {
+                return JSP::convertMaybe(value, target.*member);
+            }
+        };
+
+        ShapeCache cache;
+        std::vector<std::unique_ptr<FieldBase>> fields;
+    };
+}
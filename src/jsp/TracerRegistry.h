@@ -0,0 +1,195 @@
+/*
+ * JSP: https://github.com/arielm/jsp
+ * COPYRIGHT (C) 2014-2015, ARIEL MALKA ALL RIGHTS RESERVED.
+ *
+ * THE FOLLOWING SOURCE-CODE IS DISTRIBUTED UNDER THE SIMPLIFIED BSD LICENSE:
+ * https://github.com/arielm/jsp/blob/master/LICENSE
+ */
+
+/*
+ * DENSE REGISTRY OF EXTRA-ROOTS, USED BY JSP FOR TRACING Heap<WrappedValue> AND Heap<WrappedObject>
+ *
+ * - THE ENTRIES ARE STORED CONTIGUOUSLY (I.E. TRACING IS A SINGLE LINEAR LOOP, WITHOUT std::function)
+ * - AN OPEN-ADDRESSING TABLE MAPS EACH ADDRESS TO ITS INDEX IN THE DENSE ARRAY:
+ *   - add() AND remove() ARE O(1) (AMORTIZED), WITHOUT ANY PER-OPERATION HEAP-ALLOCATION
+ *   - add() IS IDEMPOTENT, WHICH IS NECESSARY BECAUSE Heap<T>::set() CAN TRIGGER SEVERAL
+ *     POST-BARRIERS FOR THE SAME ADDRESS WITHOUT ANY RELOCATION IN BETWEEN
+ *
+ * WHY NOT STORING THE INDEX "INTRUSIVELY"?
+ * - WrappedValue MUST REMAIN BINARY-COMPATIBLE WITH JS::Value (E.G. AutoWrappedValueVector)
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace jsp
+{
+    template<class T>
+    class TracerRegistry
+    {
+    public:
+        bool add(T *instance)
+        {
+            if ((entries.size() + 1) * 2 > slots.size())
+            {
+                rehash(slots.empty() ? MIN_CAPACITY : slots.size() * 2);
+            }
+
+            size_t slot = find(instance);
+
+            if (!slots[slot].instance)
+            {
+                slots[slot].instance = instance;
+                slots[slot].index = uint32_t(entries.size());
+
+                entries.push_back(instance);
+                return true;
+            }
+
+            return false; // I.E. ALREADY REGISTERED
+        }
+
+        bool remove(T *instance)
+        {
+            if (!slots.empty())
+            {
+                size_t slot = find(instance);
+
+                if (slots[slot].instance)
+                {
+                    /*
+                     * "SWAP AND POP": THE LAST ENTRY IS MOVED INTO THE FREED INDEX
+                     */
+                    uint32_t index = slots[slot].index;
+                    T *last = entries.back();
+
+                    if (last != instance)
+                    {
+                        entries[index] = last;
+                        slots[find(last)].index = index;
+                    }
+
+                    entries.pop_back();
+                    erase(slot);
+
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        void clear()
+        {
+            entries.clear();
+            slots.clear();
+        }
+
+        size_t size() const
+        {
+            return entries.size();
+        }
+
+        /*
+         * HEAP-MEMORY RESERVED BY THE REGISTRY ITSELF
+         */
+        size_t getByteSize() const
+        {
+            return entries.capacity() * sizeof(T*) + slots.capacity() * sizeof(Slot);
+        }
+
+        /*
+         * THE CALLBACK IS EXPECTED TO BE INLINED (E.G. A LAMBDA)
+         */
+        template<typename F>
+        void forEach(F &&fn) const
+        {
+            for (auto instance : entries)
+            {
+                fn(instance);
+            }
+        }
+
+    protected:
+        static constexpr size_t MIN_CAPACITY = 64;
+
+        struct Slot
+        {
+            T *instance;
+            uint32_t index;
+        };
+
+        std::vector<T*> entries;
+        std::vector<Slot> slots; // CAPACITY IS ALWAYS A POWER OF 2
+
+        static size_t hash(const T *instance)
+        {
+            auto h = uintptr_t(instance) >> 3; // GC-THINGS AND WRAPPERS ARE (AT LEAST) 8-BYTES ALIGNED
+            h ^= (h >> 16);
+            h *= 0x45d9f3b;
+            h ^= (h >> 16);
+
+            return size_t(h);
+        }
+
+        /*
+         * RETURNS THE SLOT CONTAINING instance, OR THE EMPTY SLOT WHERE IT SHOULD BE INSERTED
+         */
+        size_t find(const T *instance) const
+        {
+            const size_t mask = slots.size() - 1;
+            size_t slot = hash(instance) & mask;
+
+            while (slots[slot].instance && (slots[slot].instance != instance))
+            {
+                slot = (slot + 1) & mask;
+            }
+
+            return slot;
+        }
+
+        /*
+         * LINEAR-PROBING DELETION WITHOUT TOMBSTONES ("BACKWARD SHIFT")
+         */
+        void erase(size_t slot)
+        {
+            const size_t mask = slots.size() - 1;
+            size_t next = slot;
+
+            while (true)
+            {
+                next = (next + 1) & mask;
+
+                if (!slots[next].instance)
+                {
+                    break;
+                }
+
+                size_t ideal = hash(slots[next].instance) & mask;
+
+                if (((next - ideal) & mask) >= ((next - slot) & mask))
+                {
+                    slots[slot] = slots[next];
+                    slot = next;
+                }
+            }
+
+            slots[slot].instance = nullptr;
+        }
+
+        void rehash(size_t capacity)
+        {
+            slots.assign(capacity, Slot {nullptr, 0});
+
+            for (uint32_t index = 0; index < entries.size(); index++)
+            {
+                size_t slot = find(entries[index]);
+                slots[slot].instance = entries[index];
+                slots[slot].index = index;
+            }
+        }
+    };
+}
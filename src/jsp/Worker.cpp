@@ -0,0 +1,283 @@
+/*
+ * JSP: https://github.com/arielm/jsp
+ * COPYRIGHT (C) 2014-2015, ARIEL MALKA ALL RIGHTS RESERVED.
+ *
+ * THE FOLLOWING SOURCE-CODE IS DISTRIBUTED UNDER THE SIMPLIFIED BSD LICENSE:
+ * https://github.com/arielm/jsp/blob/master/LICENSE
+ */
+
+#include "jsp/Worker.h"
+
+#include "chronotext/Log.h"
+
+using namespace std;
+using namespace chr;
+
+namespace jsp
+{
+    size_t Worker::QUEUE_CAPACITY = 1024;
+
+    thread_local Worker* Worker::current = nullptr;
+
+    Worker::Worker(const string &source, const string &file)
+    :
+    Proxy(PeerProperties("Worker", false)),
+    source(source),
+    file(file),
+    running(false),
+    inbox(QUEUE_CAPACITY),
+    outbox(QUEUE_CAPACITY)
+    {
+        registerNativeCall("postMessage", this, &Worker::nativePostMessage);
+        registerNativeCall("terminate", this, &Worker::nativeTerminate);
+    }
+
+    Worker::~Worker()
+    {
+        terminate();
+    }
+
+    bool Worker::start()
+    {
+        if (!workerThread.joinable())
+        {
+            running = true;
+            workerThread = thread(&Worker::run, this);
+
+            return true;
+        }
+
+        return false;
+    }
+
+    void Worker::terminate()
+    {
+        if (workerThread.joinable())
+        {
+            {
+                lock_guard<mutex> lock(wakeMutex);
+                running = false;
+            }
+
+            wakeCondition.notify_one();
+            workerThread.join();
+        }
+    }
+
+    bool Worker::postMessage(HandleValue message, HandleValue transferables)
+    {
+        if (post(message, transferables))
+        {
+            return true;
+        }
+
+        if (JS_IsExceptionPending(cx))
+        {
+            JS_ReportPendingException(cx);
+            JS_ClearPendingException(cx);
+        }
+
+        return false;
+    }
+
+    /*
+     * BOUNDED: MESSAGES POSTED BY THE WORKER IN THE MEANTIME ARE LEFT FOR THE NEXT INVOCATION
+     */
+    int Worker::dispatchMessages()
+    {
+        int count = 0;
+        RootedObject target(cx, getPeer());
+
+        for (size_t i = 0; i < QUEUE_CAPACITY; i++)
+        {
+            unique_ptr<CloneBuffer> message(outbox.pop());
+
+            if (!message)
+            {
+                break;
+            }
+
+            if (target)
+            {
+                deliver(*message, target);
+            }
+
+            count++;
+        }
+
+        return count;
+    }
+
+    // ---
+
+    unique_ptr<Manager> Worker::createManager()
+    {
+        return unique_ptr<Manager>(new Manager());
+    }
+
+    void Worker::run()
+    {
+        auto manager = createManager();
+
+        if (manager && manager->init())
+        {
+            current = this;
+            JS_DefineFunction(cx, globalHandle(), "postMessage", function_postMessage, 2, 0);
+
+            try
+            {
+                executeScript(source, file);
+
+                while (running)
+                {
+                    unique_ptr<CloneBuffer> message(inbox.pop());
+
+                    if (message)
+                    {
+                        deliver(*message, globalHandle());
+                    }
+                    else
+                    {
+                        unique_lock<mutex> lock(wakeMutex);
+                        wakeCondition.wait(lock, [this] { return !running || !inbox.empty(); });
+                    }
+                }
+            }
+            catch (exception &e)
+            {
+                LOGI << "Worker: " << e.what() << endl;
+            }
+
+            current = nullptr;
+            manager->shutdown();
+        }
+
+        running = false;
+    }
+
+    bool Worker::post(HandleValue message, HandleValue transferables)
+    {
+        if (running && enqueue(inbox, message, transferables))
+        {
+            {
+                lock_guard<mutex> lock(wakeMutex); // I.E. NOT "LOSING" THE NOTIFICATION WHILE THE WORKER IS ABOUT TO WAIT
+            }
+
+            wakeCondition.notify_one();
+            return true;
+        }
+
+        return false;
+    }
+
+    bool Worker::nativePostMessage(const CallArgs &args)
+    {
+        if (post(args.get(0), args.get(1)))
+        {
+            args.rval().setUndefined();
+            return true;
+        }
+
+        if (!JS_IsExceptionPending(cx))
+        {
+            JS_ReportError(cx, "Worker: MESSAGE COULD NOT BE POSTED");
+        }
+
+        return false;
+    }
+
+    bool Worker::nativeTerminate(const CallArgs &args)
+    {
+        terminate();
+
+        args.rval().setUndefined();
+        return true;
+    }
+
+    // ---
+
+    /*
+     * THE CAPACITY IS CHECKED BEFORE SERIALIZING: ONCE SERIALIZED, THE TRANSFERABLES OF THE SENDER ARE NEUTERED,
+     * I.E. THEIR CONTENTS WOULD BE LOST IF THE MESSAGE COULD NOT BE QUEUED
+     *
+     * ERRORS ARE REPORTED AS JS-ERRORS
+     */
+    bool Worker::enqueue(MessageQueue<CloneBuffer> &queue, HandleValue message, HandleValue transferables)
+    {
+        if (queue.full())
+        {
+            JS_ReportError(cx, "Worker: MESSAGE-QUEUE IS FULL");
+            return false;
+        }
+
+        try
+        {
+            unique_ptr<CloneBuffer> buffer(new CloneBuffer(message, transferables));
+
+            if (queue.push(buffer.get())) // I.E. CAN'T FAIL: THIS THREAD IS THE ONLY PRODUCER
+            {
+                buffer.release();
+                return true;
+            }
+        }
+        catch (exception &e)
+        {
+            if (!JS_IsExceptionPending(cx))
+            {
+                JS_ReportError(cx, "Worker: %s", e.what());
+            }
+        }
+
+        return false;
+    }
+
+    /*
+     * ERRORS THROWN BY THE HANDLER ARE REPORTED (SEE Manager::reportError) WITHOUT INTERRUPTING THE DELIVERY OF THE NEXT MESSAGES
+     */
+    void Worker::deliver(CloneBuffer &message, HandleObject target)
+    {
+        RootedValue data(cx);
+
+        if (message.read(&data))
+        {
+            RootedValue handler(cx);
+
+            if (getProperty(target, "onmessage", &handler) && handler.isObject() && JS_ObjectIsCallable(cx, &handler.toObject()))
+            {
+                RootedObject event(cx, newPlainObject());
+
+                if (event && JS_DefineProperty(cx, event, "data", data, JSPROP_ENUMERATE))
+                {
+                    RootedValue eventValue(cx, ObjectValue(*event));
+
+                    try
+                    {
+                        call(target, handler, HandleValueArray(eventValue));
+                    }
+                    catch (exception &e)
+                    {}
+                }
+            }
+        }
+    }
+
+    // ---
+
+    bool Worker::function_postMessage(JSContext *cx, unsigned argc, Value *vp)
+    {
+        auto args = CallArgsFromVp(argc, vp);
+
+        if (current && enqueue(current->outbox, args.get(0), args.get(1)))
+        {
+            args.rval().setUndefined();
+            return true;
+        }
+
+        if (!JS_IsExceptionPending(cx))
+        {
+            JS_ReportError(cx, "Worker: MESSAGE COULD NOT BE POSTED");
+        }
+
+        return false;
+    }
+}
@@ -0,0 +1,195 @@
+/*
+ * JSP: https://github.com/arielm/jsp
+ * COPYRIGHT (C) 2014-2015, ARIEL MALKA ALL RIGHTS RESERVED.
+ *
+ * THE FOLLOWING SOURCE-CODE IS DISTRIBUTED UNDER THE SIMPLIFIED BSD LICENSE:
+ * https://github.com/arielm/jsp/blob/master/LICENSE
+ */
+
+/*
+ * SCRIPTS RUNNING ON A BACKGROUND THREAD, WITH THEIR OWN ENGINE (SEE Manager)
+ *
+ * MESSAGES:
+ * - SERIALIZED AS CloneBuffer, WITH OPTIONAL TRANSFERABLES (I.E. ARRAY-BUFFERS ARE MOVED INSTEAD OF COPIED)
+ * - TRAVELLING VIA TWO SINGLE-PRODUCER / SINGLE-CONSUMER LOCK-FREE QUEUES (ONE PER DIRECTION)
+ * - POSTING FAILS WHEN THE QUEUE IS FULL (SEE QUEUE_CAPACITY)
+ *
+ * WORKER SIDE (GLOBAL SCOPE):
+ * - onmessage = function(event) { ... }   // event.data
+ * - postMessage(data, [transferables])
+ *
+ * MAIN SIDE (VIA THE PEER OF THE Worker, E.G. peers.Worker[0]):
+ * - peer.onmessage = function(event) { ... }
+ * - peer.postMessage(data, [transferables])
+ * - MESSAGES FROM THE WORKER ARE ONLY DELIVERED UPON Worker::dispatchMessages(), E.G. ONCE PER FRAME
+ *
+ * USAGE:
+ *
+ * Worker worker("onmessage = function(event) { postMessage(event.data * 2); }");
+ * worker.start();
+ *
+ * executeScript(worker.getPeerAccessor() + ".onmessage = function(event) { print(event.data); }");
+ * executeScript(worker.getPeerAccessor() + ".postMessage(21)");
+ *
+ * worker.dispatchMessages(); // LATER ON...
+ */
+
+#pragma once
+
+#include "jsp/Proxy.h"
+#include "jsp/CloneBuffer.h"
+#include "jsp/Manager.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace jsp
+{
+    /*
+     * BOUNDED, SINGLE-PRODUCER / SINGLE-CONSUMER, LOCK-FREE
+     *
+     * OWNS THE ITEMS WHICH ARE NOT POPPED
+     */
+    template<typename T>
+    class MessageQueue
+    {
+    public:
+        MessageQueue(size_t capacity)
+        :
+        slots(capacity + 1)
+        {}
+
+        ~MessageQueue()
+        {
+            while (T *item = pop())
+            {
+                delete item;
+            }
+        }
+
+        /*
+         * RETURNS FALSE WHEN FULL (THE ITEM IS NOT ADOPTED)
+         */
+        bool push(T *item)
+        {
+            auto currentTail = tail.load(std::memory_order_relaxed);
+            auto nextTail = (currentTail + 1) % slots.size();
+
+            if (nextTail == head.load(std::memory_order_acquire))
+            {
+                return false;
+            }
+
+            slots[currentTail] = item;
+            tail.store(nextTail, std::memory_order_release);
+
+            return true;
+        }
+
+        /*
+         * RETURNS NULL WHEN EMPTY
+         */
+        T* pop()
+        {
+            auto currentHead = head.load(std::memory_order_relaxed);
+
+            if (currentHead == tail.load(std::memory_order_acquire))
+            {
+                return nullptr;
+            }
+
+            T *item = slots[currentHead];
+            head.store((currentHead + 1) % slots.size(), std::memory_order_release);
+
+            return item;
+        }
+
+        bool empty() const
+        {
+            return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+        }
+
+        /*
+         * RELIABLE ONLY ON THE PRODUCER'S SIDE: IF FALSE, THE NEXT push() WILL SUCCEED (THE CONSUMER CAN ONLY FREE SLOTS)
+         */
+        bool full() const
+        {
+            return (tail.load(std::memory_order_relaxed) + 1) % slots.size() == head.load(std::memory_order_acquire);
+        }
+
+    protected:
+        std::vector<T*> slots;
+        std::atomic<size_t> head {0};
+        std::atomic<size_t> tail {0};
+    };
+
+    // ---
+
+    class Worker : public Proxy
+    {
+    public:
+        static size_t QUEUE_CAPACITY;
+
+        Worker(const std::string &source, const std::string &file = "worker.js");
+        ~Worker();
+
+        /*
+         * STARTS THE THREAD OF THE WORKER: ITS SCRIPT IS EXECUTED, AND THEN MESSAGES ARE PROCESSED UNTIL terminate() IS INVOKED
+         */
+        bool start();
+        void terminate();
+
+        bool isRunning() const
+        {
+            return running;
+        }
+
+        /*
+         * MAIN SIDE: RETURNS FALSE IF THE MESSAGE COULD NOT BE SERIALIZED, OR IF THE QUEUE IS FULL
+         */
+        bool postMessage(HandleValue message, HandleValue transferables = UndefinedHandleValue);
+
+        /*
+         * MAIN SIDE: DELIVERS THE PENDING MESSAGES FROM THE WORKER TO THE onmessage FUNCTION OF THE PEER
+         *
+         * RETURNS THE NUMBER OF DELIVERED MESSAGES
+         */
+        int dispatchMessages();
+
+    protected:
+        std::string source;
+        std::string file;
+
+        std::thread workerThread;
+        std::atomic<bool> running;
+
+        MessageQueue<CloneBuffer> inbox; // MAIN -> WORKER
+        MessageQueue<CloneBuffer> outbox; // WORKER -> MAIN
+
+        std::mutex wakeMutex;
+        std::condition_variable wakeCondition;
+
+        /*
+         * INVOKED ON THE THREAD OF THE WORKER, E.G. FOR CUSTOMIZING THE ENGINE VIA THE LIFE-CYCLE HOOKS OF Manager
+         */
+        virtual std::unique_ptr<Manager> createManager();
+
+        void run();
+        bool post(HandleValue message, HandleValue transferables);
+
+        bool nativePostMessage(const CallArgs &args);
+        bool nativeTerminate(const CallArgs &args);
+
+        static bool enqueue(MessageQueue<CloneBuffer> &queue, HandleValue message, HandleValue transferables);
+        static void deliver(CloneBuffer &message, HandleObject target);
+
+        // ---
+
+        static thread_local Worker *current; // WORKER SIDE
+
+        static bool function_postMessage(JSContext *cx, unsigned argc, Value *vp);
+    };
+}
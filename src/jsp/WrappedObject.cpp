@@ -78,7 +78,7 @@ namespace jsp
     
     void WrappedObject::postBarrier()
     {
-        JSP::addTracerCallback(this, BIND_INSTANCE1(&WrappedObject::trace, this));
+        JSP::addTracedObject(this);
         HeapCellPostBarrier(reinterpret_cast<js::gc::Cell**>(&object));
         
         DUMP_WRAPPED_OBJECT
@@ -87,7 +87,7 @@ namespace jsp
     void WrappedObject::relocate()
     {
         HeapCellRelocate(reinterpret_cast<js::gc::Cell**>(&object));
-        JSP::removeTracerCallback(this);
+        JSP::removeTracedObject(this);
         
         DUMP_WRAPPED_OBJECT
     }
@@ -60,6 +60,7 @@ namespace jsp
         JSObject* unsafeGet() { return object; }
         
     protected:
+        friend class ::JSP;
         friend class Heap<WrappedObject>;
         friend struct js::GCMethods<WrappedObject>;
         
@@ -91,7 +91,7 @@ namespace jsp
     
     void WrappedValue::postBarrier()
     {
-        JSP::addTracerCallback(this, BIND_INSTANCE1(&WrappedValue::trace, this));
+        JSP::addTracedValue(this);
         HeapValuePostBarrier(&value);
         
         DUMP_WRAPPED_VALUE
@@ -99,7 +99,7 @@ namespace jsp
     
     void WrappedValue::relocate()
     {
-        JSP::removeTracerCallback(this);
+        JSP::removeTracedValue(this);
         HeapValueRelocate(&value);
         
         DUMP_WRAPPED_VALUE
@@ -82,6 +82,7 @@ namespace jsp
         Value* unsafeGet() { return &value; }
         
     protected:
+        friend class ::JSP;
         friend class ValueOperations<WrappedValue>;
         friend class MutableValueOperations<WrappedValue>;
         
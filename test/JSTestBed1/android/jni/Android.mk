@@ -33,7 +33,7 @@ LOCAL_CFLAGS += -ffast-math -O3
 
 ###
 
-LOCAL_LDLIBS := -llog -landroid
+LOCAL_LDLIBS := -llog -landroid -lz
 LOCAL_STATIC_LIBRARIES := cinder android_native_app_glue boost_system boost_filesystem boost_thread
 LOCAL_STATIC_LIBRARIES += spidermonkey
 
@@ -13,6 +13,7 @@
 #include "TestingRooting2.h"
 #include "TestingCallbacks.h"
 #include "TestingProxy.h"
+#include "TestingPerformance.h"
 
 #include "jsp/Manager.h"
 
@@ -46,6 +47,7 @@ void Sketch::setup()
         TestingBase::execute<TestingJS>(true);
         TestingBase::execute<TestingCallbacks>(true);
         TestingBase::execute<TestingProxy>(true);
+        TestingBase::execute<TestingPerformance>(false);
         
         manager.shutdown();
     }
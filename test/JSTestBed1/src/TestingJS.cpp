@@ -8,8 +8,15 @@
 
 #include "TestingJS.h"
 
+#include "jsp/Manager.h"
+#include "jsp/Worker.h"
+
 #include "chronotext/Context.h"
 
+#include "cinder/Timer.h"
+
+#include <thread>
+
 using namespace std;
 using namespace ci;
 using namespace chr;
@@ -41,6 +48,8 @@ void TestingJS::performRun(bool force)
     {
         JSP_TEST(force || true, testParsing1)
         JSP_TEST(force || true, testParsing2)
+        JSP_TEST(force || true, testStringConversion1)
+        JSP_TEST(force || true, testStringConversion2)
         JSP_TEST(force || true, testStringify)
         JSP_TEST(force || true, testToSource)
     }
@@ -49,6 +58,14 @@ void TestingJS::performRun(bool force)
     {
         testThreadSafety();
     }
+    
+    if (force || true)
+    {
+        JSP_TEST(force || true, testMultipleEngines)
+        JSP_TEST(force || true, testWorker)
+        JSP_TEST(force || true, testCloneBuffer)
+        JSP_TEST(force || true, testCompressedCloneBuffer)
+    }
 
     if (force || false)
     {
@@ -61,6 +78,14 @@ void TestingJS::performRun(bool force)
         testCustomScriptExecution();
     }
     
+    if (force || true)
+    {
+        JSP_TEST(force || true, testScriptCache)
+        JSP_TEST(force || true, testBytecode)
+        JSP_TEST(force || true, testCompileTask)
+        JSP_TEST(force || true, testScriptLoader)
+    }
+    
     if (force || false)
     {
         testShapes1();
@@ -70,6 +95,12 @@ void TestingJS::performRun(bool force)
         testJSID();
     }
     
+    if (force || true)
+    {
+        JSP_TEST(force || true, testStructReader)
+        JSP_TEST(force || true, testStructMarshalling)
+    }
+    
     if (force || true)
     {
         JSP_TEST(force || true, testGetter1)
@@ -99,6 +130,7 @@ void TestingJS::performRun(bool force)
     if (force || true)
     {
         JSP_TEST(force || true, testGetProperty1)
+        JSP_TEST(force || true, testPropertyKeys)
         JSP_TEST(force || true, testGetElement1)
         
         JSP_TEST(force || true, testGetProperties1)
@@ -122,6 +154,7 @@ void TestingJS::performRun(bool force)
     if (force || true)
     {
         JSP_TEST(force || true, testArrayElementCount)
+        JSP_TEST(force || true, testTypedArrays)
     }
 }
 
@@ -171,10 +204,90 @@ void TestingJS::testArrayElementCount()
     }
     
     JSP_CHECK(elementCount == 3);
+    JSP_CHECK(getElementCount(array) == 3);
+    
+    /*
+     * USER-DEFINED ITERATION MUST BE HONORED (I.E. NO "DENSE-ARRAY" SHORTCUT)
+     */
+    RootedObject custom(cx, evaluateObject("var custom = [1, 2, 3]; custom['@@iterator'] = function() { var i = 0; return {next: function() { return (i < 2) ? {value: i++, done: false} : {value: undefined, done: true}; }}; }; custom"));
+    JSP_CHECK(getElementCount(custom) == 2, "ONLY 2 ELEMENTS ARE ITERATED");
+}
+
+/*
+ * DEMONSTRATED:
+ *
+ * - HOW TO TRANSFER std::vector<T> TO AND FROM JS TYPED-ARRAYS (ONE memcpy)
+ * - HOW TO WRAP AN "EXTERNAL" BUFFER WITHOUT COPYING
+ */
+void TestingJS::testTypedArrays()
+{
+    vector<float> floats {1.5f, -2.25f, 3.0f};
+    RootedObject array1(cx, newTypedArray(floats));
+    
+    set(globalHandle(), "typedArray1", array1);
+    JSP_CHECK(evaluateBoolean("return (typedArray1 instanceof Float32Array) && (typedArray1.length == 3) && (typedArray1[1] == -2.25)"));
+    
+    vector<float> floatsBack;
+    JSP_CHECK(getTypedArrayElements(array1, floatsBack) && (floatsBack == floats));
+    
+    vector<int32_t> wrongType;
+    JSP_CHECK(!getTypedArrayElements(array1, wrongType), "NOT AN Int32Array");
+    
+    // ---
+    
+    uint32_t *buffer = allocateTypedArrayBuffer<uint32_t>(4);
+    
+    for (auto i = 0; i < 4; i++)
+    {
+        buffer[i] = 0xFFFFFFFF - i;
+    }
+    
+    RootedObject array2(cx, newTypedArray(buffer, 4));
+    set(globalHandle(), "typedArray2", array2);
+    
+    JSP_CHECK(evaluateBoolean("return (typedArray2 instanceof Uint32Array) && (typedArray2[3] == 4294967292)"));
+    
+    executeScript("typedArray2[0] = 33");
+    
+    uint32_t length;
+    uint32_t *data = getTypedArrayData<uint32_t>(array2, &length);
+    JSP_CHECK((length == 4) && (data == buffer) && (data[0] == 33), "NO COPY TOOK PLACE");
+    
+    deleteProperty(globalHandle(), "typedArray1");
+    deleteProperty(globalHandle(), "typedArray2");
 }
 
 #pragma mark ---------------------------------------- GETTING / SETTING PROPERTIES AND ELEMENTS ----------------------------------------
 
+/*
+ * PROPERTY-NAMES RESOLVED ONCE, AS JSID (SEE PropertyKey.h)
+ */
+void TestingJS::testPropertyKeys()
+{
+    static thread_local const PropertyKey KEY_X("x");
+    static thread_local const PropertyKey KEY_NAME("שם");
+    static thread_local const PropertyKey KEY_INDEX("0");
+    
+    RootedObject object(cx, newPlainObject());
+    
+    JSP_CHECK(set(object, KEY_X, 33.5f));
+    JSP_CHECK(define(object, KEY_NAME, "אריאל", JSPROP_READONLY));
+    JSP_CHECK(set(object, KEY_INDEX, true));
+    
+    forceGC(); // THE UNDERLYING ATOMS ARE NOT PINNED: THEY MUST SURVIVE VIA TRACING
+    
+    JSP_CHECK(get<FLOAT32>(object, KEY_X) == 33.5f);
+    JSP_CHECK(get<FLOAT32>(object, "x") == 33.5f, "SAME PROPERTY, VIA const char*");
+    JSP_CHECK(get<STRING>(object, KEY_NAME) == "אריאל");
+    JSP_CHECK(get<BOOLEAN>(object, 0) == true, "INDEX-LIKE KEY");
+    
+    JSP_CHECK(hasOwnProperty(object, KEY_X));
+    JSP_CHECK(deleteProperty(object, KEY_X));
+    JSP_CHECK(!hasProperty(object, KEY_X));
+    
+    JSP_CHECK(get<INT32>(object, JSP_PROPERTY_KEY("missing"), -1) == -1);
+}
+
 /*
  * TESTING THE BEHAVIOR OF JS_GetProperty FOR NON-DEFINED PROPERTIES:
  *
@@ -1198,6 +1311,148 @@ void TestingJS::testShapes2()
     LOGI << "-----" << endl;
 }
 
+/*
+ * READING OBJECTS SHARING THE SAME SHAPE (SEE StructReader.h)
+ */
+void TestingJS::testStructReader()
+{
+    /*
+     * FLOAT32: CONVERTED ONLY FROM NON-INTEGRAL NUMBERS (SEE JSP::convertMaybe)
+     */
+    struct Entity
+    {
+        float x = 0;
+        float y = 0;
+        std::string name;
+        bool visible = false;
+    };
+    
+    StructReader<Entity> reader;
+    reader.bind("x", &Entity::x).bind("y", &Entity::y).bind("name", &Entity::name).bind("visible", &Entity::visible);
+    
+    executeScript("function createEntity(i) { return {x: i + 0.25, y: i + 0.75, name: 'entity' + i, visible: (i % 2) == 0}; }");
+    
+    Entity entity;
+    
+    for (int i = 0; i < 10; i++)
+    {
+        RootedValue arg(cx, Int32Value(i));
+        RootedObject object(cx, call(globalHandle(), "createEntity", HandleValueArray(arg)).toObjectOrNull());
+        
+        JSP_CHECK(reader.read(object, entity));
+        JSP_CHECK((entity.x == i + 0.25f) && (entity.y == i + 0.75f) && (entity.name == "entity" + to_string(i)) && (entity.visible == ((i % 2) == 0)));
+    }
+    
+#if defined(JSP_USE_PRIVATE_APIS)
+    JSP_CHECK((reader.getMissCount() == 1) && (reader.getHitCount() == 9), "SAME SHAPE");
+#endif
+    
+    // ---
+    
+    reader.resetCounters();
+    
+    RootedObject reordered(cx, evaluateObject("({name: 'reordered', visible: true, y: 2.5, x: 1.5})"));
+    JSP_CHECK(reader.read(reordered, entity));
+    JSP_CHECK((entity.x == 1.5f) && (entity.y == 2.5f) && (entity.name == "reordered"));
+    
+    RootedObject withGetter(cx, evaluateObject("({x: 3.5, y: 4.5, get name() { return 'getter'; }, visible: false})"));
+    JSP_CHECK(reader.read(withGetter, entity));
+    JSP_CHECK(reader.read(withGetter, entity));
+    JSP_CHECK((entity.x == 3.5f) && (entity.name == "getter"));
+    
+    RootedObject inherited(cx, evaluateObject("Object.create({name: 'inherited'}, {x: {value: 5.5, enumerable: true}})"));
+    JSP_CHECK(!reader.read(inherited, entity), "y AND visible ARE UNDEFINED");
+    JSP_CHECK((entity.x == 5.5f) && (entity.name == "inherited"));
+    
+    JSP_CHECK(!reader.read(NullPtr(), entity), "NULL OBJECT");
+    
+    JSP_CHECK(reader.getHitCount() == 0, "DIFFERENT SHAPE, GETTER OR INHERITED PROPERTY: ALWAYS MISSING");
+    
+    // ---
+    
+#if defined(JSP_USE_PRIVATE_APIS)
+    RootedObject object(cx, evaluateObject("({x: 6.5, y: 7.5, name: 'cached', visible: true})"));
+    
+    reader.resetCounters();
+    reader.read(object, entity);
+    reader.read(object, entity);
+    JSP_CHECK(reader.getHitCount() == 1);
+    
+    forceGC();
+    
+    reader.read(object, entity);
+    JSP_CHECK(reader.getMissCount() == 2, "CACHED SHAPE FORGOTTEN UPON GC");
+    JSP_CHECK(entity.name == "cached");
+#endif
+    
+    deleteProperty(globalHandle(), "createEntity");
+}
+
+/*
+ * FIELDS DECLARED ONCE, AT COMPILE-TIME (SEE Struct.h)
+ */
+
+struct Sprite
+{
+    double x = 0;
+    double y = 0;
+    int32_t frame = 0;
+    uint32_t color = 0;
+    bool visible = false;
+    std::string name;
+};
+
+JSP_STRUCT(Sprite,
+    JSP_STRUCT_FIELD(Sprite, x),
+    JSP_STRUCT_FIELD(Sprite, y),
+    JSP_STRUCT_FIELD(Sprite, frame),
+    JSP_STRUCT_FIELD(Sprite, color),
+    JSP_STRUCT_FIELD(Sprite, visible),
+    JSP_STRUCT_FIELD(Sprite, name))
+
+void TestingJS::testStructMarshalling()
+{
+    Sprite sprite1;
+    sprite1.x = 1.5;
+    sprite1.y = -2.25;
+    sprite1.frame = 7;
+    sprite1.color = 0xff8000ff;
+    sprite1.visible = true;
+    sprite1.name = "אריאל";
+    
+    Struct<Sprite>::resetCounters();
+    
+    RootedObject object1(cx, Struct<Sprite>::toJS(sprite1));
+    JSP_CHECK(object1);
+    
+    forceGC(); // THE TEMPLATE OBJECT MUST SURVIVE VIA TRACING
+    
+    RootedObject object2(cx, Struct<Sprite>::toJS(sprite1));
+    set(globalHandle(), "sprite", object2);
+    
+    JSP_CHECK(evaluateString("JSON.stringify(sprite)") == "{\"x\":1.5,\"y\":-2.25,\"frame\":7,\"color\":4286578943,\"visible\":true,\"name\":\"אריאל\"}", "SAME ORDER AND ENUMERABILITY AS AN OBJECT-LITERAL");
+    JSP_CHECK(evaluateBoolean("sprite.x += 1; sprite.name += '!'; return sprite.x == 2.5"), "REGULAR, WRITABLE PROPERTIES");
+    
+    Sprite sprite2;
+    JSP_CHECK(Struct<Sprite>::fromJS(object2, sprite2));
+    JSP_CHECK((sprite2.x == 2.5) && (sprite2.y == -2.25) && (sprite2.frame == 7) && (sprite2.color == 0xff8000ff) && sprite2.visible && (sprite2.name == "אריאל!"));
+    
+    JSP_CHECK(Struct<Sprite>::fromJS(object1, sprite2));
+    JSP_CHECK((sprite2.x == 1.5) && (sprite2.name == "אריאל"));
+    
+#if defined(JSP_USE_PRIVATE_APIS)
+    JSP_CHECK((Struct<Sprite>::getMissCount() == 1) && (Struct<Sprite>::getHitCount() == 1), "OBJECTS CREATED VIA toJS() ARE SHARING THE SAME SHAPE");
+#endif
+    
+    // ---
+    
+    RootedObject partial(cx, evaluateObject("({x: 3.5, name: 'partial'})"));
+    JSP_CHECK(!Struct<Sprite>::fromJS(partial, sprite2), "MISSING FIELDS");
+    JSP_CHECK((sprite2.x == 3.5) && (sprite2.y == -2.25) && (sprite2.name == "partial"), "MISSING FIELDS ARE LEFT UNTOUCHED");
+    
+    deleteProperty(globalHandle(), "sprite");
+}
+
 #pragma mark ---------------------------------------- ATOMS ----------------------------------------
 
 /*
@@ -1348,6 +1603,108 @@ void TestingJS::testJSID()
     LOGI << JSP::write(id2) << endl; // PRINTS: jsid 0x5 = 2
 }
 
+void TestingJS::testCloneBuffer()
+{
+    auto snapshotPath = getPublicDirectory() / "snapshot.jsclone";
+    
+    RootedObject object(cx, evaluateObject("({name: 'SNAPSHOT', values: [1, 2, 3], nested: {flag: true}})"));
+    string expected = stringify(object);
+    
+    CloneBuffer serialized(object);
+    JSP_CHECK(serialized.write(writeFile(snapshotPath)) == serialized.getDataSize());
+    
+    auto liveBytes = CloneBuffer::getLiveBytes();
+    CloneBuffer mapped(loadFile(snapshotPath));
+    
+    JSP_CHECK(CloneBuffer::getLiveBytes() == liveBytes, "MEMORY-MAPPED, I.E. NOT COPIED");
+    JSP_CHECK(mapped.getDataSize() == serialized.getDataSize());
+    
+    RootedObject restored(cx, mapped.read());
+    JSP_CHECK(stringify(restored) == expected);
+    
+    // ---
+    
+    RootedObject transfer(cx, evaluateObject("var transferred = new ArrayBuffer(16); ({buffer: transferred, list: [transferred]})"));
+    RootedValue message(cx, ObjectOrNullValue(get<OBJECT>(transfer, "buffer")));
+    RootedValue transferables(cx, ObjectOrNullValue(get<OBJECT>(transfer, "list")));
+    
+    CloneBuffer transferring(message, transferables);
+    
+    try
+    {
+        transferring.write(writeFile(getPublicDirectory() / "transferring.jsclone"));
+        JSP_CHECK(false); // UNREACHABLE: TRANSFERABLES CAN'T BE WRITTEN
+    }
+    catch (exception &e)
+    {}
+}
+
+void TestingJS::testCompressedCloneBuffer()
+{
+    auto snapshotPath = getPublicDirectory() / "snapshot.jspc";
+    
+    RootedObject object(cx, evaluateObject("var items = []; for (var i = 0; i < 1000; i++) { items.push({name: 'item', index: i, tags: ['alpha', 'beta']}); } ({items: items})"));
+    string expected = stringify(object);
+    
+    CloneBuffer serialized(object);
+    size_t compressedSize = serialized.write(writeFile(snapshotPath), CloneBuffer::COMPRESSION_ZLIB, 4096); // I.E. MORE THAN ONE BLOCK
+    
+    JSP_CHECK(compressedSize < serialized.getDataSize() / 3, "REPEATED KEYS AND STRINGS");
+    
+    CloneBuffer decompressed(loadFile(snapshotPath));
+    JSP_CHECK(decompressed.getDataSize() == serialized.getDataSize());
+    
+    RootedObject restored(cx, decompressed.read());
+    JSP_CHECK(stringify(restored) == expected);
+    
+    // ---
+    
+    auto corrupted = loadFile(snapshotPath)->getBuffer();
+    static_cast<uint8_t*>(corrupted.getData())[corrupted.getDataSize() / 2] ^= 0xff;
+    
+    auto corruptedPath = getPublicDirectory() / "corrupted.jspc";
+    writeFile(corruptedPath)->getStream()->writeData(corrupted.getData(), corrupted.getDataSize());
+    
+    try
+    {
+        CloneBuffer rejected(loadFile(corruptedPath));
+        JSP_CHECK(false); // UNREACHABLE: CORRUPTED SNAPSHOT
+    }
+    catch (exception &e)
+    {}
+    
+    // ---
+    
+    auto rejects = [&](const Buffer &buffer)
+    {
+        writeFile(corruptedPath)->getStream()->writeData(buffer.getData(), buffer.getDataSize());
+        
+        try
+        {
+            CloneBuffer rejected(loadFile(corruptedPath));
+            return false;
+        }
+        catch (exception &e)
+        {
+            return true;
+        }
+    };
+    
+    auto original = loadFile(snapshotPath)->getBuffer();
+    
+    Buffer trailing(original.getDataSize() + 8);
+    memcpy(trailing.getData(), original.getData(), original.getDataSize());
+    memset(static_cast<uint8_t*>(trailing.getData()) + original.getDataSize(), 0, 8);
+    JSP_CHECK(rejects(trailing), "TRAILING BYTES");
+    
+    Buffer oversized(original.getDataSize());
+    memcpy(oversized.getData(), original.getData(), original.getDataSize());
+    
+    uint64_t rawSize = uint64_t(1) << 40; // AT OFFSET 16 (SEE CloneBuffer::ArchiveHeader)
+    memcpy(static_cast<uint8_t*>(oversized.getData()) + 16, &rawSize, sizeof(rawSize));
+    JSP_CHECK(rejects(oversized), "RAW-SIZE OUT OF BOUNDS");
+}
+
 #pragma mark ---------------------------------------- MISC ----------------------------------------
 
 void TestingJS::dumpIds(JSObject *object)
@@ -1417,6 +1774,94 @@ void TestingJS::testThreadSafety()
     taskManager().addTask(make_shared<TestTask>(this));
 }
 
+/*
+ * N INDEPENDENT ENGINES ON N THREADS (EACH ONE WITH ITS OWN Manager), WHILE THE ENGINE OF THE MAIN THREAD IS RUNNING
+ */
+void TestingJS::testMultipleEngines()
+{
+    const int engineCount = 4;
+    
+    vector<int32_t> results(engineCount, 0);
+    vector<thread> threads;
+    
+    for (int i = 0; i < engineCount; i++)
+    {
+        threads.emplace_back([i, &results]
+        {
+            Manager manager;
+            
+            if (manager.init())
+            {
+                Proto::executeScript("var engineTotal = " + ci::toString(i) + "; for (var j = 1; j <= 1000; j++) { engineTotal += j; }");
+                results[i] = Proto::get<INT32>(globalHandle(), JSP_PROPERTY_KEY("engineTotal")); // ONE KEY PER THREAD
+                
+                manager.shutdown();
+            }
+        });
+    }
+    
+    for (auto &worker : threads)
+    {
+        worker.join();
+    }
+    
+    for (int i = 0; i < engineCount; i++)
+    {
+        JSP_CHECK(results[i] == 500500 + i);
+    }
+    
+    JSP_CHECK(evaluateBoolean("return typeof engineTotal === 'undefined'"), "ENGINES ARE ISOLATED");
+    JSP_CHECK(Manager::getCurrent() && (Manager::getEngineCount() == 1));
+}
+
+/*
+ * THE ARRAY-BUFFER IS TRANSFERRED BACK AND FORTH: THE SENDER IS LEFT WITH A NEUTERED (I.E. EMPTY) ARRAY-BUFFER
+ */
+void TestingJS::testWorker()
+{
+    Worker worker("onmessage = function(event) { var bytes = new Uint8Array(event.data); bytes[0] *= 2; postMessage(event.data, [event.data]); }");
+    JSP_CHECK(worker.start());
+    
+    executeScript("var workerBuffer = new ArrayBuffer(1024); new Uint8Array(workerBuffer)[0] = 21; var workerResult = 0;");
+    executeScript(worker.getPeerAccessor() + ".onmessage = function(event) { workerResult = new Uint8Array(event.data)[0]; }");
+    executeScript(worker.getPeerAccessor() + ".postMessage(workerBuffer, [workerBuffer])");
+    
+    JSP_CHECK(evaluateBoolean("return workerBuffer.byteLength === 0"), "TRANSFERRED");
+    
+    ci::Timer timer(true);
+    
+    while ((worker.dispatchMessages() == 0) && (timer.getSeconds() < 1))
+    {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    
+    JSP_CHECK(evaluateBoolean("return workerResult === 42"), "ROUND-TRIP");
+    
+    worker.terminate();
+    JSP_CHECK(!worker.isRunning());
+    
+    // ---
+    
+    /*
+     * A MESSAGE WHICH CAN'T BE QUEUED IS NOT SERIALIZED: ITS TRANSFERABLES ARE LEFT INTACT
+     */
+    auto queueCapacity = Worker::QUEUE_CAPACITY;
+    Worker::QUEUE_CAPACITY = 1;
+    
+    Worker busyWorker("onmessage = function(event) { var start = Date.now(); while (Date.now() - start < 200) {} }");
+    Worker::QUEUE_CAPACITY = queueCapacity;
+    
+    JSP_CHECK(busyWorker.start());
+    executeScript("var busyWorker = " + busyWorker.getPeerAccessor() + ", rejectedBuffer = null, rejectedError = null;");
+    
+    executeScript("for (var i = 0; i < 4; i++) { var buffer = new ArrayBuffer(16); try { busyWorker.postMessage(buffer, [buffer]); } catch (e) { rejectedBuffer = buffer; rejectedError = e; break; } }");
+    JSP_CHECK(evaluateBoolean("return (rejectedBuffer !== null) && (rejectedBuffer.byteLength === 16)"), "NOT NEUTERED");
+    JSP_CHECK(evaluateBoolean("return /FULL/.test(String(rejectedError))"), "ERROR REPORTED");
+    
+    executeScript("busyWorker = rejectedBuffer = rejectedError = null");
+    busyWorker.terminate();
+}
+
 #pragma mark ---------------------------------------- MISC ----------------------------------------
 
 /*
@@ -1511,6 +1956,137 @@ void TestingJS::testCustomScriptExecution()
     exec(source, options);
 }
 
+void TestingJS::testScriptCache()
+{
+    string source = "var scriptCacheCounter = (typeof scriptCacheCounter == 'undefined') ? 1 : scriptCacheCounter + 1;";
+    
+    ScriptCache::invalidate("scriptCache.js");
+    ScriptCache::resetCounters();
+    
+    executeScript(source, "scriptCache.js");
+    JSP_CHECK(ScriptCache::getMissCount() == 1);
+    
+    executeScript(source, "scriptCache.js");
+    JSP_CHECK(ScriptCache::getHitCount() == 1, "FRONT-END SKIPPED");
+    JSP_CHECK(get<INT32>(globalHandle(), "scriptCacheCounter") == 2, "CACHED SCRIPT EXECUTED");
+    
+    /*
+     * SAME SOURCE, WITH AND WITHOUT RETURN-VALUE: TWO DIFFERENT SCRIPTS ARE NECESSARY
+     */
+    string objectSource = "({counter: scriptCacheCounter})";
+    
+    executeScript(objectSource, "scriptCache.js");
+    JSP_CHECK(evaluateObject(objectSource, "scriptCache.js") != nullptr);
+    JSP_CHECK(ScriptCache::getMissCount() == 3);
+    
+    // ---
+    
+    ScriptCache::invalidate("scriptCache.js");
+    
+    executeScript(source, "scriptCache.js");
+    JSP_CHECK(ScriptCache::getMissCount() == 4, "EXPLICIT INVALIDATION");
+    JSP_CHECK(get<INT32>(globalHandle(), "scriptCacheCounter") == 4);
+    
+    // ---
+    
+    forceGC();
+    
+    executeScript(source, "scriptCache.js");
+    JSP_CHECK(ScriptCache::getHitCount() == 2, "CACHED SCRIPT SURVIVING GC");
+    JSP_CHECK(get<INT32>(globalHandle(), "scriptCacheCounter") == 5);
+    
+    // ---
+    
+    auto entryCount = ScriptCache::getEntryCount();
+    
+    executeScript(source);
+    executeScript(source);
+    
+    JSP_CHECK(ScriptCache::getEntryCount() == entryCount, "ANONYMOUS SOURCES ARE NOT CACHED");
+    JSP_CHECK(ScriptCache::getHitCount() == 2);
+    JSP_CHECK(get<INT32>(globalHandle(), "scriptCacheCounter") == 7);
+}
+
+void TestingJS::testBytecode()
+{
+    auto inputSource = InputSource::getAsset("handlebars.js");
+    auto bytecodePath = getPublicDirectory() / "handlebars.jsbc";
+    
+    JSP_CHECK(precompileScript(inputSource, bytecodePath) > 0);
+    
+    string source = utils::readText<string>(inputSource);
+    
+    JSP_CHECK(Bytecode::read(bytecodePath, source) != nullptr, "MATCHING SOURCE");
+    JSP_CHECK(Bytecode::read(bytecodePath, source + ";") == nullptr, "MODIFIED SOURCE");
+    JSP_CHECK(Bytecode::read(bytecodePath.string() + ".missing", source) == nullptr, "MISSING FILE");
+    
+    // ---
+    
+    executeScript(inputSource, bytecodePath);
+    
+    RootedObject handlebars(cx, get<OBJECT>(globalHandle(), "Handlebars"));
+    JSP_CHECK(isFunction(get<OBJECT>(handlebars, "compile")), "DECODED SCRIPT EXECUTED");
+}
+
+/*
+ * handlebars.js IS LARGE ENOUGH FOR BEING COMPILED OFF THE MAIN THREAD, UNLIKE THE "TINY" SCRIPTS
+ */
+void TestingJS::testCompileTask()
+{
+    executeScript("Handlebars = undefined");
+    
+    auto task = compileScriptAsync(InputSource::getAsset("handlebars.js"));
+    JSP_CHECK(task->isOffThread() == (Manager::USE_HELPER_THREADS == JS_USE_HELPER_THREADS));
+    
+    forceGC(); // I.E. WHILE COMPILING
+    
+    ci::Timer timer(true);
+    
+    while ((CompileTask::dispatch() == 0) && (timer.getSeconds() < 5))
+    {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    
+    JSP_CHECK(CompileTask::getPendingCount() == 0);
+    
+    RootedObject handlebars(cx, get<OBJECT>(globalHandle(), "Handlebars"));
+    JSP_CHECK(isFunction(get<OBJECT>(handlebars, "compile")), "EXECUTED UPON DISPATCH");
+    
+    // ---
+    
+    bool delivered = false;
+    auto tiny = compileScriptAsync("var compileTaskResult = 255", "tiny.js", 1, [&](CompileTask&) { delivered = true; });
+    
+    JSP_CHECK(!tiny->isOffThread() && tiny->isCompiled(), "COMPILED ON THE MAIN THREAD");
+    JSP_CHECK((CompileTask::dispatch() == 1) && delivered, "DELIVERED TO THE CALLBACK");
+    
+    tiny->execute();
+    JSP_CHECK(get<INT32>(globalHandle(), "compileTaskResult") == 255);
+    
+    // ---
+    
+    auto broken = compileScriptAsync("var compileTaskResult = (", "broken.js");
+    JSP_CHECK(broken->finish() == nullptr, "COMPILATION-ERROR");
+}
+
+void TestingJS::testScriptLoader()
+{
+    executeScript("Handlebars = undefined; getErrorReport = undefined");
+    
+    ScriptLoader loader({InputSource::getAsset("handlebars.js"), InputSource::getAsset("helpers.js")});
+    JSP_CHECK(loader.run());
+    JSP_CHECK(loader.getTimings().size() == 2);
+    
+    RootedObject handlebars(cx, get<OBJECT>(globalHandle(), "Handlebars"));
+    JSP_CHECK(isFunction(get<OBJECT>(handlebars, "compile")));
+    JSP_CHECK(isFunction(get<OBJECT>(globalHandle(), "getErrorReport")));
+    
+    // ---
+    
+    ScriptLoader broken({InputSource::getAsset("helpers.js"), InputSource::getAsset("missing.js"), InputSource::getAsset("test.js")});
+    JSP_CHECK(!broken.run() && (broken.getTimings().size() == 1), "STOPPED UPON INPUT-SOURCE ERROR");
+}
+
 // ---
 
 void TestingJS::testParsing1()
@@ -1555,6 +2131,66 @@ void TestingJS::initComplexJSON(const string &source)
 
 //
 
+/*
+ * UTF-16 TO UTF-8 CONVERSION, AS PERFORMED BY JSP::toString, JSP::assignString AND JSP::appendString
+ *
+ * INVALID SURROGATES ARE ENCODED AS U+FFFD (SAME POLICY AS TwoByteCharsToNewUTF8CharsZ)
+ */
+void TestingJS::testStringConversion1()
+{
+    JSP_CHECK(evaluateString("'foo bar'") == "foo bar");
+    JSP_CHECK(evaluateString("'אריאל מלכא'") == "אריאל מלכא");
+    JSP_CHECK(evaluateString("'0123456789 אריאל מלכא 0123456789'") == "0123456789 אריאל מלכא 0123456789");
+    JSP_CHECK(evaluateString("'\\u6F22\\u5B57'") == "\xE6\xBC\xA2\xE5\xAD\x97");
+    JSP_CHECK(evaluateString("'\\uD83D\\uDE00'") == "\xF0\x9F\x98\x80");
+    JSP_CHECK(evaluateString("'\\uD83D!'") == "\xEF\xBF\xBD!");
+    JSP_CHECK(evaluateString("''").empty());
+    
+    // ---
+    
+    RootedValue value(cx, toValue("ב"));
+    
+    string buffer = "א";
+    appendString(buffer, value);
+    JSP_CHECK(buffer == "אב");
+    
+    assignString(buffer, value);
+    JSP_CHECK(buffer == "ב");
+}
+
+/*
+ * JSP::toJSString AND JSP::toAtom
+ */
+void TestingJS::testStringConversion2()
+{
+    JSP_CHECK(toJSString("foo") == toJSString(string("foo")), "SMALL-STRING CACHE");
+    JSP_CHECK(stringEquals(toJSString("foo"), "foo"));
+    
+    string ascii(100, 'x');
+    JSP_CHECK(toJSString(ascii)->length() == 100);
+    JSP_CHECK(stringEquals(toJSString(ascii), ascii));
+    
+    JSP_CHECK(toJSString("אריאל")->length() == 5);
+    JSP_CHECK(stringEquals(toJSString("אריאל"), "אריאל"));
+    
+    string withNull("a\0b", 3);
+    JSP_CHECK(toJSString(withNull)->length() == 3, "std::string SIZE IS HONORED");
+    
+    JSP_CHECK(toJSString("")->empty());
+    JSP_CHECK(toJSString(nullptr)->empty());
+    
+    // ---
+    
+    JSAtom *atom = toAtom("someProperty");
+    JSP_CHECK(atom && (atom == toAtom(string("someProperty"))));
+    JSP_CHECK(stringEquals(atom, "someProperty"));
+    
+    JSAtom *atomUTF8 = toAtom("מאפיין");
+    JSP_CHECK(atomUTF8 && stringEquals(atomUTF8, "מאפיין"));
+}
+
+//
+
 /*
  * WORKS BECAUSE THERE ARE NO "CYCLIC VALUES" IN OBJECT
  * OTHERWISE: RETURNS EMPTY-STRING AND REPORTS JS-EXCEPTION ("TypeError: cyclic object value")
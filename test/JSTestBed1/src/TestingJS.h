@@ -19,6 +19,8 @@ public:
 
     void testShapes1();
     void testShapes2();
+    void testStructReader();
+    void testStructMarshalling();
     void testAtoms();
     void testReservedSlots();
     void testJSID();
@@ -32,10 +34,18 @@ public:
     // ---
     
     void testThreadSafety();
+    void testMultipleEngines();
+    void testWorker();
+    void testCloneBuffer();
+    void testCompressedCloneBuffer();
     
     void testEvaluationScope();
     void testFunctionScope();
     void testCustomScriptExecution();
+    void testScriptCache();
+    void testBytecode();
+    void testCompileTask();
+    void testScriptLoader();
     
     // ---
     
@@ -43,6 +53,9 @@ public:
     void testParsing2();
     void initComplexJSON(const std::string &source);
 
+    void testStringConversion1();
+    void testStringConversion2();
+
     void testStringify();
     void testToSource();
     void initComplexJSObject();
@@ -77,6 +90,7 @@ public:
     // ---
     
     void testGetProperty1();
+    void testPropertyKeys();
     void testGetElement1();
 
     void testGetProperties1();
@@ -106,4 +120,5 @@ public:
     // ---
     
     void testArrayElementCount();
+    void testTypedArrays();
 };
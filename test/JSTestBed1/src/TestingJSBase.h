@@ -15,6 +15,11 @@
 #include "jsp/CloneBuffer.h"
 #include "jsp/Barker.h"
 #include "jsp/Proto.h"
+#include "jsp/Bytecode.h"
+#include "jsp/ScriptCache.h"
+#include "jsp/ScriptLoader.h"
+#include "jsp/StructReader.h"
+#include "jsp/Struct.h"
 
 class TestingJSBase : public TestingBase, public jsp::Proto
 {
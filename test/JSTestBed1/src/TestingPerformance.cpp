@@ -0,0 +1,1091 @@
+/*
+ * JSP: https://github.com/arielm/jsp
+ * COPYRIGHT (C) 2014-2015, ARIEL MALKA ALL RIGHTS RESERVED.
+ *
+ * THE FOLLOWING SOURCE-CODE IS DISTRIBUTED UNDER THE SIMPLIFIED BSD LICENSE:
+ * https://github.com/arielm/jsp/blob/master/LICENSE
+ */
+
+#include "TestingPerformance.h"
+
+#include "jsp/CloneBuffer.h"
+#include "jsp/Proxy.h"
+#include "jsp/Worker.h"
+#include "jsp/Manager.h"
+
+#include "chronotext/Context.h"
+
+#include "cinder/Timer.h"
+#include "cinder/Utilities.h"
+
+using namespace std;
+using namespace ci;
+using namespace chr;
+
+using namespace jsp;
+
+void TestingPerformance::performSetup()
+{
+    WrappedValue::LOG_VERBOSE = false;
+    WrappedObject::LOG_VERBOSE = false;
+}
+
+void TestingPerformance::performShutdown()
+{
+    WrappedValue::LOG_VERBOSE = false;
+    WrappedObject::LOG_VERBOSE = false;
+}
+
+void TestingPerformance::performRun(bool force)
+{
+    if (force || true)
+    {
+        JSP_TEST(force || true, benchmarkTracerRegistry)
+        JSP_TEST(force || true, benchmarkUTF8Encoding)
+        JSP_TEST(force || true, benchmarkStringCreation)
+        JSP_TEST(force || true, benchmarkScriptCache)
+        JSP_TEST(force || true, benchmarkBytecode)
+        JSP_TEST(force || true, benchmarkTypedArrays)
+        JSP_TEST(force || true, benchmarkDenseArrays)
+        JSP_TEST(force || true, benchmarkPropertyKeys)
+        JSP_TEST(force || true, benchmarkStructReader)
+        JSP_TEST(force || true, benchmarkStructMarshalling)
+        JSP_TEST(force || true, benchmarkProxyDispatch)
+        JSP_TEST(force || true, benchmarkPeerClass)
+        JSP_TEST(force || true, benchmarkWorkerMessaging)
+        JSP_TEST(force || true, benchmarkScriptLoader)
+        JSP_TEST(force || true, benchmarkGCScheduler)
+        JSP_TEST(force || true, benchmarkCloneBufferCompression)
+    }
+}
+
+#pragma mark ---------------------------------------- TRACER REGISTRY ----------------------------------------
+
+/*
+ * MEASURING:
+ *
+ * - THE COST OF A Heap<WrappedObject> POST-BARRIER (I.E. JSP::addTracedObject)
+ * - THE COST OF A Heap<WrappedObject> RELOCATION (I.E. JSP::removeTracedObject)
+ * - THE EXTRA TIME SPENT BY A FULL GC FOR TRACING THE ROOTS
+ *
+ * ALL THE ROOTS ARE POINTING TO THE SAME OBJECT, IN ORDER TO MEASURE THE REGISTRY ITSELF (AND NOT THE MARKING OF N OBJECTS)
+ */
+void TestingPerformance::benchmarkTracerRegistry()
+{
+    Timer timer(true);
+    forceGC();
+    double baseline = timer.getSeconds();
+    
+    LOGI << "GC WITHOUT EXTRA-ROOTS: " << baseline * 1000 << " ms" << endl;
+    
+    for (auto rootCount : {10000, 100000, 1000000})
+    {
+        measureTracerRegistry(rootCount);
+    }
+}
+
+void TestingPerformance::measureTracerRegistry(size_t rootCount)
+{
+    RootedObject object(cx, newPlainObject());
+    unique_ptr<Heap<WrappedObject>[]> roots(new Heap<WrappedObject>[rootCount]);
+    
+    Timer timer(true);
+    
+    for (size_t i = 0; i < rootCount; i++)
+    {
+        roots[i] = object.get();
+    }
+    
+    double barrierDuration = timer.getSeconds();
+    JSP_CHECK(getTracedCount() >= rootCount);
+    
+    timer.start();
+    forceGC();
+    double gcDuration = timer.getSeconds();
+    
+    timer.start();
+    roots.reset();
+    double relocateDuration = timer.getSeconds();
+    
+    LOGI << rootCount << " ROOTS | POST-BARRIER: " << barrierDuration * 1e9 / rootCount << " ns | RELOCATION: " << relocateDuration * 1e9 / rootCount << " ns | GC: " << gcDuration * 1000 << " ms" << endl;
+}
+
+#pragma mark ---------------------------------------- UTF-8 ENCODING ----------------------------------------
+
+/*
+ * COMPARING JSP::toString (ENCODING "IN PLACE") WITH THE TwoByteCharsToNewUTF8CharsZ BASED APPROACH
+ *
+ * - ASCII-HEAVY: MOSTLY LATIN CHARACTERS, WITH AN OCCASIONAL HEBREW LETTER
+ * - BMP-HEAVY: MOSTLY HEBREW AND CJK CHARACTERS
+ */
+void TestingPerformance::benchmarkUTF8Encoding()
+{
+    vector<jschar> asciiHeavy;
+    
+    for (auto c : string("The quick brown fox jumps over the lazy dog. "))
+    {
+        asciiHeavy.push_back(c);
+    }
+    
+    asciiHeavy.push_back(0x05D0);
+    
+    vector<jschar> bmpHeavy {0x05D0, 0x05E8, 0x05D9, 0x05D0, 0x05DC, 0x0020, 0x6F22, 0x5B57, 0x0041, 0x05DE, 0x05DC, 0x05DB, 0x05D0, 0x3042, 0x002E, 0x0020};
+    
+    for (size_t byteSize = 16; byteSize <= 16 * 1024 * 1024; byteSize *= 16)
+    {
+        LOGI << "ASCII-HEAVY | ";
+        measureUTF8Encoding(asciiHeavy, byteSize);
+        
+        LOGI << "BMP-HEAVY   | ";
+        measureUTF8Encoding(bmpHeavy, byteSize);
+    }
+}
+
+void TestingPerformance::measureUTF8Encoding(const vector<jschar> &pattern, size_t byteSize)
+{
+    size_t len = byteSize / sizeof(jschar);
+    vector<jschar> chars(len);
+    
+    for (size_t i = 0; i < len; i++)
+    {
+        chars[i] = pattern[i % pattern.size()];
+    }
+    
+    size_t iterations = max<size_t>(1, (64 * 1024 * 1024) / byteSize);
+    size_t checksum1 = 0;
+    size_t checksum2 = 0;
+    
+    // ---
+    
+    Timer timer(true);
+    
+    for (size_t i = 0; i < iterations; i++)
+    {
+        auto utf8 = TwoByteCharsToNewUTF8CharsZ(cx, TwoByteChars(chars.data(), len));
+        string result(utf8.c_str());
+        js_free(utf8.c_str());
+        
+        checksum1 += result.size();
+    }
+    
+    double duration1 = timer.getSeconds() / iterations;
+    
+    // ---
+    
+    timer.start();
+    
+    for (size_t i = 0; i < iterations; i++)
+    {
+        checksum2 += toString(chars.data(), len).size();
+    }
+    
+    double duration2 = timer.getSeconds() / iterations;
+    
+    // ---
+    
+    JSP_CHECK(checksum1 == checksum2);
+    
+    LOGI << byteSize << " BYTES | TwoByteCharsToNewUTF8CharsZ: " << duration1 * 1e6 << " us | JSP::toString: " << duration2 * 1e6 << " us | SPEEDUP: " << duration1 / duration2 << endl;
+}
+
+#pragma mark ---------------------------------------- STRING CREATION ----------------------------------------
+
+/*
+ * COMPARING JSP::toJSString (ASCII FAST-PATH AND SMALL-STRING CACHE) WITH THE LossyUTF8CharsToNewTwoByteCharsZ BASED APPROACH
+ *
+ * - SHORT: TYPICAL PROPERTY-NAMES AND ENUM-LIKE VALUES (I.E. SMALL-STRING CACHE HITS)
+ * - MEDIUM AND LONG: PURE-ASCII, TOO LONG FOR THE CACHE
+ * - UTF-8: NOT ELIGIBLE FOR THE FAST-PATH (EXPECTING NO SPEEDUP)
+ */
+void TestingPerformance::benchmarkStringCreation()
+{
+    LOGI << "SHORT  | ";
+    measureStringCreation({"x", "y", "width", "height", "color", "visible"}, 100000);
+    
+    LOGI << "MEDIUM | ";
+    measureStringCreation({string(100, 'a'), string(200, 'b')}, 100000);
+    
+    LOGI << "LONG   | ";
+    measureStringCreation({string(64 * 1024, 'c')}, 1000);
+    
+    LOGI << "UTF-8  | ";
+    measureStringCreation({"אריאל מלכא", "\xE6\xBC\xA2\xE5\xAD\x97"}, 100000);
+}
+
+void TestingPerformance::measureStringCreation(const vector<string> &samples, size_t iterations)
+{
+    size_t checksum1 = 0;
+    size_t checksum2 = 0;
+    
+    forceGC();
+    
+    // ---
+    
+    Timer timer(true);
+    
+    for (size_t i = 0; i < iterations; i++)
+    {
+        for (auto &sample : samples)
+        {
+            size_t len;
+            jschar *chars = LossyUTF8CharsToNewTwoByteCharsZ(cx, UTF8Chars(sample.data(), sample.size()), &len).get();
+            JSFlatString *str = js_NewString<js::CanGC>(cx, chars, len);
+            
+            checksum1 += str->length();
+        }
+    }
+    
+    double duration1 = timer.getSeconds() / (iterations * samples.size());
+    
+    // ---
+    
+    forceGC();
+    timer.start();
+    
+    for (size_t i = 0; i < iterations; i++)
+    {
+        for (auto &sample : samples)
+        {
+            checksum2 += toJSString(sample)->length();
+        }
+    }
+    
+    double duration2 = timer.getSeconds() / (iterations * samples.size());
+    
+    // ---
+    
+    JSP_CHECK(checksum1 == checksum2);
+    
+    LOGI << "LossyUTF8CharsToNewTwoByteCharsZ: " << duration1 * 1e9 << " ns | JSP::toJSString: " << duration2 * 1e9 << " ns | SPEEDUP: " << duration1 / duration2 << endl;
+}
+
+#pragma mark ---------------------------------------- SCRIPT CACHE ----------------------------------------
+
+/*
+ * EXECUTING handlebars.js REPEATEDLY:
+ *
+ * - COLD: THE SCRIPT-CACHE IS INVALIDATED BEFORE EACH EXECUTION (I.E. PARSING AND COMPILING EACH TIME)
+ * - WARM: THE FRONT-END IS SKIPPED (STILL HASHING THE SOURCE)
+ */
+void TestingPerformance::benchmarkScriptCache()
+{
+    string source = utils::readText<string>(InputSource::getAsset("handlebars.js"));
+    const size_t iterations = 20;
+    
+    ScriptCache::resetCounters();
+    Timer timer(true);
+    
+    for (size_t i = 0; i < iterations; i++)
+    {
+        ScriptCache::invalidate("handlebars.js");
+        executeScript(source, "handlebars.js");
+    }
+    
+    double cold = timer.getSeconds() / iterations;
+    
+    // ---
+    
+    timer.start();
+    
+    for (size_t i = 0; i < iterations; i++)
+    {
+        executeScript(source, "handlebars.js");
+    }
+    
+    double warm = timer.getSeconds() / iterations;
+    
+    // ---
+    
+    JSP_CHECK(ScriptCache::getHitCount() == iterations);
+    
+    LOGI << "handlebars.js (" << source.size() << " BYTES) | COLD: " << cold * 1000 << " ms | WARM: " << warm * 1000 << " ms | SPEEDUP: " << cold / warm << endl;
+    LOGI << "SCRIPT-CACHE | ENTRIES: " << ScriptCache::getEntryCount() << " | BYTES: " << ScriptCache::getByteSize() << endl;
+    
+    ScriptCache::invalidate("handlebars.js");
+}
+
+#pragma mark ---------------------------------------- BYTECODE ----------------------------------------
+
+/*
+ * "COLD START" OF handlebars.js (I.E. WITHOUT THE SCRIPT-CACHE):
+ *
+ * - FROM SOURCE: READING, PARSING AND COMPILING
+ * - FROM BYTECODE: READING AND HASHING THE SOURCE, MEMORY-MAPPING AND DECODING THE XDR FILE
+ */
+void TestingPerformance::benchmarkBytecode()
+{
+    auto inputSource = InputSource::getAsset("handlebars.js");
+    auto bytecodePath = getPublicDirectory() / "handlebars.jsbc";
+    
+    size_t bytecodeSize = precompileScript(inputSource, bytecodePath);
+    const size_t iterations = 20;
+    
+    Timer timer(true);
+    
+    for (size_t i = 0; i < iterations; i++)
+    {
+        ScriptCache::invalidate(inputSource->getFilePathHint());
+        executeScript(inputSource);
+    }
+    
+    double fromSource = timer.getSeconds() / iterations;
+    
+    // ---
+    
+    timer.start();
+    
+    for (size_t i = 0; i < iterations; i++)
+    {
+        executeScript(inputSource, bytecodePath);
+    }
+    
+    double fromBytecode = timer.getSeconds() / iterations;
+    
+    // ---
+    
+    ScriptCache::invalidate(inputSource->getFilePathHint());
+    
+    LOGI << "handlebars.js | BYTECODE: " << bytecodeSize << " BYTES | FROM SOURCE: " << fromSource * 1000 << " ms | FROM BYTECODE: " << fromBytecode * 1000 << " ms | SPEEDUP: " << fromSource / fromBytecode << endl;
+}
+
+#pragma mark ---------------------------------------- TYPED ARRAYS ----------------------------------------
+
+/*
+ * COMPARING THE PER-ELEMENT PATH (Proto::appendElements<T> AND Proto::getElements<T>)
+ * WITH THE TYPED-ARRAY PATH (Proto::newTypedArray<T> AND Proto::getTypedArrayElements<T>)
+ */
+void TestingPerformance::benchmarkTypedArrays()
+{
+    for (size_t count : {1000, 100000, 1000000})
+    {
+        measureTypedArrays(count);
+    }
+}
+
+void TestingPerformance::measureTypedArrays(size_t count)
+{
+    vector<float> elements(count);
+    
+    for (size_t i = 0; i < count; i++)
+    {
+        elements[i] = i * 0.5f;
+    }
+    
+    // ---
+    
+    Timer timer(true);
+    
+    RootedObject array(cx, newArray());
+    appendElements(array, elements);
+    
+    double perElementWrite = timer.getSeconds();
+    
+    timer.start();
+    
+    auto perElementResult = getElements<float>(array);
+    
+    double perElementRead = timer.getSeconds();
+    
+    // ---
+    
+    timer.start();
+    
+    RootedObject typedArray(cx, newTypedArray(elements));
+    
+    double typedWrite = timer.getSeconds();
+    
+    timer.start();
+    
+    vector<float> typedResult;
+    getTypedArrayElements(typedArray, typedResult);
+    
+    double typedRead = timer.getSeconds();
+    
+    // ---
+    
+    JSP_CHECK(perElementResult == elements);
+    JSP_CHECK(typedResult == elements);
+    
+    LOGI << count << " FLOATS | PER-ELEMENT WRITE: " << perElementWrite * 1000 << " ms | TYPED WRITE: " << typedWrite * 1000 << " ms | PER-ELEMENT READ: " << perElementRead * 1000 << " ms | TYPED READ: " << typedRead * 1000 << " ms" << endl;
+}
+
+#pragma mark ---------------------------------------- DENSE ARRAYS ----------------------------------------
+
+/*
+ * COMPARING THE ITERATION PROTOCOL (ForOfIterator) WITH THE DENSE-ARRAY FAST-PATH OF Proto::getElementCount() AND Proto::getElements()
+ *
+ * THE GC HEAP-LIMIT IS TEMPORARILY RAISED (10M ELEMENTS ARE NOT FITTING IN Manager::MAX_BYTES)
+ */
+void TestingPerformance::benchmarkDenseArrays()
+{
+    uint32_t maxBytes = JS_GetGCParameter(rt, JSGC_MAX_BYTES);
+    JS_SetGCParameter(rt, JSGC_MAX_BYTES, 0xffffffff);
+    
+    for (size_t count : {1000, 100000, 10000000})
+    {
+        measureDenseArrays(count);
+    }
+    
+    JS_SetGCParameter(rt, JSGC_MAX_BYTES, maxBytes);
+}
+
+void TestingPerformance::measureDenseArrays(size_t count)
+{
+    executeScript("var denseArray = []; for (var i = 0; i < " + ci::toString(count) + "; i++) { denseArray.push(i); }");
+    RootedObject array(cx, get<OBJECT>(globalHandle(), "denseArray"));
+    
+    // ---
+    
+    Timer timer(true);
+    
+    uint32_t iteratedCount = 0;
+    AutoValueVector iterated(cx);
+    
+    RootedValue iterable(cx, ObjectOrNullValue(array));
+    ForOfIterator it(cx);
+    
+    if (it.init(iterable))
+    {
+        bool done = false;
+        RootedValue value(cx);
+        
+        while (it.next(&value, &done) && !done)
+        {
+            if (!value.isUndefined())
+            {
+                iteratedCount++;
+            }
+            
+            iterated.append(value);
+        }
+    }
+    
+    double iteration = timer.getSeconds();
+    
+    // ---
+    
+    timer.start();
+    
+    uint32_t elementCount = getElementCount(array);
+    
+    double fastCount = timer.getSeconds();
+    
+    timer.start();
+    
+    AutoValueVector elements(cx);
+    getElements(array, elements);
+    
+    double fastElements = timer.getSeconds();
+    
+    // ---
+    
+    JSP_CHECK(elementCount == iteratedCount);
+    JSP_CHECK(elements.length() == iterated.length());
+    
+    deleteProperty(globalHandle(), "denseArray");
+    
+    LOGI << count << " ELEMENTS | ForOfIterator (COUNT + ELEMENTS): " << iteration * 1000 << " ms | getElementCount: " << fastCount * 1000 << " ms | getElements: " << fastElements * 1000 << " ms" << endl;
+}
+
+#pragma mark ---------------------------------------- PROPERTY KEYS ----------------------------------------
+
+/*
+ * COMPARING PROPERTY-ACCESS VIA const char* (ATOMIZED UPON EACH CALL) AND VIA PropertyKey (RESOLVED ONCE)
+ */
+void TestingPerformance::benchmarkPropertyKeys()
+{
+    static thread_local const PropertyKey KEY_X("x");
+    static thread_local const PropertyKey KEY_Y("y");
+    static thread_local const PropertyKey KEY_VISIBLE("visible");
+    
+    RootedObject object(cx, evaluateObject("({x: 1.5, y: 2.5, visible: true})"));
+    const size_t iterations = 1000000;
+    
+    double sum1 = 0;
+    Timer timer(true);
+    
+    for (size_t i = 0; i < iterations; i++)
+    {
+        sum1 += get<FLOAT64>(object, "x") + get<FLOAT64>(object, "y");
+        set(object, "visible", (i & 1) == 0);
+    }
+    
+    double byName = timer.getSeconds();
+    
+    // ---
+    
+    double sum2 = 0;
+    timer.start();
+    
+    for (size_t i = 0; i < iterations; i++)
+    {
+        sum2 += get<FLOAT64>(object, KEY_X) + get<FLOAT64>(object, KEY_Y);
+        set(object, KEY_VISIBLE, (i & 1) == 0);
+    }
+    
+    double byKey = timer.getSeconds();
+    
+    // ---
+    
+    JSP_CHECK(sum1 == sum2);
+    
+    LOGI << iterations << " x (2 GETS + 1 SET) | const char*: " << byName * 1000 << " ms | PropertyKey: " << byKey * 1000 << " ms | SPEEDUP: " << byName / byKey << endl;
+}
+
+#pragma mark ---------------------------------------- STRUCT READER ----------------------------------------
+
+/*
+ * COMPARING StructReader (SHAPE-CACHED SLOT READS) WITH ONE get<T> PER FIELD, FOR OBJECTS SHARING THE SAME SHAPE
+ */
+void TestingPerformance::benchmarkStructReader()
+{
+    struct Particle
+    {
+        double x;
+        double y;
+        double vx;
+        double vy;
+        bool alive;
+    };
+    
+    const size_t count = 10000;
+    const size_t iterations = 100;
+    
+    RootedObject array(cx, evaluateObject("(function(count) { var a = []; for (var i = 0; i < count; i++) a.push({x: i + 0.5, y: i + 0.25, vx: 0.125, vy: -0.125, alive: true}); return a; })(" + ci::toString(count) + ")"));
+    
+    AutoValueVector objects(cx);
+    JSP_CHECK(getElements(array, objects) == count);
+    
+    Particle particle;
+    double sum1 = 0;
+    Timer timer(true);
+    
+    for (size_t j = 0; j < iterations; j++)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            RootedObject object(cx, objects[i].toObjectOrNull());
+            
+            particle.x = get<FLOAT64>(object, JSP_PROPERTY_KEY("x"));
+            particle.y = get<FLOAT64>(object, JSP_PROPERTY_KEY("y"));
+            particle.vx = get<FLOAT64>(object, JSP_PROPERTY_KEY("vx"));
+            particle.vy = get<FLOAT64>(object, JSP_PROPERTY_KEY("vy"));
+            particle.alive = get<BOOLEAN>(object, JSP_PROPERTY_KEY("alive"));
+            
+            sum1 += particle.x + particle.y + particle.vx + particle.vy;
+        }
+    }
+    
+    double byKey = timer.getSeconds();
+    
+    // ---
+    
+    StructReader<Particle> reader;
+    reader.bind("x", &Particle::x).bind("y", &Particle::y).bind("vx", &Particle::vx).bind("vy", &Particle::vy).bind("alive", &Particle::alive);
+    
+    double sum2 = 0;
+    timer.start();
+    
+    for (size_t j = 0; j < iterations; j++)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            RootedObject object(cx, objects[i].toObjectOrNull());
+            reader.read(object, particle);
+            
+            sum2 += particle.x + particle.y + particle.vx + particle.vy;
+        }
+    }
+    
+    double byReader = timer.getSeconds();
+    
+    // ---
+    
+    JSP_CHECK(sum1 == sum2);
+    
+    LOGI << iterations * count << " x 5 FIELDS | PropertyKey: " << byKey * 1000 << " ms | StructReader: " << byReader * 1000 << " ms | SPEEDUP: " << byKey / byReader << " | HITS: " << reader.getHitCount() << " | MISSES: " << reader.getMissCount() << endl;
+}
+
+#pragma mark ---------------------------------------- STRUCT MARSHALLING ----------------------------------------
+
+struct Body
+{
+    double px, py, pz;
+    double vx, vy, vz;
+    double ax, ay, az;
+    double mass;
+    double radius;
+    int32_t id;
+    int32_t group;
+    uint32_t flags;
+    bool awake;
+    std::string name;
+};
+
+JSP_STRUCT(Body,
+    JSP_STRUCT_FIELD(Body, px), JSP_STRUCT_FIELD(Body, py), JSP_STRUCT_FIELD(Body, pz),
+    JSP_STRUCT_FIELD(Body, vx), JSP_STRUCT_FIELD(Body, vy), JSP_STRUCT_FIELD(Body, vz),
+    JSP_STRUCT_FIELD(Body, ax), JSP_STRUCT_FIELD(Body, ay), JSP_STRUCT_FIELD(Body, az),
+    JSP_STRUCT_FIELD(Body, mass),
+    JSP_STRUCT_FIELD(Body, radius),
+    JSP_STRUCT_FIELD(Body, id),
+    JSP_STRUCT_FIELD(Body, group),
+    JSP_STRUCT_FIELD(Body, flags),
+    JSP_STRUCT_FIELD(Body, awake),
+    JSP_STRUCT_FIELD(Body, name))
+
+/*
+ * COMPARING Struct<T>::toJS() / Struct<T>::fromJS() WITH ONE Proto::define() / Proto::get<T>() PER FIELD, FOR A 16-FIELD STRUCT
+ */
+void TestingPerformance::benchmarkStructMarshalling()
+{
+    Body body {0.5, 1.5, 2.5, 0.125, 0.25, 0.375, 0, -9.81, 0, 75.5, 0.25, 33, 2, 0xff, true, "body"};
+    Body result;
+    
+    const size_t iterations = 100000;
+    
+    Timer timer(true);
+    
+    for (size_t i = 0; i < iterations; i++)
+    {
+        RootedObject object(cx, newPlainObject());
+        
+        define(object, "px", body.px, JSPROP_ENUMERATE);
+        define(object, "py", body.py, JSPROP_ENUMERATE);
+        define(object, "pz", body.pz, JSPROP_ENUMERATE);
+        define(object, "vx", body.vx, JSPROP_ENUMERATE);
+        define(object, "vy", body.vy, JSPROP_ENUMERATE);
+        define(object, "vz", body.vz, JSPROP_ENUMERATE);
+        define(object, "ax", body.ax, JSPROP_ENUMERATE);
+        define(object, "ay", body.ay, JSPROP_ENUMERATE);
+        define(object, "az", body.az, JSPROP_ENUMERATE);
+        define(object, "mass", body.mass, JSPROP_ENUMERATE);
+        define(object, "radius", body.radius, JSPROP_ENUMERATE);
+        define(object, "id", body.id, JSPROP_ENUMERATE);
+        define(object, "group", body.group, JSPROP_ENUMERATE);
+        define(object, "flags", body.flags, JSPROP_ENUMERATE);
+        define(object, "awake", body.awake, JSPROP_ENUMERATE);
+        define(object, "name", body.name, JSPROP_ENUMERATE);
+        
+        result.px = get<FLOAT64>(object, "px");
+        result.py = get<FLOAT64>(object, "py");
+        result.pz = get<FLOAT64>(object, "pz");
+        result.vx = get<FLOAT64>(object, "vx");
+        result.vy = get<FLOAT64>(object, "vy");
+        result.vz = get<FLOAT64>(object, "vz");
+        result.ax = get<FLOAT64>(object, "ax");
+        result.ay = get<FLOAT64>(object, "ay");
+        result.az = get<FLOAT64>(object, "az");
+        result.mass = get<FLOAT64>(object, "mass");
+        result.radius = get<FLOAT64>(object, "radius");
+        result.id = get<INT32>(object, "id");
+        result.group = get<INT32>(object, "group");
+        result.flags = get<UINT32>(object, "flags");
+        result.awake = get<BOOLEAN>(object, "awake");
+        result.name = get<STRING>(object, "name");
+    }
+    
+    double manual = timer.getSeconds();
+    JSP_CHECK((result.mass == body.mass) && (result.name == body.name));
+    
+    // ---
+    
+    result = Body();
+    Struct<Body>::resetCounters();
+    
+    timer.start();
+    
+    for (size_t i = 0; i < iterations; i++)
+    {
+        RootedObject object(cx, Struct<Body>::toJS(body));
+        Struct<Body>::fromJS(object, result);
+    }
+    
+    double marshalled = timer.getSeconds();
+    JSP_CHECK((result.mass == body.mass) && (result.name == body.name));
+    
+    LOGI << iterations << " x 16 FIELDS (TO JS AND BACK) | MANUAL: " << manual * 1000 << " ms | Struct: " << marshalled * 1000 << " ms | SPEEDUP: " << manual / marshalled << " | HITS: " << Struct<Body>::getHitCount() << " | MISSES: " << Struct<Body>::getMissCount() << endl;
+}
+
+#pragma mark ---------------------------------------- PROXY DISPATCH ----------------------------------------
+
+static bool accumulateNative(JSContext *cx, unsigned argc, Value *vp)
+{
+    auto args = CallArgsFromVp(argc, vp);
+    args.rval().set(Int32Value(args[0].toInt32() + 1));
+    
+    return true;
+}
+
+static int32_t accumulateTyped(int32_t value)
+{
+    return value + 1;
+}
+
+/*
+ * THE DISPATCH OF Proxy BEFORE ITS FLATTENING, REPRODUCED FOR COMPARISON:
+ *
+ * - INSTANCES AND NATIVE-CALLS LOOKED-UP BY ID IN A std::map
+ * - THE NATIVE-CALL INVOKED VIA Proxy::apply (I.E. VIA std::function)
+ */
+namespace legacy
+{
+    map<int32_t, Proxy*> instances;
+    map<int32_t, NativeCall> nativeCalls;
+    
+    static bool forwardNativeCall(JSContext *cx, unsigned argc, Value *vp)
+    {
+        auto args = CallArgsFromVp(argc, vp);
+        
+        auto proxy = instances.find(GetFunctionNativeReserved(&args.callee(), 0).toInt32());
+        
+        if (proxy != instances.end())
+        {
+            auto nativeCall = nativeCalls.find(GetFunctionNativeReserved(&args.callee(), 1).toInt32());
+            
+            if (nativeCall != nativeCalls.end())
+            {
+                return proxy->second->apply(nativeCall->second, args);
+            }
+        }
+        
+        return false;
+    }
+}
+
+/*
+ * MEASURING THE COST OF A JS-TO-C++ CALL VIA Proxy::forwardNativeCall (GENERIC AND TYPED NATIVE-CALLS), COMPARED TO:
+ *
+ * - A PLAIN JS FUNCTION
+ * - A "RAW" JSNative (I.E. THE LOWER-BOUND FOR ANY JS-TO-C++ CALL)
+ * - THE DISPATCH OF Proxy BEFORE ITS FLATTENING (SEE legacy::forwardNativeCall)
+ */
+void TestingPerformance::benchmarkProxyDispatch()
+{
+    const size_t iterations = 10000000;
+    
+    executeScript("var benchmarkTarget = { accumulateJS: function(i) { return i + 1; } }");
+    
+    RootedObject target(cx, get<OBJECT>(globalHandle(), "benchmarkTarget"));
+    JS_DefineFunction(cx, target, "accumulateNative", accumulateNative, 1, 0);
+    
+    double js = measureCalls("benchmarkTarget.accumulateJS", iterations);
+    double native = measureCalls("benchmarkTarget.accumulateNative", iterations);
+    
+    // ---
+    
+    Proxy proxy;
+    
+    NativeCallFnType accumulate = [](const CallArgs &args)->bool
+    {
+        args.rval().set(Int32Value(args[0].toInt32() + 1));
+        return true;
+    };
+    
+    proxy.registerNativeCall("accumulate", accumulate);
+    double proxied = measureCalls(proxy.getPeerAccessor() + ".accumulate", iterations);
+    
+    RootedObject legacyTarget(cx, newPlainObject());
+    auto legacyFunction = JS_GetFunctionObject(DefineFunctionWithReserved(cx, legacyTarget, "accumulate", legacy::forwardNativeCall, 1, 0));
+    
+    SetFunctionNativeReserved(legacyFunction, 0, Int32Value(1));
+    SetFunctionNativeReserved(legacyFunction, 1, Int32Value(1));
+    
+    legacy::instances.emplace(1, &proxy);
+    legacy::nativeCalls.emplace(1, NativeCall("accumulate", accumulate));
+    
+    set(globalHandle(), "legacyTarget", legacyTarget);
+    double unflattened = measureCalls("legacyTarget.accumulate", iterations);
+    
+    legacy::instances.clear();
+    legacy::nativeCalls.clear();
+    
+    proxy.registerNativeCall("accumulateTyped", accumulateTyped);
+    double typed = measureCalls(proxy.getPeerAccessor() + ".accumulateTyped", iterations);
+    
+    // ---
+    
+    LOGI << iterations << " CALLS | JS: " << js * 1e9 / iterations << " ns | JSNative: " << native * 1e9 / iterations << " ns | Proxy: " << proxied * 1e9 / iterations << " ns | Proxy (TYPED): " << typed * 1e9 / iterations << " ns" << endl;
+    LOGI << "Proxy | BEFORE FLATTENING: " << unflattened * 1e9 / iterations << " ns | AFTER: " << proxied * 1e9 / iterations << " ns | SPEEDUP: " << unflattened / proxied << endl;
+    
+    executeScript("benchmarkTarget = legacyTarget = benchmarkResult = null");
+}
+
+double TestingPerformance::measureCalls(const string &target, size_t iterations)
+{
+    string source = "var benchmarkResult = (function() { var fn = " + target + ", n = 0; for (var i = 0; i < " + ci::toString(iterations) + "; i++) { n = fn(n); } return n; })()";
+    
+    Timer timer(true);
+    executeScript(source);
+    double duration = timer.getSeconds();
+    
+    JSP_CHECK(get<INT32>(globalHandle(), "benchmarkResult") == int32_t(iterations), target);
+    
+    return duration;
+}
+
+#pragma mark ---------------------------------------- PEER CLASS ----------------------------------------
+
+class BenchmarkPeer : public Proxy
+{
+public:
+    static constexpr int METHOD_COUNT = 20;
+    static PeerClass peerClass;
+    
+    int32_t value = 0;
+    
+    BenchmarkPeer(bool shared)
+    :
+    Proxy(PeerProperties(shared ? "BenchmarkShared" : "BenchmarkPerInstance", false, shared ? &peerClass : nullptr))
+    {
+        if (!shared)
+        {
+            for (int i = 0; i < METHOD_COUNT; i++)
+            {
+                registerNativeCall("method" + ci::toString(i), &BenchmarkPeer::step);
+            }
+        }
+    }
+    
+    int32_t step(int32_t delta)
+    {
+        return value += delta;
+    }
+    
+    static PeerClass createPeerClass()
+    {
+        PeerClass result;
+        
+        for (int i = 0; i < METHOD_COUNT; i++)
+        {
+            result.addMethod("method" + ci::toString(i), &BenchmarkPeer::step);
+        }
+        
+        return result;
+    }
+};
+
+PeerClass BenchmarkPeer::peerClass = BenchmarkPeer::createPeerClass();
+
+/*
+ * COMPARING THE GC-HEAP SIZE, THE CREATION-TIME AND THE (FULL) GC-PAUSE FOR N PROXIES WITH 20 METHODS EACH:
+ *
+ * - PER-INSTANCE METHODS, VIA Proxy::registerNativeCall() (I.E. 20 FUNCTIONS PER PEER)
+ * - SHARED METHODS, VIA PeerClass (I.E. 20 FUNCTIONS FOR ALL THE PEERS)
+ */
+void TestingPerformance::benchmarkPeerClass()
+{
+    measurePeerClass(10000, false);
+    measurePeerClass(10000, true);
+    
+    measurePeerClass(100000, false);
+    measurePeerClass(100000, true);
+}
+
+void TestingPerformance::measurePeerClass(size_t count, bool shared)
+{
+    JSP::forceGC();
+    uint32_t bytesBefore = JS_GetGCParameter(rt, JSGC_BYTES);
+    
+    vector<unique_ptr<BenchmarkPeer>> instances;
+    instances.reserve(count);
+    
+    Timer timer(true);
+    
+    for (size_t i = 0; i < count; i++)
+    {
+        instances.emplace_back(new BenchmarkPeer(shared));
+    }
+    
+    double creation = timer.getSeconds();
+    
+    JSP::forceGC();
+    uint32_t bytesAfter = JS_GetGCParameter(rt, JSGC_BYTES);
+    
+    timer.start();
+    JSP::forceGC();
+    double pause = timer.getSeconds();
+    
+    executeScript("var benchmarkResult = " + instances.back()->getPeerAccessor() + ".method19(3)");
+    JSP_CHECK(get<INT32>(globalHandle(), "benchmarkResult") == 3);
+    
+    instances.clear();
+    executeScript("benchmarkResult = null");
+    
+    LOGI << count << " PEERS x " << BenchmarkPeer::METHOD_COUNT << " METHODS | " << (shared ? "PeerClass" : "registerNativeCall") << " | CREATION: " << creation * 1000 << " ms | GC-HEAP: " << (bytesAfter - bytesBefore) / 1024 << " KB | GC-PAUSE: " << pause * 1000 << " ms" << endl;
+}
+
+#pragma mark ---------------------------------------- WORKER MESSAGING ----------------------------------------
+
+/*
+ * ROUND-TRIPS OF ARRAY-BUFFERS BETWEEN THE MAIN ENGINE AND A WORKER (WHICH IS ECHOING THEM BACK):
+ *
+ * - COPIED: SERIALIZED INTO THE CloneBuffer, THEN DESERIALIZED INTO A NEW ARRAY-BUFFER (TWICE PER ROUND-TRIP)
+ * - TRANSFERRED: ONLY THE POINTER TO THE CONTENTS IS TRAVELLING
+ */
+void TestingPerformance::benchmarkWorkerMessaging()
+{
+    measureWorkerMessaging(1024, 100, false);
+    measureWorkerMessaging(1024, 100, true);
+    
+    measureWorkerMessaging(1024 * 1024, 100, false);
+    measureWorkerMessaging(1024 * 1024, 100, true);
+}
+
+void TestingPerformance::measureWorkerMessaging(size_t byteSize, size_t count, bool transfer)
+{
+    const string transferables = transfer ? "[event.data]" : "undefined";
+    
+    Worker worker("onmessage = function(event) { postMessage(event.data, " + transferables + "); }");
+    worker.start();
+    
+    executeScript("var benchmarkReceived = 0; " + worker.getPeerAccessor() + ".onmessage = function(event) { benchmarkReceived++; }");
+    
+    Timer timer(true);
+    
+    executeScript("for (var i = 0; i < " + ci::toString(count) + "; i++) { var buffer = new ArrayBuffer(" + ci::toString(byteSize) + "); " + worker.getPeerAccessor() + ".postMessage(buffer, " + (transfer ? "[buffer]" : "undefined") + "); }");
+    
+    size_t received = 0;
+    
+    while ((received < count) && (timer.getSeconds() < 10))
+    {
+        received += worker.dispatchMessages();
+    }
+    
+    double elapsed = timer.getSeconds();
+    
+    worker.terminate();
+    executeScript("benchmarkReceived = null");
+    
+    JSP_CHECK(received == count);
+    LOGI << count << " ROUND-TRIPS x " << byteSize / 1024 << " KB | " << (transfer ? "TRANSFERRED" : "COPIED") << ": " << elapsed * 1000 << " ms | " << (2 * count * byteSize / (1024.0 * 1024.0)) / elapsed << " MB/s" << endl;
+}
+
+#pragma mark ---------------------------------------- SCRIPT LOADER ----------------------------------------
+
+/*
+ * LOADING handlebars.js 8 TIMES (E.G. A STARTUP WITH SEVERAL LARGE SCRIPTS):
+ *
+ * - SEQUENTIAL: READ, COMPILE AND EXECUTE, ONE SCRIPT AFTER THE OTHER (THE SCRIPT-CACHE IS INVALIDATED BEFORE EACH EXECUTION)
+ * - PIPELINED: VIA ScriptLoader (I.E. READING AND COMPILING OVERLAPPING WITH EXECUTION)
+ */
+void TestingPerformance::benchmarkScriptLoader()
+{
+    const size_t count = 8;
+    vector<InputSource::Ref> inputSources(count, InputSource::getAsset("handlebars.js"));
+    
+    Timer timer(true);
+    
+    for (auto &inputSource : inputSources)
+    {
+        ScriptCache::invalidate(inputSource->getFilePathHint());
+        executeScript(inputSource);
+    }
+    
+    double sequential = timer.getSeconds();
+    
+    // ---
+    
+    ScriptLoader loader(inputSources);
+    JSP_CHECK(loader.run());
+    
+    double read = 0;
+    double compile = 0;
+    double execute = 0;
+    
+    for (auto &timing : loader.getTimings())
+    {
+        read += timing.readSeconds;
+        compile += timing.compileSeconds;
+        execute += timing.executeSeconds;
+    }
+    
+    LOGI << count << " x handlebars.js | SEQUENTIAL: " << sequential * 1000 << " ms | PIPELINED: " << loader.getTotalSeconds() * 1000 << " ms (READ: " << read * 1000 << " ms | COMPILE: " << compile * 1000 << " ms | EXECUTE: " << execute * 1000 << " ms)" << endl;
+}
+
+#pragma mark ---------------------------------------- GC SCHEDULER ----------------------------------------
+
+/*
+ * 600 "FRAMES", EACH ONE ALLOCATING GARBAGE:
+ *
+ * - WITHOUT SCHEDULER: THE COLLECTIONS ARE TRIGGERED BY SPIDERMONKEY, IN THE MIDDLE OF THE FRAMES
+ * - WITH SCHEDULER: THE COLLECTIONS ARE SLICED, AT THE END OF THE FRAMES (4 MS BUDGET)
+ */
+void TestingPerformance::benchmarkGCScheduler()
+{
+    executeScript("function allocateGarbage() { var garbage = []; for (var i = 0; i < 5000; i++) { garbage.push({index: i, name: 'item' + i}); } return garbage.length; }");
+    
+    measureGCScheduler(600, false);
+    measureGCScheduler(600, true);
+}
+
+void TestingPerformance::measureGCScheduler(int frameCount, bool scheduled)
+{
+    auto &scheduler = Manager::getCurrent()->getGCScheduler();
+    
+    scheduler.clearHistory();
+    scheduler.setEnabled(scheduled);
+    scheduler.setBudget(4);
+    
+    JSP::forceGC();
+    
+    vector<double> frameMillis;
+    Timer timer;
+    
+    for (int i = 0; i < frameCount; i++)
+    {
+        timer.start();
+        
+        call(globalHandle(), "allocateGarbage");
+        scheduler.update();
+        
+        frameMillis.push_back(timer.getSeconds() * 1000);
+    }
+    
+    scheduler.setEnabled(false);
+    sort(frameMillis.begin(), frameMillis.end());
+    
+    LOGI << frameCount << " FRAMES | " << (scheduled ? "GCScheduler" : "UNSCHEDULED") << " | MEDIAN: " << frameMillis[frameCount / 2] << " ms | 99TH: " << frameMillis[frameCount * 99 / 100] << " ms | MAX: " << frameMillis.back() << " ms | SLICES: " << scheduler.getSliceCount() << endl;
+}
+
+#pragma mark ---------------------------------------- CLONE-BUFFER COMPRESSION ----------------------------------------
+
+/*
+ * COMPARING RAW SNAPSHOTS WITH COMPRESSED ONES (SEE CloneBuffer::COMPRESSION_ZLIB):
+ *
+ * - SIZE ON DISK
+ * - WRITE THROUGHPUT (MB OF CLONE-STREAM PER SECOND, INCLUDING THE COMPRESSION)
+ * - READ LATENCY (FROM THE FILE, UNTIL THE OBJECT IS DESERIALIZED)
+ *
+ * THE SNAPSHOTS ARE TYPICAL "PERSISTED STATE": MANY OBJECTS SHARING THE SAME KEYS, WITH SHORT AND OFTEN REPEATED STRINGS
+ */
+void TestingPerformance::benchmarkCloneBufferCompression()
+{
+    executeScript("function createState(count) { var state = {entities: []}; for (var i = 0; i < count; i++) { state.entities.push({id: i, type: 'entity-' + (i % 16), position: {x: i * 0.5, y: i * 0.25}, visible: (i % 3) == 0, label: 'label ' + (i % 100)}); } return state; }");
+    
+    for (int count = 1000; count <= 100000; count *= 10)
+    {
+        measureCloneBufferCompression(count, CloneBuffer::COMPRESSION_NONE);
+        measureCloneBufferCompression(count, CloneBuffer::COMPRESSION_ZLIB);
+    }
+}
+
+void TestingPerformance::measureCloneBufferCompression(int count, CloneBuffer::Compression compression)
+{
+    auto snapshotPath = getPublicDirectory() / "benchmark.jsclone";
+    
+    RootedObject state(cx, evaluateObject("createState(" + ci::toString(count) + ")"));
+    CloneBuffer serialized(state);
+    
+    Timer timer(true);
+    size_t fileSize = serialized.write(writeFile(snapshotPath), compression);
+    double writeDuration = timer.getSeconds();
+    
+    timer.start();
+    RootedObject restored(cx, CloneBuffer::read(loadFile(snapshotPath)));
+    double readDuration = timer.getSeconds();
+    
+    JSP_CHECK(restored);
+    
+    LOGI << count << " ENTITIES | " << ((compression == CloneBuffer::COMPRESSION_ZLIB) ? "ZLIB" : "RAW") << " | SIZE: " << fileSize << " bytes (" << 100.0 * fileSize / serialized.getDataSize() << "%) | WRITE: " << serialized.getDataSize() / writeDuration / (1024 * 1024) << " MB/s | READ: " << readDuration * 1000 << " ms" << endl;
+}
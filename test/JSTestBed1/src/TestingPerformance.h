@@ -0,0 +1,68 @@
+/*
+ * JSP: https://github.com/arielm/jsp
+ * COPYRIGHT (C) 2014-2015, ARIEL MALKA ALL RIGHTS RESERVED.
+ *
+ * THE FOLLOWING SOURCE-CODE IS DISTRIBUTED UNDER THE SIMPLIFIED BSD LICENSE:
+ * https://github.com/arielm/jsp/blob/master/LICENSE
+ */
+
+/*
+ * BENCHMARKS: NOT EXECUTED BY DEFAULT
+ *
+ * MEANINGFUL ONLY IN RELEASE MODE (E.G. NOT WITH DEBUG SPIDERMONKEY BUILDS)
+ */
+
+#pragma once
+
+#include "TestingJSBase.h"
+
+#include "jsp/CloneBuffer.h"
+
+class TestingPerformance : public TestingJSBase
+{
+public:
+    void performSetup() final;
+    void performShutdown() final;
+    void performRun(bool force = false) final;
+    
+    // ---
+    
+    void benchmarkTracerRegistry();
+    void measureTracerRegistry(size_t rootCount);
+    
+    void benchmarkUTF8Encoding();
+    void measureUTF8Encoding(const std::vector<jschar> &pattern, size_t byteSize);
+    
+    void benchmarkStringCreation();
+    void measureStringCreation(const std::vector<std::string> &samples, size_t iterations);
+    
+    void benchmarkScriptCache();
+    void benchmarkBytecode();
+    
+    void benchmarkTypedArrays();
+    void measureTypedArrays(size_t count);
+    
+    void benchmarkDenseArrays();
+    void measureDenseArrays(size_t count);
+    
+    void benchmarkPropertyKeys();
+    void benchmarkStructReader();
+    void benchmarkStructMarshalling();
+    
+    void benchmarkProxyDispatch();
+    double measureCalls(const std::string &target, size_t iterations);
+    
+    void benchmarkPeerClass();
+    void measurePeerClass(size_t count, bool shared);
+    
+    void benchmarkWorkerMessaging();
+    void measureWorkerMessaging(size_t byteSize, size_t count, bool transfer);
+    
+    void benchmarkScriptLoader();
+    
+    void benchmarkGCScheduler();
+    void measureGCScheduler(int frameCount, bool scheduled);
+    
+    void benchmarkCloneBufferCompression();
+    void measureCloneBufferCompression(int count, jsp::CloneBuffer::Compression compression);
+};
@@ -24,11 +24,16 @@ void TestingProxy::performRun(bool force)
     {
         JSP_TEST(force || true, testPeers1); // SHOULD BE EXECUTED FIRST BECAUSE IT ASSUMES peers.Proxy[0] IS THE LAST Proxy INSTANCE
         JSP_TEST(force || true, testPeers2);
+        JSP_TEST(force || true, testPeers4);
+        JSP_TEST(force || true, testPeers5);
     }
     
     if (force || true)
     {
         JSP_TEST(force || true, testNativeCalls1);
+        JSP_TEST(force || true, testNativeCalls2);
+        JSP_TEST(force || true, testNativeCalls3);
+        JSP_TEST(force || true, testPeerClass);
     }
     
     if (force || true)
@@ -94,6 +99,85 @@ void TestingProxy::testPeers2()
     JSP_CHECK(customNamed2.getPeerAccessor() == "peers[\"Script Manager\"]");
 }
 
+/*
+ * THE INDICES OF DESTROYED (NON-SINGLETON) PROXIES ARE REUSED: UNDER CHURN, THE PEER-ARRAY IS NOT GROWING
+ */
+void TestingProxy::testPeers4()
+{
+    Proxy proxy1("Recycled");
+    
+    auto proxy2 = new Proxy("Recycled");
+    auto proxy3 = new Proxy("Recycled");
+    JSP_CHECK(proxy3->getPeerAccessor() == "peers.Recycled[2]");
+    
+    delete proxy2;
+    JSP_CHECK(evaluateBoolean("return !(1 in peers.Recycled)"));
+    
+    Proxy proxy4("Recycled");
+    JSP_CHECK(proxy4.getPeerAccessor() == "peers.Recycled[1]");
+    JSP_CHECK(evaluateBoolean("return peers.Recycled[1].index === 1"));
+    
+    for (int i = 0; i < 1000; i++)
+    {
+        delete proxy3;
+        proxy3 = new Proxy("Recycled");
+    }
+    
+    JSP_CHECK(proxy3->getPeerAccessor() == "peers.Recycled[2]");
+    JSP_CHECK(evaluateBoolean("return peers.Recycled.length === 3"));
+    
+    delete proxy3;
+}
+
+/*
+ * LAZY PEERS ARE CREATED UPON FIRST ACCESS FROM JS (OR VIA Proxy::getPeer), PEER-LESS PROXIES HAVE NO PEER AT ALL
+ */
+void TestingProxy::testPeers5()
+{
+    Proxy peerLess(PeerProperties(""));
+    JSP_CHECK(!peerLess.hasPeer() && peerLess.getPeerAccessor().empty() && !peerLess.getPeer());
+    
+    Proxy singleton("Taken", true);
+    Proxy duplicate("Taken", true);
+    JSP_CHECK(singleton.hasPeer() && !duplicate.hasPeer(), "PEER-NAME ALREADY TAKEN");
+    
+    // ---
+    
+    Proxy lazy1(PeerProperties("Lazy", false, nullptr, true));
+    Proxy lazy2(PeerProperties("Lazy", false, nullptr, true));
+    
+    lazy2.registerNativeCall("getAnswer", [](const CallArgs &args)->bool
+    {
+        args.rval().set(Int32Value(42));
+        return true;
+    });
+    
+    RootedObject peers(cx, get<OBJECT>(globalHandle(), "peers"));
+    JSP_CHECK(!lazy1.peer && !lazy2.peer && !hasOwnProperty(peers, "Lazy"), "NOT CREATED YET");
+    
+    JSP_CHECK(evaluateBoolean("return " + lazy2.getPeerAccessor() + ".getAnswer() === 42"));
+    JSP_CHECK(lazy1.peer && lazy2.peer, "CREATED UPON FIRST ACCESS");
+    
+    Proxy lazy3(PeerProperties("Lazy", false, nullptr, true));
+    JSP_CHECK(lazy3.peer, "CREATED IMMEDIATELY, SINCE peers.Lazy IS ALREADY DEFINED");
+    
+    Proxy lazySingleton(PeerProperties("LazySingleton", true, nullptr, true));
+    JSP_CHECK(!lazySingleton.peer);
+    
+    JSP_CHECK(lazySingleton.getPeer() && evaluateBoolean("return peers.LazySingleton.isSingleton === true"), "CREATED VIA getPeer()");
+    
+    // ---
+    
+    Proxy mixedLazy1(PeerProperties("Mixed", false, nullptr, true));
+    Proxy mixedLazy2(PeerProperties("Mixed", false, nullptr, true));
+    JSP_CHECK(!mixedLazy1.peer && !mixedLazy2.peer && !hasOwnProperty(peers, "Mixed"));
+    
+    Proxy mixedEager(PeerProperties("Mixed", false, nullptr, false));
+    JSP_CHECK(mixedEager.peer && mixedLazy1.peer && mixedLazy2.peer, "PENDING PEERS CREATED WITH THE FIRST EAGER PEER");
+    
+    JSP_CHECK(evaluateBoolean("return peers.Mixed.length === 3 && peers.Mixed.every(function(peer, index) { return peer.index === index; })"));
+}
+
 /*
  * TODO: PREVENT THE FOLLOWING NON-INTENTIONALLY-ALLOWED OPERATIONS
  * 
@@ -191,4 +275,276 @@ void TestingProxy::testNativeCalls1()
 
     proxy.unregisterNativeCall("staticMethod1");
     executeScript("try { print(target.staticMethod1(33)); } catch(e) { print(e);}"); // TODO: JSP_CHECK "CAPTURED" OUTPUT
+    
+    // ---
+    
+    /*
+     * A HANDLER REGISTERING NATIVE-CALLS (I.E. GROWING THE STORAGE IT IS INVOKED FROM) AND UNREGISTERING ITSELF
+     */
+    string suffix = "-SURVIVING";
+    
+    proxy.registerNativeCall("reentrant", [&proxy, suffix](const CallArgs &args)->bool
+    {
+        for (int i = 0; i < 64; i++)
+        {
+            proxy.registerNativeCall("added" + ci::toString(i), BIND_STATIC1(staticMethod1));
+        }
+        
+        proxy.unregisterNativeCall("reentrant");
+        
+        args.rval().set(JSP::toValue<string>("CAPTURE" + suffix)); // I.E. THE CAPTURES ARE STILL ALIVE
+        return true;
+    });
+    
+    JSP_CHECK(evaluateBoolean("return target.reentrant() === 'CAPTURE-SURVIVING'"));
+    JSP_CHECK(evaluateBoolean("return (target.reentrant === undefined) && (target.added63(2) == -2)"));
+}
+
+/*
+ * FORWARDING FUNCTIONS OUTLIVING THEIR PROXY (OR THEIR NATIVE-CALL) ARE NOT DISPATCHED,
+ * EVEN WHEN THE INDEX OF THEIR PROXY IS REUSED: A JS-ERROR IS REPORTED INSTEAD
+ */
+void TestingProxy::testNativeCalls2()
+{
+    {
+        Proxy proxy;
+        proxy.registerNativeCall("negate", BIND_STATIC1(staticMethod1));
+        
+        executeScript("var staleTarget = " + proxy.getPeerAccessor() + ", staleNegate = staleTarget.negate");
+        JSP_CHECK(evaluateBoolean("return staleNegate(5) == -5"));
+        
+        proxy.unregisterNativeCall("negate");
+        JSP_CHECK(evaluateBoolean("try { staleNegate(5); return false; } catch (e) { return true; }"), "UNREGISTERED NATIVE-CALL");
+        
+        proxy.registerNativeCall("negate", BIND_STATIC1(staticMethod1));
+        JSP_CHECK(evaluateBoolean("return staleTarget.negate(5) == -5"), "RE-REGISTERED NATIVE-CALL");
+        
+        executeScript("staleNegate = staleTarget.negate");
+    }
+    
+    Proxy proxy;
+    
+    proxy.registerNativeCall("negate", [](const CallArgs &args)->bool
+    {
+        args.rval().set(Int32Value(123));
+        return true;
+    });
+    
+    JSP_CHECK(evaluateBoolean("return " + proxy.getPeerAccessor() + ".negate(5) == 123"));
+    JSP_CHECK(evaluateBoolean("try { staleNegate(5); return false; } catch (e) { return true; }"), "DESTROYED PROXY");
+    
+    /*
+     * THE SAME INDEX, REUSED BY MORE THAN 2^15 SUCCESSIVE INSTANCES: THE GENERATION MUST NOT WRAP-AROUND
+     */
+    {
+        Proxy stale;
+        stale.registerNativeCall("negate", BIND_STATIC1(staticMethod1));
+        
+        executeScript("staleNegate = " + stale.getPeerAccessor() + ".negate");
+    }
+    
+    RootedValue staleNegate(cx);
+    JS_GetProperty(cx, globalHandle(), "staleNegate", &staleNegate);
+    
+    RootedValue arg(cx, Int32Value(5));
+    int dispatchCount = 0;
+    
+    for (int i = 0; i < (1 << 15) + 16; i++)
+    {
+        Proxy reusing;
+        reusing.registerNativeCall("negate", BIND_STATIC1(staticMethod1));
+        
+        RootedValue result(cx);
+        
+        if (JS_CallFunctionValue(cx, NullPtr(), staleNegate, HandleValueArray(arg), &result))
+        {
+            dispatchCount++;
+        }
+        
+        JS_ClearPendingException(cx);
+    }
+    
+    JSP_CHECK(dispatchCount == 0, "REUSED INDEX");
+    
+    executeScript("staleTarget = staleNegate = null");
+}
+
+// ---
+
+static double typedFunction1(int32_t a, double b)
+{
+    return a * b;
+}
+
+double TestingProxy::instanceMethod2(double value)
+{
+    return value * instanceValue1;
+}
+
+string TestingProxy::instanceMethod3(const string &prefix, int32_t count) const
+{
+    string result;
+    
+    for (int32_t i = 0; i < count; i++)
+    {
+        result += prefix;
+    }
+    
+    return result;
+}
+
+class Counter : public Proxy
+{
+public:
+    int32_t value = 0;
+    
+    Counter()
+    :
+    Proxy("Counter", true)
+    {
+        registerNativeCall("increment", &Counter::increment);
+        registerNativeCall("reset", &Counter::reset);
+        registerNativeCall("get", &Counter::current);
+    }
+    
+    int32_t increment(int32_t step)
+    {
+        return value += step;
+    }
+    
+    void reset()
+    {
+        value = 0;
+    }
+    
+    int32_t current() const
+    {
+        return value;
+    }
+};
+
+/*
+ * TYPED NATIVE-CALLS: ARGUMENTS AND RETURN-VALUES CONVERTED BASED ON THE C++ SIGNATURE (SEE NativeCall.h)
+ */
+void TestingProxy::testNativeCalls3()
+{
+    Proxy proxy;
+    
+    proxy.registerNativeCall("typedFunction1", typedFunction1);
+    proxy.registerNativeCall("instanceMethod2", this, &TestingProxy::instanceMethod2);
+    proxy.registerNativeCall("instanceMethod3", this, &TestingProxy::instanceMethod3);
+    
+    executeScript("var target = " + proxy.getPeerAccessor());
+    
+    JSP_CHECK(evaluateBoolean("return target.typedFunction1(3, 0.5) === 1.5"));
+    JSP_CHECK(evaluateBoolean("return target.typedFunction1(3.0, 2) === 6"), "INTEGRAL DOUBLE ACCEPTED AS INT32");
+    JSP_CHECK(evaluateBoolean("var result = target.typedFunction1(-0, 1); return (result === 0) && (1 / result === Infinity)"), "-0 ACCEPTED AS INT32 0");
+    JSP_CHECK(evaluateBoolean("return (target.typedFunction1(Math.round(-0.3), 1) === 0) && (target.typedFunction1(0 * -1, 1) === 0)"));
+    JSP_CHECK(evaluateBoolean("return target.instanceMethod2(11) === 55"), "INT32 ACCEPTED AS DOUBLE");
+    JSP_CHECK(evaluateBoolean("return target.instanceMethod3('ab', 3) === 'ababab'"));
+    
+    JSP_CHECK(evaluateBoolean("try { target.typedFunction1(3.5, 1); return false; } catch (e) { return true; }"), "NON-INTEGRAL DOUBLE REJECTED AS INT32");
+    JSP_CHECK(evaluateBoolean("try { target.typedFunction1(NaN, 1); return false; } catch (e) { return true; }"), "NaN REJECTED AS INT32");
+    JSP_CHECK(evaluateBoolean("try { target.typedFunction1(Infinity, 1); return false; } catch (e) { return true; }"), "INFINITY REJECTED AS INT32");
+    JSP_CHECK(evaluateBoolean("try { target.typedFunction1(4294967296, 1); return false; } catch (e) { return true; }"), "OUT-OF-RANGE DOUBLE REJECTED AS INT32");
+    JSP_CHECK(evaluateBoolean("try { target.instanceMethod2('11'); return false; } catch (e) { return true; }"), "STRING REJECTED AS DOUBLE");
+    JSP_CHECK(evaluateBoolean("try { target.instanceMethod3('ab'); return false; } catch (e) { return true; }"), "MISSING ARGUMENT");
+    
+    // ---
+    
+    Counter counter;
+    
+    JSP_CHECK(evaluateBoolean("peers.Counter.increment(5); return peers.Counter.increment(2) === 7"));
+    JSP_CHECK(counter.value == 7);
+    
+    JSP_CHECK(evaluateBoolean("return peers.Counter.reset() === undefined"));
+    JSP_CHECK(evaluateBoolean("return peers.Counter.get() === 0"));
+    
+    executeScript("target = null");
+}
+
+class Vehicle : public Proxy
+{
+public:
+    static PeerClass peerClass;
+    
+    double speed = 0;
+    
+    Vehicle(PeerClass *vehicleClass = &peerClass)
+    :
+    Proxy(PeerProperties("Vehicle", false, vehicleClass))
+    {}
+    
+    double accelerate(double delta)
+    {
+        return speed += delta;
+    }
+    
+    double getSpeed() const
+    {
+        return speed;
+    }
+    
+    bool describe(const CallArgs &args)
+    {
+        const string description = "Vehicle " + ci::toString(peerElementIndex);
+        args.rval().set(JSP::toValue<string>(description));
+        return true;
+    }
+};
+
+PeerClass Vehicle::peerClass = PeerClass()
+    .addMethod("accelerate", &Vehicle::accelerate)
+    .addMethod("getSpeed", &Vehicle::getSpeed)
+    .addMethod("describe", &Vehicle::describe);
+
+/*
+ * METHODS DECLARED ONCE, ON A PROTOTYPE SHARED BY ALL THE PEERS OF THE CLASS (SEE PeerClass.h)
+ */
+void TestingProxy::testPeerClass()
+{
+    auto vehicle1 = new Vehicle;
+    Vehicle vehicle2;
+    
+    executeScript("var vehicle1 = " + vehicle1->getPeerAccessor() + ", vehicle2 = " + vehicle2.getPeerAccessor());
+    
+    JSP_CHECK(evaluateBoolean("return Object.getPrototypeOf(vehicle1) === Object.getPrototypeOf(vehicle2)"), "SHARED PROTOTYPE");
+    JSP_CHECK(evaluateBoolean("return !vehicle1.hasOwnProperty('accelerate') && (vehicle1.accelerate === vehicle2.accelerate)"), "SHARED METHODS");
+    JSP_CHECK(evaluateBoolean("return vehicle1.name === 'Vehicle'"));
+    
+    JSP_CHECK(evaluateBoolean("vehicle1.accelerate(1.5); return vehicle1.accelerate(2) === 3.5"));
+    JSP_CHECK(evaluateBoolean("return vehicle2.getSpeed() === 0"));
+    JSP_CHECK(vehicle1->speed == 3.5);
+    
+    JSP_CHECK(evaluateBoolean("return vehicle2.describe() === 'Vehicle ' + vehicle2.index"));
+    JSP_CHECK(evaluateBoolean("try { vehicle1.accelerate('fast'); return false; } catch (e) { return true; }"), "INVALID ARGUMENT");
+    JSP_CHECK(evaluateBoolean("try { vehicle1.getSpeed.call({}); return false; } catch (e) { return true; }"), "INCOMPATIBLE PEER");
+    
+    // ---
+    
+    delete vehicle1;
+    
+    JSP_CHECK(evaluateBoolean("try { vehicle1.getSpeed(); return false; } catch (e) { return true; }"), "DETACHED PEER");
+    JSP_CHECK(evaluateBoolean("return vehicle2.accelerate(0.5) === 0.5"));
+    
+    JSP::forceGC(); // THE PROTOTYPE MUST SURVIVE (AND BE RELOCATED BY) A GC
+    JSP_CHECK(evaluateBoolean("return vehicle2.getSpeed() === 0.5"), "PROTOTYPE AFTER GC");
+    
+    executeScript("vehicle1 = vehicle2 = null");
+    
+    // ---
+    
+    {
+        PeerClass transientClass;
+        transientClass.addMethod("getSpeed", &Vehicle::getSpeed);
+        
+        Vehicle vehicle3(&transientClass);
+        
+        executeScript("var vehicle3 = " + vehicle3.getPeerAccessor());
+        executeScript("var getSpeed = vehicle3.getSpeed");
+    }
+    
+    JSP_CHECK(evaluateBoolean("try { getSpeed.call({}); return false; } catch (e) { return true; }"), "DETACHED FUNCTION");
+    
+    executeScript("vehicle3 = getSpeed = null");
 }
@@ -20,10 +20,23 @@ public:
     void testPeers1();
     void testPeers2();
     void testPeers3();
+    void testPeers4();
+    void testPeers5();
     
     // ---
     
     double instanceValue1 = 5;
     bool instanceMethod1(const JS::CallArgs &args);
     void testNativeCalls1();
+    void testNativeCalls2();
+    
+    // ---
+    
+    double instanceMethod2(double value);
+    std::string instanceMethod3(const std::string &prefix, int32_t count) const;
+    void testNativeCalls3();
+    
+    // ---
+    
+    void testPeerClass();
 };
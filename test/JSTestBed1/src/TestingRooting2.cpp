@@ -8,6 +8,10 @@
 
 #include "TestingRooting2.h"
 
+#include "jsp/Manager.h"
+#include "jsp/GCTelemetry.h"
+#include "jsp/MemoryReport.h"
+
 #include "chronotext/Context.h"
 
 using namespace std;
@@ -64,6 +68,14 @@ void TestingRooting2::performRun(bool force)
         JSP_TEST(force || true, testBarkerPassedToJS1);
         JSP_TEST(force || true, testHeapWrappedJSBarker2);
     }
+    
+    if (force || true)
+    {
+        JSP_TEST(force || true, testGCScheduler)
+        JSP_TEST(force || true, testGCTelemetry)
+        JSP_TEST(force || true, testGCController)
+        JSP_TEST(force || true, testMemoryReport)
+    }
 }
 
 // ---
@@ -470,3 +482,231 @@ void TestingRooting2::testHeapWrappedJSBarker2()
     forceGC();
     JSP_CHECK(Barker::isFinalized("HEAP-WRAPPED 2"));
 }
+
+// ---
+
+/*
+ * A FULL INCREMENTAL CYCLE, IN SLICES OF 1 MS (I.E. AS IF THE FRAME-SLACK WAS VERY SMALL)
+ */
+void TestingRooting2::testGCScheduler()
+{
+    auto &scheduler = Manager::getCurrent()->getGCScheduler();
+    
+    auto previousMode = JS_GetGCParameter(rt, JSGC_MODE);
+    
+    scheduler.clearHistory();
+    scheduler.setEnabled(true);
+    scheduler.setBudget(1);
+    
+    JSP_CHECK(scheduler.isIncremental(), "NOT DISABLED BY BARKERS");
+    
+    executeScript("new Barker('SCHEDULED 1'); var scheduledGarbage = []; for (var i = 0; i < 10000; i++) { scheduledGarbage.push({index: i}); } scheduledGarbage = null;");
+    
+    {
+        Heap<WrappedValue> heapWrapped(Barker::create("SCHEDULED 2"));
+        
+        scheduler.requestCycle();
+        int frameCount = 0;
+        
+        do
+        {
+            scheduler.update();
+        }
+        while (scheduler.isCollecting() && (++frameCount < 1000));
+        
+        JSP_CHECK(scheduler.getCycleCount() == 1);
+        JSP_CHECK(scheduler.getSliceCount() > 1, "INCREMENTAL");
+        JSP_CHECK(scheduler.getHistory().front().cycleStarted && scheduler.getHistory().back().cycleFinished);
+        JSP_CHECK(scheduler.getPhase() == GCScheduler::PHASE_IDLE);
+        
+        JSP_CHECK(Barker::isHealthy("SCHEDULED 2"), "ROOTED BARKER SURVIVING THE CYCLE");
+        JSP_CHECK(Barker::isFinalized("SCHEDULED 1"), "UNROOTED BARKER COLLECTED");
+        
+        LOGI << "GCScheduler | SLICES: " << scheduler.getSliceCount() << " | MAX SLICE: " << scheduler.getMaxSliceMillis() << " ms" << endl;
+    }
+    
+    scheduler.setEnabled(false);
+    JSP_CHECK(JS_GetGCParameter(rt, JSGC_MODE) == previousMode, "MODE RESTORED");
+}
+
+void TestingRooting2::testGCTelemetry()
+{
+    GCTelemetry::reset();
+    
+    forceGC();
+    JSP_CHECK(GCTelemetry::getCollectionCount() == 1);
+    
+    auto collection = GCTelemetry::getCollections().back();
+    JSP_CHECK(string(collection.reason) == "API");
+    JSP_CHECK((collection.sliceCount == 1) && (collection.pauseMillis == collection.maxPauseMillis), "NON-INCREMENTAL");
+    
+    // ---
+    
+    auto &scheduler = Manager::getCurrent()->getGCScheduler();
+    
+    scheduler.setEnabled(true);
+    scheduler.setBudget(1);
+    scheduler.requestCycle();
+    
+    while (scheduler.update() && scheduler.isCollecting())
+    {}
+    
+    scheduler.setEnabled(false);
+    
+    collection = GCTelemetry::getCollections().back();
+    JSP_CHECK(string(collection.reason) == "SCHEDULED");
+    JSP_CHECK(collection.durationMillis >= collection.pauseMillis);
+    
+    // ---
+    
+    JSP_CHECK(GCTelemetry::getPauseHistogram()->getTotalCount() == GCTelemetry::getPauseRing()->getPushCount(), "ONE SAMPLE PER SLICE");
+    JSP_CHECK(GCTelemetry::getRecentPausePercentile(1) >= GCTelemetry::getRecentPausePercentile(0.5));
+    
+    JSP_CHECK(evaluateBoolean("var telemetry = getGCTelemetry(); return (telemetry.count == 2) && (telemetry.collections[1].reason == 'SCHEDULED')"), "JS SIDE");
+    
+    // ---
+    
+    PauseRing ring;
+    
+    for (size_t i = 0; i < PauseRing::CAPACITY + 10; i++)
+    {
+        ring.push(float(i));
+    }
+    
+    auto pauses = ring.snapshot();
+    JSP_CHECK((pauses.size() == PauseRing::CAPACITY - 1) && (pauses.front() == 11) && (pauses.back() == PauseRing::CAPACITY + 9), "OLDEST TO NEWEST, WITHOUT THE NEXT SLOT");
+}
+
+void TestingRooting2::testGCController()
+{
+    auto &controller = Manager::getCurrent()->getGCController();
+    auto &scheduler = Manager::getCurrent()->getGCScheduler();
+    
+    /*
+     * ALL THE PARAMETERS WHICH CAN BE TOUCHED BY THE CONTROLLER ARE RESTORED AT THE END
+     */
+    const vector<JSGCParamKey> keys =
+    {
+        JSGC_HIGH_FREQUENCY_TIME_LIMIT,
+        JSGC_HIGH_FREQUENCY_LOW_LIMIT,
+        JSGC_HIGH_FREQUENCY_HIGH_LIMIT,
+        JSGC_HIGH_FREQUENCY_HEAP_GROWTH_MIN,
+        JSGC_HIGH_FREQUENCY_HEAP_GROWTH_MAX,
+        JSGC_LOW_FREQUENCY_HEAP_GROWTH,
+        JSGC_MAX_BYTES,
+        JSGC_DYNAMIC_HEAP_GROWTH,
+        JSGC_DYNAMIC_MARK_SLICE,
+        JSGC_SLICE_TIME_BUDGET
+    };
+    
+    std::map<JSGCParamKey, uint32_t> previousValues;
+    
+    for (auto key : keys)
+    {
+        previousValues[key] = JS_GetGCParameter(rt, key);
+    }
+    
+    auto previousBudget = scheduler.getBudget();
+    
+    JSP_CHECK(controller.loadPresets(InputSource::getAsset("config.json")));
+    JSP_CHECK(!controller.loadPresets("{\"slaves\": []}"), "NO PRESETS");
+    JSP_CHECK(!controller.usePreset("undefined"));
+    
+    // ---
+    
+    JSP_CHECK(controller.usePreset("low-memory"));
+    controller.setEnabled(true);
+    
+    JSP_CHECK(JS_GetGCParameter(rt, JSGC_HIGH_FREQUENCY_HIGH_LIMIT) == 16);
+    JSP_CHECK(JS_GetGCParameter(rt, JSGC_LOW_FREQUENCY_HEAP_GROWTH) == 120);
+    JSP_CHECK(JS_GetGCParameter(rt, JSGC_HIGH_FREQUENCY_HEAP_GROWTH_MAX) <= 150, "WITHIN BOUNDS");
+    JSP_CHECK(controller.getAdjustmentCount() == controller.getAdjustments().size(), "EACH ADJUSTMENT IS RECORDED");
+    
+    // ---
+    
+    JSP_CHECK(controller.usePreset("low-latency"));
+    auto &preset = controller.getPreset();
+    
+    for (int i = 0; i < 4; i++)
+    {
+        executeScript("var garbage = []; for (var i = 0; i < 10000; i++) { garbage.push({index: i}); }");
+        forceGC();
+        
+        controller.update();
+    }
+    
+    auto maxBytes = JS_GetGCParameter(rt, JSGC_MAX_BYTES);
+    JSP_CHECK((maxBytes >= preset.memoryFloor * 1024 * 1024) && (maxBytes <= preset.memoryCeiling * 1024 * 1024));
+    
+    JSP_CHECK((scheduler.getBudget() >= preset.minSliceBudget) && (scheduler.getBudget() <= preset.maxSliceBudget));
+    
+    JSP_CHECK(controller.getAllocationRate() > 0);
+    
+    for (auto &adjustment : controller.getAdjustments())
+    {
+        JSP_CHECK(adjustment.from != adjustment.to);
+        JSP_CHECK(scheduler.isEnabled() || (string(adjustment.parameter) != "JSGC_SLICE_TIME_BUDGET"), "ONLY APPLIED CHANGES ARE RECORDED");
+    }
+    
+    // ---
+    
+    GCController::Preset oversized;
+    oversized.name = "oversized";
+    oversized.memoryFloor = 8192;
+    oversized.memoryCeiling = 16384;
+    
+    controller.addPreset(oversized);
+    JSP_CHECK(controller.usePreset("oversized"));
+    JSP_CHECK(controller.getPreset().memoryCeiling < 4096, "CLAMPED TO 32-BIT JSGC_MAX_BYTES");
+    JSP_CHECK(JS_GetGCParameter(rt, JSGC_MAX_BYTES) >= 4095u * 1024 * 1024, "NO OVERFLOW");
+    
+    // ---
+    
+    controller.setEnabled(false);
+    scheduler.setBudget(previousBudget);
+    
+    /*
+     * THE LOW-LIMIT MUST REMAIN BELOW THE HIGH-LIMIT AT ANY TIME
+     */
+    if (previousValues[JSGC_HIGH_FREQUENCY_LOW_LIMIT] >= JS_GetGCParameter(rt, JSGC_HIGH_FREQUENCY_HIGH_LIMIT))
+    {
+        JS_SetGCParameter(rt, JSGC_HIGH_FREQUENCY_HIGH_LIMIT, previousValues[JSGC_HIGH_FREQUENCY_HIGH_LIMIT]);
+    }
+    
+    for (auto key : keys)
+    {
+        JS_SetGCParameter(rt, key, previousValues[key]);
+    }
+}
+
+void TestingRooting2::testMemoryReport()
+{
+    RootedObject barker(cx, Barker::create("MEMORY-REPORT"));
+    auto cloneBytes = CloneBuffer::getLiveBytes();
+    
+    RootedValue message(cx, ObjectOrNullValue(evaluateObject("({values: [1, 2, 3], name: 'MESSAGE'})")));
+    CloneBuffer buffer(message, UndefinedHandleValue);
+    
+    auto report = MemoryReport::collect();
+    
+    JSP_CHECK(report.runtime.gcHeapChunkTotal >= report.runtime.gcHeapGCThings);
+    JSP_CHECK(report.zones.strings > 0);
+    
+    auto found = find_if(report.compartments.begin(), report.compartments.end(), [](const MemoryReport::Compartment &compartment) { return compartment.name == "global"; });
+    JSP_CHECK((found != report.compartments.end()) && (found->objectsOrdinary > 0) && (found->scripts > 0), "GLOBAL COMPARTMENT");
+    
+    JSP_CHECK(report.overhead.barkerCount > 0);
+    JSP_CHECK(report.overhead.tracerBytes > 0);
+    JSP_CHECK(report.overhead.cloneBufferBytes > cloneBytes, "CLONE-BUFFER ACCOUNTED");
+    
+    // ---
+    
+    auto json = report.toJSON();
+    LOGI << json << endl;
+    
+    RootedObject parsed(cx, parse(json));
+    JSP_CHECK(parsed, "VALID JSON");
+    
+    RootedObject overhead(cx, get<OBJECT>(parsed, "jsp"));
+    JSP_CHECK(get<UINT32>(overhead, "barkerCount") == report.overhead.barkerCount);
+}
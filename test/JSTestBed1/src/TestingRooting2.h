@@ -42,4 +42,9 @@ public:
     
     void testBarkerPassedToJS1();
     void testHeapWrappedJSBarker2();
+    
+    void testGCScheduler();
+    void testGCTelemetry();
+    void testGCController();
+    void testMemoryReport();
 };